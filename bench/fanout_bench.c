@@ -0,0 +1,172 @@
+/*
+**  Filename : fanout_bench.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Benchmark of the children of the nodes of a tree of URLs
+**              against their fan-out, to choose FANOUT_THRESHOLD (the nb
+**              of children from which they are indexed).
+**              - For each fan-out F, NB_URLS URLs form a tree where every
+**              node has F children: the parts of the path of an URL are
+**              the digits of its number in base F.
+**              - The URLs are inserted in a shuffled order, then found
+**              again with findNode (NB_FIND_RUNS times, the fastest run
+**              is kept), the time per URL is printed.
+**              - It is built once per threshold (-DFANOUT_THRESHOLD=...),
+**              UINT32_MAX for children never indexed.
+**              - The rule of the tree is checked after the insertions:
+**              the children of a node are indexed if and only if it
+**              has more than FANOUT_THRESHOLD of them, whatever the order
+**              of the URLs.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "url.h"
+
+#define NB_URLS (1 << 18)
+#define NB_FIND_RUNS 3            //the fastest run of findNode is kept
+#define MAX_PARTS 18              //nb of digits of NB_URLS - 1 in base 2
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+static const unsigned int fanouts[] = {2, 4, 8, 16, 32, 64, 128, 512};
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in seconds
+ */
+static double now(){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Build the URL of a number in a tree of fan-out F
+ * @param n : the number of the URL
+ * @param fanout : the fan-out F
+ * @return : the URL (to be freed)
+ */
+static char *makeBenchURL(unsigned int n, unsigned int fanout){
+  char buffer[16 * MAX_PARTS + 32];
+  unsigned int digits[MAX_PARTS], nbDigits = 0, max = NB_URLS - 1;
+  int len;
+
+  //as many parts for all the URLs: all are leaves
+  do{
+    digits[nbDigits++] = n % fanout;
+    n /= fanout;
+    max /= fanout;
+  }while (max > 0);
+  len = sprintf(buffer, "http://www.host.com");
+  while (nbDigits > 0){
+    len += sprintf(buffer + len, "/part%u", digits[--nbDigits]);
+  }
+  return strdup(buffer);
+}
+
+/**
+ * Shuffle an array of strings (same order on each run)
+ * @param array : the array
+ * @param nb : its nb of elements
+ * @return : nothing
+ */
+static void shuffle(char **array, int nb){
+  unsigned int seed = 12345;
+  char *tmp;
+  int j;
+
+  for (int i = nb - 1; i > 0; i--){
+    seed = seed * 1103515245 + 12345;
+    j = (seed >> 8) % (i + 1);
+    tmp = array[i];
+    array[i] = array[j];
+    array[j] = tmp;
+  }
+}
+
+/**
+ * Check that the nodes of a tree with more than FANOUT_THRESHOLD
+ * children, and only them, have an index of their children
+ * @param tree : the tree
+ * @param nbIndexed : where the nb of nodes indexed is saved
+ * @return : the nb of nodes breaking the rule
+ */
+static uint32_t checkIndexes(URLTree *tree, uint32_t *nbIndexed){
+  uint32_t nbWrong = 0, nbChildren;
+
+  *nbIndexed = 0;
+  for (Node node = 0; node < tree->nbNodes; node++){
+    nbChildren = 0;
+    for (Node child = NODE(tree, node)->firstChild; child != NO_NODE;
+    child = NODE(tree, child)->nextSibling){
+      nbChildren++;
+    }
+    if (NODE(tree, node)->childIndex != NO_INDEX) (*nbIndexed)++;
+    if (nbChildren != NODE(tree, node)->nbChildren
+        || (nbChildren > FANOUT_THRESHOLD) != (NODE(tree, node)->childIndex != NO_INDEX)){
+      nbWrong++;
+    }
+  }
+  return nbWrong;
+}
+
+int main(){
+  char **urls = (char**)malloc(NB_URLS * sizeof(char*));
+  const char *threshold = FANOUT_THRESHOLD == UINT32_MAX ? "none" : TO_STRING(FANOUT_THRESHOLD);
+  URLTree *tree;
+  double start, insertTime, findTime;
+  uint32_t nbIndexed, nbWrong;
+  int found;
+
+  if (urls == NULL){
+    fprintf(stderr, "Allocation for URLs failed.\n");
+    exit(1);
+  }
+  for (size_t f = 0; f < sizeof(fanouts) / sizeof(fanouts[0]); f++){
+    for (int i = 0; i < NB_URLS; i++){
+      urls[i] = makeBenchURL(i, fanouts[f]);
+    }
+    shuffle(urls, NB_URLS);
+
+    tree = makeTree("http://www.host.com");
+    start = now();
+    for (int i = 0; i < NB_URLS; i++){
+      insertURLIfNew(tree, urls[i], 1);
+    }
+    insertTime = now() - start;
+    nbWrong = checkIndexes(tree, &nbIndexed);
+    findTime = -1;
+    for (int run = 0; run < NB_FIND_RUNS; run++){
+      shuffle(urls, NB_URLS);
+      found = 0;
+      start = now();
+      for (int i = 0; i < NB_URLS; i++){
+        found += findNode(tree, ROOT_NODE, (char*)skipProtocol(urls[i])) != NO_NODE;
+      }
+      if (findTime < 0 || now() - start < findTime) findTime = now() - start;
+    }
+    printf("fanout: threshold %-4s fan-out %6u  insert %6.0f ns/URL  find %6.0f ns/URL  %6u nodes indexed\n",
+           threshold, fanouts[f], insertTime * 1e9 / NB_URLS, findTime * 1e9 / NB_URLS, nbIndexed);
+
+    delTree(&tree);
+    for (int i = 0; i < NB_URLS; i++){
+      free(urls[i]);
+    }
+    if (found != NB_URLS){
+      fprintf(stderr, "fanout: %d URLs found out of %d\n", found, NB_URLS);
+      return 1;
+    }
+    if (nbWrong > 0){
+      fprintf(stderr, "fanout: %u nodes indexed against their nb of children\n", nbWrong);
+      return 1;
+    }
+  }
+  free(urls);
+  return 0;
+}
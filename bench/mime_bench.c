@@ -0,0 +1,142 @@
+/*
+**  Filename : mime_bench.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Benchmark of the setting up of the table of the MIME
+**              types at start (mime.h).
+**              - initAllMIME with the table built into the program.
+**              - initAllMIME with a local file listing the same types
+**              (mime.types format).
+**              - The parse of the MDN page done before the built-in table:
+**              the page was downloaded at each start, then read line by
+**              line. The page is rebuilt here from the same types, in the
+**              layout of the MDN table (one cell per line), the download
+**              itself is not counted.
+**              - Each is run NB_RUNS times, the time per start is printed.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mime.h"
+
+#define NB_RUNS 1000
+#define LINE_SIZE 1000
+
+static char typesPath[] = "/tmp/mimebench-types-XXXXXX";
+static char pagePath[] = "/tmp/mimebench-page-XXXXXX";
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in seconds
+ */
+static double now(){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Write the built-in types in a mime.types file and in a page
+ * laid out as the MDN table of the MIME types
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeFiles(){
+  int fdTypes = mkstemp(typesPath), fdPage = mkstemp(pagePath);
+  FILE *types = fdTypes < 0 ? NULL : fdopen(fdTypes, "w");
+  FILE *page = fdPage < 0 ? NULL : fdopen(fdPage, "w");
+
+  if (types == NULL || page == NULL) return -1;
+  fprintf(page, "<table class=\"standard-table\">\n<thead>\n<tr>\n<th>Extension</th>\n"
+                "<th>Type de document</th>\n<th>Type MIME</th>\n</tr>\n</thead>\n<tbody>\n");
+  for (size_t i = 0; i < nbMIMEs; i++){
+    fprintf(types, "%s %s\n", allMIMEs[i].type, allMIMEs[i].extension + 1);
+    fprintf(page, "<tr>\n<td><code>%s</code></td>\n<td>Document %zu</td>\n<td><code>%s</code></td>\n</tr>\n",
+            allMIMEs[i].extension, i, allMIMEs[i].type);
+  }
+  fprintf(page, "</tbody>\n</table>\n");
+  fclose(page);
+  return fclose(types) == 0 ? 0 : -1;
+}
+
+/**
+ * Read the MIME types in the MDN page as it was done
+ * before the built-in table, then free them
+ * @return : the nb of types read
+ */
+static size_t parsePage(){
+  FILE *f = fopen(pagePath, "r");
+  char buffer[LINE_SIZE], *ext = NULL, *type = NULL, *start, *end;
+  TypeMIME *types = (TypeMIME*)malloc(nbMIMEs * sizeof(TypeMIME));
+  size_t nbTypes = 0;
+
+  if (f == NULL || types == NULL){
+    fprintf(stderr, "Cannot read file %s\n", pagePath);
+    exit(1);
+  }
+  while (fgets(buffer, LINE_SIZE, f) != NULL){
+    if (strstr(buffer, "<td><code>.") != NULL){
+      start = strstr(buffer, "<td><code>.") + strlen("<td><code>");
+      end = strstr(start, "</code></td>");
+      ext = strndup(start, end - start);
+    }else if (strstr(buffer, "<td><code>") != NULL){
+      start = strstr(buffer, "<td><code>") + strlen("<td><code>");
+      end = strstr(start, "</code>");
+      type = strndup(start, end - start);
+    }else if (strstr(buffer, "</tr>") != NULL && ext != NULL && type != NULL){
+      types[nbTypes].extension = ext;
+      types[nbTypes++].type = type;
+      ext = type = NULL;
+    }else if (strstr(buffer, "</tbody>") != NULL){
+      break;
+    }
+  }
+  fclose(f);
+  for (size_t i = 0; i < nbTypes; i++){
+    free((char*)types[i].extension);
+    free((char*)types[i].type);
+  }
+  free(types);
+  return nbTypes;
+}
+
+int main(){
+  double start, builtIn, file, page;
+  size_t nbTypes = 0;
+
+  initAllMIME(NULL);
+  if (writeFiles() != 0){
+    fprintf(stderr, "Cannot write the files of the MIME types in /tmp\n");
+    return 1;
+  }
+  delAllMIME();
+
+  start = now();
+  for (int i = 0; i < NB_RUNS; i++){
+    initAllMIME(NULL);
+    delAllMIME();
+  }
+  builtIn = (now() - start) / NB_RUNS;
+  start = now();
+  for (int i = 0; i < NB_RUNS; i++){
+    initAllMIME(typesPath);
+    delAllMIME();
+  }
+  file = (now() - start) / NB_RUNS;
+  start = now();
+  for (int i = 0; i < NB_RUNS; i++){
+    nbTypes = parsePage();
+  }
+  page = (now() - start) / NB_RUNS;
+
+  printf("mime: %zu types, built-in table %7.1f us, mime.types file %7.1f us, "
+         "MDN page parse %7.1f us (download not counted)\n",
+         nbTypes, builtIn * 1e6, file * 1e6, page * 1e6);
+  unlink(typesPath);
+  unlink(pagePath);
+  return 0;
+}
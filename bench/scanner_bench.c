@@ -0,0 +1,136 @@
+/*
+**  Filename : scanner_bench.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Benchmark of the link scanner (extract.h) with each of
+**              its searches of '=', '<' and '>': one byte at a time,
+**              SSE2 and AVX2 (those the processor has).
+**              - An html page is repeated up to SCAN_MB MB, the buffer is
+**              fed to a scanner by chunks of CHUNK_SIZE bytes, the size
+**              libcurl hands to its write callback.
+**              - The search alone, then the whole scanner are timed
+**              (the fastest of NB_RUNS runs), in GB/s. The nb of links
+**              found must be the same for all the searches.
+**              - The static functions of the scanner are reached by
+**              including extract.c.
+*/
+#include "extract.c"
+#include <time.h>
+
+#define SCAN_MB 256
+#define CHUNK_SIZE 16384          //CURL_MAX_WRITE_SIZE
+#define NB_RUNS 3
+
+typedef struct search{
+  const char *name;
+  FindSpecial find;
+}Search;
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in seconds
+ */
+static double now(){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Count a link found by the scanner
+ * @return : nothing
+ */
+static void countLink(const char *url, size_t len, int isBase, void *arg){
+  (*(long*)arg)++;
+}
+
+/**
+ * Read a whole file and repeat its content
+ * @param filePath : the file
+ * @param size : the size wanted
+ * @return : the buffer of size bytes (to be freed), NULL if the file
+ * cannot be read
+ */
+static char *loadRepeated(const char *filePath, size_t size){
+  FILE *f = fopen(filePath, "rb");
+  char *buffer;
+  size_t len;
+
+  if (f == NULL) return NULL;
+  buffer = (char*)malloc(size);
+  if (buffer == NULL){
+    fprintf(stderr, "Allocation for the page failed.\n");
+    exit(1);
+  }
+  len = fread(buffer, 1, size, f);
+  fclose(f);
+  if (len == 0){
+    free(buffer);
+    return NULL;
+  }
+  for (size_t done = len; done < size; done += len){
+    memcpy(buffer + done, buffer, size - done < len ? size - done : len);
+  }
+  return buffer;
+}
+
+int main(int argc, char **argv){
+  const char *filePath = argc > 1 ? argv[1] : "../ressources/google.html";
+  size_t size = (size_t)SCAN_MB * 1024 * 1024;
+  char *buffer = loadRepeated(filePath, size);
+  Search searches[3];
+  int nbSearches = 0;
+  long nbLinks, nbFirst = -1, nbSpecials;
+  double start, searchTime, scanTime;
+  LinkScanner scanner;
+
+  if (buffer == NULL){
+    fprintf(stderr, "Cannot read file %s\n", filePath);
+    return 1;
+  }
+  searches[nbSearches].name = "scalar";
+  searches[nbSearches++].find = findSpecialScalar;
+#ifdef SCAN_X86
+  searches[nbSearches].name = "SSE2";
+  searches[nbSearches++].find = findSpecialSSE2;
+  if (__builtin_cpu_supports("avx2")){
+    searches[nbSearches].name = "AVX2";
+    searches[nbSearches++].find = findSpecialAVX2;
+  }
+#endif
+
+  for (int s = 0; s < nbSearches; s++){
+    searchTime = scanTime = -1;
+    for (int run = 0; run < NB_RUNS; run++){
+      //the search alone, from one special character to the next
+      nbSpecials = 0;
+      start = now();
+      for (const char *c = buffer, *end = buffer + size; (c = searches[s].find(c, end)) < end; c++){
+        nbSpecials++;
+      }
+      if (searchTime < 0 || now() - start < searchTime) searchTime = now() - start;
+
+      nbLinks = 0;
+      initScanner(&scanner);
+      scanner.findSpecial = searches[s].find;
+      start = now();
+      for (size_t done = 0; done < size; done += CHUNK_SIZE){
+        feedScanner(&scanner, buffer + done, size - done < CHUNK_SIZE ? size - done : CHUNK_SIZE, countLink, &nbLinks);
+      }
+      if (scanTime < 0 || now() - start < scanTime) scanTime = now() - start;
+      delScanner(&scanner);
+    }
+    printf("scanner: %-6s search %6.2f GB/s  scanner %6.2f GB/s  (%ld specials, %ld links in %d MB)\n",
+           searches[s].name, size / searchTime / 1e9, size / scanTime / 1e9, nbSpecials, nbLinks, SCAN_MB);
+    if (nbFirst >= 0 && nbLinks != nbFirst){
+      fprintf(stderr, "scanner: %s found %ld links instead of %ld\n", searches[s].name, nbLinks, nbFirst);
+      return 1;
+    }
+    nbFirst = nbLinks;
+  }
+  free(buffer);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+**  Filename : sink_bench.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Benchmark of the writing of the contents on disk.
+**              - The contents arrive by chunks of CHUNK_SIZE bytes, the
+**              size libcurl hands to its write callback.
+**              - They are written through a sink (sink.h), then as each
+**              chunk was written before the sinks: the directory
+**              created with "mkdir -p" and the file opened in append
+**              mode, written and closed again for every chunk. The same
+**              is also measured without the "mkdir -p".
+**              - 2 workloads: one large content, and many small pages.
+**              - The wall time and the write syscalls (counted by the
+**              kernel in /proc/self/io) are printed per MB, with the
+**              files opened and the processes started per MB.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sink.h"
+
+#define CHUNK_SIZE 16384          //CURL_MAX_WRITE_SIZE
+#define LARGE_MB 32               //size of the large content
+#define NB_PAGES 1000             //nb of small pages
+#define PAGE_SIZE 24000           //size of a small page
+
+typedef enum writer{SINK_WRITER, CHUNK_MKDIR_WRITER, CHUNK_WRITER} Writer;
+
+static char dirPath[] = "/tmp/sinkbench-XXXXXX";
+static char chunk[CHUNK_SIZE];
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in seconds
+ */
+static double now(){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Get the nb of write syscalls made by this process so far
+ * @return : the nb of syscalls, -1 if it is not available
+ */
+static long long countWrites(){
+  FILE *f = fopen("/proc/self/io", "r");
+  char line[128];
+  long long count = -1;
+
+  if (f == NULL) return -1;
+  while (fgets(line, sizeof(line), f) != NULL){
+    if (sscanf(line, "syscw: %lld", &count) == 1) break;
+  }
+  fclose(f);
+  return count;
+}
+
+/**
+ * Write one content chunk by chunk as it was done before the sinks
+ * @param filePath : the file of the content
+ * @param size : the size of the content
+ * @param mkdir : 1 to run "mkdir -p" before each chunk
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeByChunks(const char *filePath, size_t size, int mkdir){
+  char command[256];
+  size_t len;
+  FILE *f;
+
+  for (size_t done = 0; done < size; done += len){
+    len = size - done < CHUNK_SIZE ? size - done : CHUNK_SIZE;
+    if (mkdir){
+      snprintf(command, sizeof(command), "mkdir -p %s/", dirPath);
+      if (system(command) != 0) return -1;
+    }
+    f = fopen(filePath, "a");
+    if (f == NULL) return -1;
+    fwrite(chunk, 1, len, f);
+    fclose(f);
+  }
+  return 0;
+}
+
+/**
+ * Write one content chunk by chunk through a sink
+ * @param filePath : the file of the content
+ * @param size : the size of the content
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeBySink(const char *filePath, size_t size){
+  OutputSink sink;
+  size_t len;
+
+  initSink(&sink, strdup(filePath));
+  for (size_t done = 0; done < size; done += len){
+    len = size - done < CHUNK_SIZE ? size - done : CHUNK_SIZE;
+    if (writeSink(&sink, chunk, len) != len){
+      discardSink(&sink);
+      return -1;
+    }
+  }
+  return closeSink(&sink);
+}
+
+/**
+ * Write contents with a writer and print what it cost
+ * @param name : the name of the workload
+ * @param writer : how the contents are written
+ * @param nbContents : the nb of contents
+ * @param size : the size of each content
+ * @return : 0 if succeeded, -1 if not
+ */
+static int run(const char *name, Writer writer, int nbContents, size_t size){
+  static const char *writerNames[] = {"sink", "per-chunk + mkdir -p", "per-chunk"};
+  char filePath[256];
+  double mb = (double)nbContents * size / (1024 * 1024), start, elapsed;
+  long long writes = countWrites(), nbChunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  double opens, spawns;
+  int res = 0;
+
+  start = now();
+  for (int i = 0; i < nbContents && res == 0; i++){
+    snprintf(filePath, sizeof(filePath), "%s/%s-%d-%d.html", dirPath, name, writer, i);
+    res = writer == SINK_WRITER ? writeBySink(filePath, size)
+        : writeByChunks(filePath, size, writer == CHUNK_MKDIR_WRITER);
+  }
+  elapsed = now() - start;
+  writes = writes < 0 ? -1 : countWrites() - writes;
+  if (res != 0){
+    fprintf(stderr, "sink: cannot write in %s\n", dirPath);
+    return -1;
+  }
+
+  //a sink opens the file of a content once, the old path once per chunk
+  opens = (writer == SINK_WRITER ? nbContents : nbContents * nbChunks) / mb;
+  spawns = (writer == CHUNK_MKDIR_WRITER ? nbContents * nbChunks : 0) / mb;
+  printf("sink: %-6s %-21s %8.2f ms/MB %8.1f write syscalls/MB %8.2f opens/MB %8.2f processes/MB\n",
+         name, writerNames[writer], elapsed * 1000 / mb, writes / mb, opens, spawns);
+  for (int i = 0; i < nbContents; i++){
+    snprintf(filePath, sizeof(filePath), "%s/%s-%d-%d.html", dirPath, name, writer, i);
+    unlink(filePath);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv){
+  int largeMB = argc > 1 ? atoi(argv[1]) : LARGE_MB, res = 0;
+
+  if (largeMB <= 0 || mkdtemp(dirPath) == NULL){
+    fprintf(stderr, "Usage: %s [size of the large content in MB]\n", argv[0]);
+    return 1;
+  }
+  for (int i = 0; i < CHUNK_SIZE; i++){
+    chunk[i] = 'a' + i % 26;
+  }
+  for (Writer writer = SINK_WRITER; writer <= CHUNK_WRITER && res == 0; writer++){
+    res = run("large", writer, 1, (size_t)largeMB * 1024 * 1024);
+  }
+  for (Writer writer = SINK_WRITER; writer <= CHUNK_WRITER && res == 0; writer++){
+    res = run("pages", writer, NB_PAGES, PAGE_SIZE);
+  }
+  rmdir(dirPath);
+  return res == 0 ? 0 : 1;
+}
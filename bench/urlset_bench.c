@@ -0,0 +1,166 @@
+/*
+**  Filename : urlset_bench.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Microbenchmark of the set of parsed URLs of a tree.
+**              - NB_URLS URLs are inserted in a tree, about as many hosts
+**              as pages, with one directory holding a large part of them
+**              (the links of a big listing page).
+**              - The same URLs, then as many URLs never inserted, are
+**              looked up by walking the tree (findNode, what URLAlrParsed
+**              did before the set) and by the fingerprint set
+**              (URLAlrParsed), in a shuffled order.
+**              - Both answers are compared, the time per lookup is printed.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "url.h"
+
+#define NB_URLS 1000000
+#define NB_HOSTS 64
+#define BIG_DIRECTORY 50000       //nb of URLs in the same directory
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in seconds
+ */
+static double now(){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Build the i-th URL of the benchmark
+ * @param i : the number of the URL
+ * @param missing : 1 for an URL which is never inserted
+ * @return : the URL (to be freed)
+ */
+static char *makeBenchURL(int i, int missing){
+  char buffer[256];
+
+  if (i < BIG_DIRECTORY){
+    snprintf(buffer, sizeof(buffer), "http://www.host0.com/list/item%d%s.html", i, missing ? "x" : "");
+  }else{
+    snprintf(buffer, sizeof(buffer), "http://www.host%d.com/%s/sec%d/page%d/%s", i % NB_HOSTS,
+             i % 3 ? "static" : "blog", i % 97, i / 97, missing ? "edit.php" : "index.html");
+  }
+  return strdup(buffer);
+}
+
+/**
+ * Shuffle an array of strings (same order on each run)
+ * @param array : the array
+ * @param nb : its nb of elements
+ * @return : nothing
+ */
+static void shuffle(char **array, int nb){
+  unsigned int seed = 12345;
+  char *tmp;
+  int j;
+
+  for (int i = nb - 1; i > 0; i--){
+    seed = seed * 1103515245 + 12345;
+    j = (seed >> 8) % (i + 1);
+    tmp = array[i];
+    array[i] = array[j];
+    array[j] = tmp;
+  }
+}
+
+/**
+ * Look up URLs by walking the tree
+ * @param tree : the tree
+ * @param urls : the URLs
+ * @param nb : the nb of URLs
+ * @return : the nb of URLs found parsed
+ */
+static int lookupTree(URLTree *tree, char **urls, int nb){
+  int found = 0;
+  Node node;
+
+  for (int i = 0; i < nb; i++){
+    node = findNode(tree, ROOT_NODE, (char*)skipProtocol(urls[i]));
+    if (node != NO_NODE && NODE(tree, node)->depth >= 0) found++;
+  }
+  return found;
+}
+
+/**
+ * Look up URLs in the set of parsed URLs
+ * @param tree : the tree
+ * @param urls : the URLs
+ * @param nb : the nb of URLs
+ * @return : the nb of URLs found parsed
+ */
+static int lookupSet(URLTree *tree, char **urls, int nb){
+  int found = 0;
+
+  for (int i = 0; i < nb; i++){
+    found += URLAlrParsed(tree, urls[i]);
+  }
+  return found;
+}
+
+int main(){
+  char **urls = (char**)malloc(2 * NB_URLS * sizeof(char*));
+  URLTree *tree;
+  double start, insertTime;
+  struct {const char *name; char **urls; int expected;} runs[2];
+
+  if (urls == NULL){
+    fprintf(stderr, "Allocation for URLs failed.\n");
+    exit(1);
+  }
+  for (int i = 0; i < NB_URLS; i++){
+    urls[i] = makeBenchURL(i, 0);
+    urls[NB_URLS + i] = makeBenchURL(i, 1);
+  }
+  tree = makeTree(urls[0]);
+  start = now();
+  for (int i = 0; i < NB_URLS; i++){
+    insertURLIfNew(tree, urls[i], 1);
+  }
+  insertTime = now() - start;
+  printf("urlset: %d URLs inserted in %.3f s (%.0f ns/URL), %u nodes\n",
+         NB_URLS, insertTime, insertTime * 1e9 / NB_URLS, tree->nbNodes);
+
+  shuffle(urls, NB_URLS);
+  shuffle(urls + NB_URLS, NB_URLS);
+  runs[0].name = "hits";
+  runs[0].urls = urls;
+  runs[0].expected = NB_URLS;
+  runs[1].name = "misses";
+  runs[1].urls = urls + NB_URLS;
+  runs[1].expected = 0;
+  for (int r = 0; r < 2; r++){
+    double treeTime, setTime;
+    int treeFound, setFound;
+
+    start = now();
+    treeFound = lookupTree(tree, runs[r].urls, NB_URLS);
+    treeTime = now() - start;
+    start = now();
+    setFound = lookupSet(tree, runs[r].urls, NB_URLS);
+    setTime = now() - start;
+    printf("urlset: %-6s tree walk %6.0f ns/lookup, fingerprint set %6.0f ns/lookup (x%.1f)\n",
+           runs[r].name, treeTime * 1e9 / NB_URLS, setTime * 1e9 / NB_URLS, treeTime / setTime);
+    if (treeFound != runs[r].expected || setFound != runs[r].expected){
+      fprintf(stderr, "urlset: %s found %d by the tree and %d by the set, %d expected\n",
+              runs[r].name, treeFound, setFound, runs[r].expected);
+      return 1;
+    }
+  }
+
+  delTree(&tree);
+  for (int i = 0; i < 2 * NB_URLS; i++){
+    free(urls[i]);
+  }
+  free(urls);
+  return 0;
+}
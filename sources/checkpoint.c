@@ -0,0 +1,461 @@
+/*
+**  Filename : checkpoint.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Checkpoints of the crawls, to go on with a crawl stopped
+**              before its end instead of starting it again.
+**              - The checkpoint of a task is one binary file, DATA_DIR/name
+**              of task.checkpoint: the tree of each action (with the depths
+**              of its URLs, see writeTree in url.h) and the URLs still to
+**              do (those waiting in the frontier and those admitted and not
+**              done yet). The metadata of the contents saved (metastore.h)
+**              is written at the same time, it is the state of the URLs
+**              already fetched, and the logs of the URLs done (urllog.h)
+**              are flushed.
+**              - A checkpoint is written aside and renamed, the previous
+**              one stays whole if the process dies while writing.
+**              - The engine takes a checkpoint every checkpoint interval,
+**              on SIGUSR1, and on SIGINT/SIGTERM before it stops. A second
+**              SIGINT/SIGTERM ends the process at once.
+**              - A crawl with a checkpoint starts from it (the file is
+**              mapped in memory and read in place). The checkpoint is
+**              removed once the crawl is over.
+**              - The signals are handled by a thread of their own which
+**              only sets flags and notifies the watchers (the engines and
+**              the scheduler), nothing is done in a signal handler.
+**
+**              The file starts with CHECKPOINT_MAGIC, the version and the
+**              nb of actions. Then, for each action: the length of its
+**              name, its name and its tree. Then the nb of URLs to do and,
+**              for each one: the index of its action, its depth, its
+**              kind (a page, a robots.txt or a sitemap), its length (with
+**              its '\0') and the URL. It ends with
+**              CHECKPOINT_MAGIC again, a file without it is incomplete.
+**              Numbers are written as they are in memory: a checkpoint is
+**              read back on the machine which wrote it.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "directory.h"
+
+#define MAGIC_SIZE (sizeof(CHECKPOINT_MAGIC) - 1)
+
+/*State of the writing of the URLs to do*/
+typedef struct checkpointWriter{
+  FILE *f;
+  Crawl *crawl;
+  int res;
+}CheckpointWriter;
+
+static long long interval = DEFAULT_CHECKPOINT_INTERVAL * 1000LL;
+static atomic_int nbAsked = 0;
+static atomic_int stopFlag = 0;
+static sigset_t handledSignals;
+static SignalWatcher *watchers = NULL;
+static pthread_mutex_t watchersLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Get the file of the checkpoint of a task:
+ * its name whose spaces are replaced by '_'
+ */
+static char *checkpointPath(Task *task){
+  char *res = (char*)malloc(strlen(DATA_DIR) + strlen(task->name) + strlen(CHECKPOINT_EXTENSION) + 2);
+  char *c;
+
+  if (res == NULL){
+    fprintf(stderr, "Allocation for path of checkpoint failed.\n");
+    exit(1);
+  }
+  sprintf(res, "%s/%s%s", DATA_DIR, task->name, CHECKPOINT_EXTENSION);
+  for (c = res + strlen(DATA_DIR) + 1; *c != '\0'; c++){
+    if (*c == ' ') *c = '_';
+  }
+  return res;
+}
+
+static int writeUint32(FILE *f, uint32_t value){
+  return fwrite(&value, sizeof(uint32_t), 1, f) == 1 ? 0 : -1;
+}
+
+static int writeBytes(FILE *f, const void *data, size_t size){
+  return size == 0 || fwrite(data, 1, size, f) == size ? 0 : -1;
+}
+
+/**
+ * Write an URL to do in the checkpoint
+ * @param entry : the URL
+ * @param arg : the CheckpointWriter
+ */
+static void writeEntry(FrontierEntry *entry, void *arg){
+  CheckpointWriter *writer = (CheckpointWriter*)arg;
+  uint32_t action = 0, len = strlen(entry->url) + 1;
+
+  while (writer->crawl->wrappers[action] != (WrapAction*)entry->owner) action++;
+  writer->res |= writeUint32(writer->f, action);
+  writer->res |= writeUint32(writer->f, (uint32_t)entry->depth);
+  writer->res |= writeUint32(writer->f, (uint32_t)entry->kind);
+  writer->res |= writeUint32(writer->f, len);
+  writer->res |= writeBytes(writer->f, entry->url, len);
+}
+
+/**
+ * Write the checkpoint of a crawl in a file
+ * (the locks of the crawl held)
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeCheckpoint(Crawl *crawl, FILE *f, uint32_t *nbURLs){
+  CheckpointWriter writer = {f, crawl, 0};
+  Action *action;
+  FrontierEntry *entry;
+
+  writer.res |= writeBytes(f, CHECKPOINT_MAGIC, MAGIC_SIZE);
+  writer.res |= writeUint32(f, CHECKPOINT_VERSION);
+  writer.res |= writeUint32(f, crawl->task->nbActions);
+  for (int i = 0; i < crawl->task->nbActions; i++){
+    action = crawl->wrappers[i]->action;
+    writer.res |= writeUint32(f, strlen(action->name));
+    writer.res |= writeBytes(f, action->name, strlen(action->name));
+    writer.res |= writeTree(crawl->wrappers[i]->tree, f);
+  }
+
+  //the URLs waiting and those admitted (started or not)
+  *nbURLs = crawl->frontier.nbWaiting;
+  for (entry = crawl->admitted; entry != NULL; entry = entry->next) (*nbURLs)++;
+  writer.res |= writeUint32(f, *nbURLs);
+  browseFrontier(&(crawl->frontier), writeEntry, &writer);
+  for (entry = crawl->admitted; entry != NULL; entry = entry->next) writeEntry(entry, &writer);
+  writer.res |= writeBytes(f, CHECKPOINT_MAGIC, MAGIC_SIZE);
+  return writer.res;
+}
+
+/**
+ * Write the checkpoint of a crawl (nothing is done if
+ * the crawl is over), thread-safe
+ * @param crawl : the crawl
+ * @return : 0 if succeeded, -1 if not
+ */
+int saveCheckpoint(Crawl *crawl){
+  char *path, *tmpPath;
+  uint32_t nbURLs = 0;
+  FILE *f;
+  int res = 0;
+
+  //no URL is added meanwhile: each URL of the trees is either done or to do
+  pthread_rwlock_wrlock(&(crawl->discovery));
+  pthread_mutex_lock(&(crawl->lock));
+  if (crawl->finished){
+    pthread_mutex_unlock(&(crawl->lock));
+    pthread_rwlock_unlock(&(crawl->discovery));
+    return 0;
+  }
+
+  if (mkdir(DATA_DIR, 0755) != 0 && errno != EEXIST){
+    fprintf(stderr, "Cannot create directory %s: %s\n", DATA_DIR, strerror(errno));
+  }
+  path = checkpointPath(crawl->task);
+  tmpPath = (char*)malloc(strlen(path) + 5);
+  if (tmpPath == NULL){
+    fprintf(stderr, "Allocation for path of checkpoint failed.\n");
+    exit(1);
+  }
+  sprintf(tmpPath, "%s.tmp", path);
+
+  f = fopen(tmpPath, "w");
+  if (f == NULL){
+    fprintf(stderr, "Cannot open file %s\n", tmpPath);
+    res = -1;
+  }else{
+    res = writeCheckpoint(crawl, f, &nbURLs);
+    //on disk before it replaces the previous one
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) res = -1;
+    if (fclose(f) != 0) res = -1;
+    if (res != 0 || rename(tmpPath, path) != 0){
+      fprintf(stderr, "Cannot write file %s\n", path);
+      unlink(tmpPath);
+      res = -1;
+    }
+  }
+  //the contents saved until now, with their validators, and the URLs done
+  for (int i = 0; i < crawl->task->nbActions; i++){
+    if (saveMetaStore(crawl->wrappers[i]->store) != 0) res = -1;
+    if (flushURLLog(&(crawl->wrappers[i]->log)) != 0) res = -1;
+  }
+  pthread_mutex_unlock(&(crawl->lock));
+  pthread_rwlock_unlock(&(crawl->discovery));
+
+  if (res == 0) fprintf(stderr, "C: %s - checkpoint saved, %u URLs to do\n", crawl->task->name, nbURLs);
+  else fprintf(stderr, "C: %s - checkpoint not saved\n", crawl->task->name);
+  free(path);
+  free(tmpPath);
+  return res;
+}
+
+/**
+ * Read a block of bytes of a checkpoint, the cursor is moved after it
+ * @return : the block (in the mapped file), NULL if the file is too short
+ */
+static const char *readBytes(const char **cursor, const char *end, size_t size){
+  const char *res = *cursor;
+
+  if ((size_t)(end - res) < size) return NULL;
+  *cursor += size;
+  return res;
+}
+
+/**
+ * Read a 32-bit number of a checkpoint, the cursor is moved after it
+ * @return : 0 if succeeded, -1 if the file is too short
+ */
+static int readUint32(const char **cursor, const char *end, uint32_t *value){
+  const char *data = readBytes(cursor, end, sizeof(uint32_t));
+
+  if (data == NULL) return -1;
+  memcpy(value, data, sizeof(uint32_t));
+  return 0;
+}
+
+/**
+ * Read the URLs to do of a checkpoint, they are only verified
+ * if crawl is NULL and queued in the frontier of crawl if not
+ * @return : 0 if succeeded, -1 if the checkpoint is damaged
+ */
+static int readEntries(const char **cursor, const char *end, int nbActions, Crawl *crawl){
+  uint32_t nbURLs, action, depth, kind, len;
+  const char *url;
+
+  if (readUint32(cursor, end, &nbURLs) != 0) return -1;
+  for (uint32_t i = 0; i < nbURLs; i++){
+    if (readUint32(cursor, end, &action) != 0 || readUint32(cursor, end, &depth) != 0
+        || readUint32(cursor, end, &kind) != 0 || readUint32(cursor, end, &len) != 0
+        || action >= (uint32_t)nbActions || kind > URL_SITEMAP || len == 0
+        || (url = readBytes(cursor, end, len)) == NULL || url[len - 1] != '\0'){
+      return -1;
+    }
+    //the URL is read in place, pushFrontier copies it
+    if (crawl != NULL){
+      pushFrontier(&(crawl->frontier), url, (int32_t)depth, (int)kind, crawl->wrappers[action]);
+    }
+  }
+  url = readBytes(cursor, end, MAGIC_SIZE);
+  return url != NULL && memcmp(url, CHECKPOINT_MAGIC, MAGIC_SIZE) == 0 ? 0 : -1;
+}
+
+/**
+ * Read the trees of the actions of a checkpoint
+ * @param trees : where the trees are saved (nbActions trees)
+ * @return : 0 if succeeded, -1 if the checkpoint is damaged
+ * or made by other actions
+ */
+static int readTrees(const char **cursor, const char *end, Task *task, URLTree **trees){
+  uint32_t version, nbActions, len;
+  const char *data;
+
+  data = readBytes(cursor, end, MAGIC_SIZE);
+  if (data == NULL || memcmp(data, CHECKPOINT_MAGIC, MAGIC_SIZE) != 0
+      || readUint32(cursor, end, &version) != 0 || version != CHECKPOINT_VERSION
+      || readUint32(cursor, end, &nbActions) != 0 || nbActions != (uint32_t)task->nbActions){
+    return -1;
+  }
+  for (int i = 0; i < task->nbActions; i++){
+    if (readUint32(cursor, end, &len) != 0 || (data = readBytes(cursor, end, len)) == NULL
+        || len != strlen(task->actions[i]->name) || memcmp(data, task->actions[i]->name, len) != 0){
+      return -1;
+    }
+    trees[i] = readTree(cursor, end);
+    if (trees[i] == NULL) return -1;
+  }
+  return 0;
+}
+
+/**
+ * Rebuild a crawl from the checkpoint of its task, if it has one:
+ * its actions with their trees and its frontier
+ * @param crawl : the crawl, initialized but without its actions
+ * @return : 1 if the crawl was rebuilt, 0 if the crawl starts
+ * from the beginning (no checkpoint or a checkpoint not matching
+ * the actions of the task)
+ */
+int loadCheckpoint(Crawl *crawl){
+  Task *task = crawl->task;
+  char *path = checkpointPath(task);
+  const char *data, *cursor, *entries;
+  URLTree **trees;
+  struct stat st;
+  int fd, res;
+
+  fd = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0) return 0;     //the crawl was not stopped before its end
+  if (fstat(fd, &st) != 0 || st.st_size == 0){
+    close(fd);
+    return 0;
+  }
+  data = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED){
+    fprintf(stderr, "C: %s - cannot read checkpoint\n", task->name);
+    return 0;
+  }
+
+  trees = (URLTree**)calloc(task->nbActions > 0 ? task->nbActions : 1, sizeof(URLTree*));
+  if (trees == NULL){
+    fprintf(stderr, "Allocation for trees of checkpoint failed.\n");
+    exit(1);
+  }
+  cursor = data;
+  res = readTrees(&cursor, data + st.st_size, task, trees) == 0;
+  entries = cursor;
+  //verified entirely before the crawl is touched
+  if (res) res = readEntries(&cursor, data + st.st_size, task->nbActions, NULL) == 0;
+
+  if (res){
+    for (int i = 0; i < task->nbActions; i++){
+      crawl->wrappers[i] = initWrap(task->actions[i], trees[i], 1);
+    }
+    readEntries(&entries, data + st.st_size, task->nbActions, crawl);
+    fprintf(stderr, "C: %s - resumed from checkpoint, %zu URLs to do\n",
+            task->name, crawl->frontier.nbWaiting);
+  }else{
+    fprintf(stderr, "C: %s - checkpoint damaged or of other actions, crawl started again\n", task->name);
+    for (int i = 0; i < task->nbActions; i++) delTree(trees + i);
+  }
+  free(trees);
+  munmap((void*)data, st.st_size);
+  return res;
+}
+
+/**
+ * Remove the checkpoint of a crawl over
+ * @param crawl : the crawl
+ * @return : nothing
+ */
+void removeCheckpoint(Crawl *crawl){
+  char *path = checkpointPath(crawl->task);
+
+  if (unlink(path) == 0) fprintf(stderr, "C: %s - over, checkpoint removed\n", crawl->task->name);
+  free(path);
+}
+
+/**
+ * Set the interval between 2 checkpoints of a run
+ * @param seconds : the interval, 0 to only take them on signal
+ * @return : nothing
+ */
+void setCheckpointInterval(int seconds){
+  interval = seconds > 0 ? seconds * 1000LL : 0;
+}
+
+/**
+ * Get the interval between 2 checkpoints of a run
+ * @return : the interval in ms, 0 if they are only taken on signal
+ */
+long long getCheckpointInterval(){
+  return interval;
+}
+
+/**
+ * Thread waiting for the signals
+ */
+static void *waitSignals(void *arg){
+  int sig;
+
+  (void)arg;
+  while (sigwait(&handledSignals, &sig) == 0){
+    if (sig == SIGUSR1){
+      atomic_fetch_add(&nbAsked, 1);
+      fprintf(stderr, "C: checkpoint asked\n");
+    }else if (atomic_exchange(&stopFlag, 1)){
+      fprintf(stderr, "C: stopped without checkpoint\n");
+      _exit(1);
+    }else{
+      fprintf(stderr, "C: stop asked, checkpoint then stop\n");
+    }
+    pthread_mutex_lock(&watchersLock);
+    for (SignalWatcher *watcher = watchers; watcher != NULL; watcher = watcher->next){
+      watcher->notify(watcher->arg);
+    }
+    pthread_mutex_unlock(&watchersLock);
+  }
+  return NULL;
+}
+
+/**
+ * Start the thread handling SIGUSR1, SIGINT and SIGTERM
+ * (must be called before any other thread is created,
+ * the threads created after it do not receive these signals)
+ * @return : nothing
+ */
+void initSignals(){
+  pthread_t thread;
+
+  sigemptyset(&handledSignals);
+  sigaddset(&handledSignals, SIGUSR1);
+  sigaddset(&handledSignals, SIGINT);
+  sigaddset(&handledSignals, SIGTERM);
+  //blocked in all the threads, only waited for by one
+  pthread_sigmask(SIG_BLOCK, &handledSignals, NULL);
+  if (pthread_create(&thread, NULL, waitSignals, NULL) != 0){
+    fprintf(stderr, "Cannot create thread of signals.\n");
+    exit(1);
+  }
+  pthread_detach(thread);
+}
+
+/**
+ * Get the number of checkpoints asked by SIGUSR1 so far
+ * @return : the number, a watcher compares it to the last one it saw
+ */
+int checkpointsAsked(){
+  return atomic_load(&nbAsked);
+}
+
+/**
+ * Tell if SIGINT or SIGTERM asked to stop
+ * @return : 1 if the runs must stop, 0 if not
+ */
+int stopAsked(){
+  return atomic_load(&stopFlag);
+}
+
+/**
+ * Add a watcher notified of the signals
+ * @param watcher : the watcher (not copied)
+ * @return : nothing
+ */
+void watchSignals(SignalWatcher *watcher){
+  pthread_mutex_lock(&watchersLock);
+  watcher->next = watchers;
+  watchers = watcher;
+  pthread_mutex_unlock(&watchersLock);
+}
+
+/**
+ * Remove a watcher of the signals
+ * @param watcher : the watcher
+ * @return : nothing
+ */
+void unwatchSignals(SignalWatcher *watcher){
+  SignalWatcher **link;
+
+  pthread_mutex_lock(&watchersLock);
+  for (link = &watchers; *link != NULL; link = &((*link)->next)){
+    if (*link == watcher){
+      *link = watcher->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&watchersLock);
+}
@@ -0,0 +1,121 @@
+/*
+**  Filename : checkpoint.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Checkpoints of the crawls, to go on with a crawl stopped
+**              before its end instead of starting it again.
+**              - The checkpoint of a task is one binary file, DATA_DIR/name
+**              of task.checkpoint: the tree of each action (with the depths
+**              of its URLs, see writeTree in url.h) and the URLs still to
+**              do (those waiting in the frontier and those admitted and not
+**              done yet). The metadata of the contents saved (metastore.h)
+**              is written at the same time, it is the state of the URLs
+**              already fetched, and the logs of the URLs done (urllog.h)
+**              are flushed.
+**              - A checkpoint is written aside and renamed, the previous
+**              one stays whole if the process dies while writing.
+**              - The engine takes a checkpoint every checkpoint interval,
+**              on SIGUSR1, and on SIGINT/SIGTERM before it stops. A second
+**              SIGINT/SIGTERM ends the process at once.
+**              - A crawl with a checkpoint starts from it (the file is
+**              mapped in memory and read in place). The checkpoint is
+**              removed once the crawl is over.
+**              - The signals are handled by a thread of their own which
+**              only sets flags and notifies the watchers (the engines and
+**              the scheduler), nothing is done in a signal handler.
+*/
+#ifndef __CHECKPOINT
+#define __CHECKPOINT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "parse.h"
+
+#define CHECKPOINT_MAGIC "SCRAWLCK"
+#define CHECKPOINT_VERSION 3
+#define CHECKPOINT_EXTENSION ".checkpoint"
+#define DEFAULT_CHECKPOINT_INTERVAL 60  //seconds between 2 checkpoints of a run
+
+/*Notified by the thread of the signals when a signal
+* asks for a checkpoint or for the end of the runs
+*/
+typedef struct signalWatcher{
+  void (*notify)(void *arg);    //must not block
+  void *arg;
+  struct signalWatcher *next;
+}SignalWatcher;
+
+/**
+ * Write the checkpoint of a crawl (nothing is done if
+ * the crawl is over), thread-safe
+ * @param crawl : the crawl
+ * @return : 0 if succeeded, -1 if not
+ */
+int saveCheckpoint(Crawl *crawl);
+
+/**
+ * Rebuild a crawl from the checkpoint of its task, if it has one:
+ * its actions with their trees and its frontier
+ * @param crawl : the crawl, initialized but without its actions
+ * @return : 1 if the crawl was rebuilt, 0 if the crawl starts
+ * from the beginning (no checkpoint or a checkpoint not matching
+ * the actions of the task)
+ */
+int loadCheckpoint(Crawl *crawl);
+
+/**
+ * Remove the checkpoint of a crawl over
+ * @param crawl : the crawl
+ * @return : nothing
+ */
+void removeCheckpoint(Crawl *crawl);
+
+/**
+ * Set the interval between 2 checkpoints of a run
+ * @param seconds : the interval, 0 to only take them on signal
+ * @return : nothing
+ */
+void setCheckpointInterval(int seconds);
+
+/**
+ * Get the interval between 2 checkpoints of a run
+ * @return : the interval in ms, 0 if they are only taken on signal
+ */
+long long getCheckpointInterval();
+
+/**
+ * Start the thread handling SIGUSR1, SIGINT and SIGTERM
+ * (must be called before any other thread is created,
+ * the threads created after it do not receive these signals)
+ * @return : nothing
+ */
+void initSignals();
+
+/**
+ * Get the number of checkpoints asked by SIGUSR1 so far
+ * @return : the number, a watcher compares it to the last one it saw
+ */
+int checkpointsAsked();
+
+/**
+ * Tell if SIGINT or SIGTERM asked to stop
+ * @return : 1 if the runs must stop, 0 if not
+ */
+int stopAsked();
+
+/**
+ * Add a watcher notified of the signals
+ * @param watcher : the watcher (not copied)
+ * @return : nothing
+ */
+void watchSignals(SignalWatcher *watcher);
+
+/**
+ * Remove a watcher of the signals
+ * @param watcher : the watcher
+ * @return : nothing
+ */
+void unwatchSignals(SignalWatcher *watcher);
+
+#endif
@@ -32,6 +32,9 @@ void initOption(Option *opt, OptionType optType, OptionVal optVal){
             opt->val.depth = optVal.depth;
             break;
         case VERSIONNING:
+        case HEAD_FIRST:
+        case SITEMAP:
+        case STORE_COMPRESSED:
             opt->val.shift = optVal.shift;
             break;
         case TYPESELECT:
@@ -88,9 +91,10 @@ Action *initAction(char *nameAct, char *urlAct, OptionType *optTypes, OptionVal
  * @param nameActions: an array of names of actions which are executed by this task
  * @param totalActs : the total number of actions in the configuration file
  * @param nbActs: the number of action this task executes = size of nameActions
+ * @param limits : the limits of the transfers of this task
  * @return : a pointer on the initialized task
  */
-Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions, char **nameActions, int totalActs, int nbActs){
+Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions, char **nameActions, int totalActs, int nbActs, TaskLimits limits){
     if (nameTask == NULL || strlen(nameTask) == 0){
         fprintf(stderr, "Name of task unavailable.\n");
         exit(1);
@@ -116,6 +120,11 @@ Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions,
         exit(1);
     }
 
+    if (limits.maxTransfers < 1 || limits.hostConnections < 1 || limits.hostDelay < 0){
+        fprintf(stderr, "Limits invalid to create task.\n");
+        exit(1);
+    }
+
     if (nbActs > totalActs){
         fprintf(stderr, "The number of actions to be executed by this task exceeds the total number of actions available.\n");
         exit(1);
@@ -129,6 +138,7 @@ Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions,
     res->time.hour = hour;
     res->time.min = min;
     res->time.sec = sec;
+    res->limits = limits;
 
     //fill in the array of actions executed by this task
     for (int i = 0; i < res->nbActions; i++){
@@ -150,6 +160,18 @@ Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions,
 }
 
 
+/**
+ * Initialize the limits of a task to their default values
+ * @param limits : the limits to be initialized
+ * @return : nothing, the limits are modified through the pointer
+ */
+void initLimits(TaskLimits *limits){
+    limits->maxTransfers = DEFAULT_MAX_TRANSFERS;
+    limits->hostConnections = DEFAULT_HOST_CONNECTIONS;
+    limits->hostDelay = DEFAULT_HOST_DELAY;
+}
+
+
 /*****************READ CONFIGURATION FILE************************/
 /**
  * Count the number of actions and tasks in a configuration file
@@ -284,10 +306,9 @@ void readInActions(FILE *f, int nbActions, Action **allActions){
     char value[2000];
     char *name = NULL;
     char *url = NULL;
-    //each action can have maximum 3 options
-    OptionType currOptTypes[3];
-    OptionVal currOptVal[3];
-    int nbOpts;
+    OptionType currOptTypes[MAX_OPTIONS];
+    OptionVal currOptVal[MAX_OPTIONS];
+    int nbOpts = 0;
 
     while (fgets(buffer, 2100, f) != NULL && noCurrAct < nbActions){
         if (strstr(buffer, "==") != NULL){
@@ -337,6 +358,10 @@ void readInActions(FILE *f, int nbActions, Action **allActions){
                 }
             }else if (isOpt == 1){
                 //a pair of key-value which is an option
+                if (nbOpts == MAX_OPTIONS){
+                    fprintf(stderr, "Too many options for an action (maximum %d): {%s -> %s}\n", MAX_OPTIONS, key, value);
+                    exit(1);
+                }
                 if (strcmp(key, "max-depth") == 0){
                     currOptTypes[nbOpts] = MAX_DEPTH;
                     currOptVal[nbOpts].depth = atoi(value); //an int
@@ -352,6 +377,18 @@ void readInActions(FILE *f, int nbActions, Action **allActions){
                     currOptVal[nbOpts].type.nbTypes = nbTypes;
                     currOptVal[nbOpts].type.types = allTypes;
                     nbOpts++;
+                }else if (strcmp(key, "head-first") == 0){
+                    currOptTypes[nbOpts] = HEAD_FIRST;
+                    currOptVal[nbOpts].shift = strcmp(value, "on") == 0 ? 1:0;
+                    nbOpts++;
+                }else if (strcmp(key, "sitemap") == 0){
+                    currOptTypes[nbOpts] = SITEMAP;
+                    currOptVal[nbOpts].shift = strcmp(value, "on") == 0 ? 1:0;
+                    nbOpts++;
+                }else if (strcmp(key, "store-compressed") == 0){
+                    currOptTypes[nbOpts] = STORE_COMPRESSED;
+                    currOptVal[nbOpts].shift = strcmp(value, "on") == 0 ? 1:0;
+                    nbOpts++;
                 }else{
                     fprintf(stderr, "Undefined option of an action: {%s -> %s}\n", key, value);
                     exit(1);
@@ -388,6 +425,9 @@ void readInTasks(FILE *f, Task **allTasks, int nbTasks, Action **allActions, int
     char *name = NULL;
     int h = 0, m = 0, s = 0;
     char **nameActions; 
+    TaskLimits limits;
+
+    initLimits(&limits);
 
     while (fgets(buffer, 2100, f) != NULL && noCurrTask < nbTasks){
         if (strstr(buffer, "==") != NULL){
@@ -397,9 +437,10 @@ void readInTasks(FILE *f, Task **allTasks, int nbTasks, Action **allActions, int
                 //save the preceding parsed task
                 //then reset all the parameter variables
                 verifyTime(&h, &m, &s);
-                allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts);
+                allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts, limits);
                 free(name); name = NULL;
                 h = 0, m = 0, s = 0;
+                initLimits(&limits);
                 nbOpts = 0;
                 noCurrTask++;
             }
@@ -411,9 +452,10 @@ void readInTasks(FILE *f, Task **allTasks, int nbTasks, Action **allActions, int
                 //alr parsed through a preceding action
                 //save this action and reset all parameter variables
                 verifyTime(&h, &m, &s);
-                allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts);
+                allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts, limits);
                 free(name); name = NULL;
                 h = 0, m = 0, s = 0;
+                initLimits(&limits);
                 nbOpts = 0;
                 noCurrTask++;
             }
@@ -436,6 +478,12 @@ void readInTasks(FILE *f, Task **allTasks, int nbTasks, Action **allActions, int
                     m = atoi(value);
                 }else if (strcmp(key, "second") == 0){
                     s = atoi(value);
+                }else if (strcmp(key, "max-transfers") == 0){
+                    limits.maxTransfers = atoi(value);
+                }else if (strcmp(key, "host-connections") == 0){
+                    limits.hostConnections = atoi(value);
+                }else if (strcmp(key, "host-delay") == 0){
+                    limits.hostDelay = atoi(value);
                 }else{
                     fprintf(stderr, "Undefined champ of a task: {%s -> %s}.\n", key, value);
                     exit(1);
@@ -445,7 +493,7 @@ void readInTasks(FILE *f, Task **allTasks, int nbTasks, Action **allActions, int
     }
     if (name != NULL){
         verifyTime(&h, &m, &s);
-        allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts);
+        allTasks[noCurrTask] = initTask(name, s, m, h, allActions, nameActions, nbActions, nbOpts, limits);
         free(name); name = NULL;
     }
 }
@@ -549,6 +597,15 @@ void printAction(Action *action){
             case VERSIONNING:
                 printf("\tversionning = %s\n", action->options[i].val.shift == 0 ? "off":"on");
                 break;
+            case HEAD_FIRST:
+                printf("\thead-first = %s\n", action->options[i].val.shift == 0 ? "off":"on");
+                break;
+            case SITEMAP:
+                printf("\tsitemap = %s\n", action->options[i].val.shift == 0 ? "off":"on");
+                break;
+            case STORE_COMPRESSED:
+                printf("\tstore-compressed = %s\n", action->options[i].val.shift == 0 ? "off":"on");
+                break;
             case TYPESELECT:
                 printf("\ttype = {");
                 for (int j = 0; j < action->options[i].val.type.nbTypes - 1; ++j){
@@ -563,6 +620,8 @@ void printAction(Action *action){
 void printTask(Task *task){
     printf("Name: %s\n", task->name);
     printf("Time launch: %dh %dm %ds\n", task->time.hour, task->time.min, task->time.sec);
+    printf("Limits: %d transfers, %d connections per host, %d ms between requests to a host\n",
+           task->limits.maxTransfers, task->limits.hostConnections, task->limits.hostDelay);
     printf("This task executes %d actions:\n", task->nbActions);
     for (int i = 0; i < task->nbActions; ++i){
         printf("\t%s\n", task->actions[i]->name);
@@ -11,7 +11,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-typedef enum optionType{MAX_DEPTH=1, VERSIONNING, TYPESELECT} OptionType;
+#define MAX_OPTIONS 8      //maximum nb of options of an action
+
+typedef enum optionType{MAX_DEPTH=1, VERSIONNING, TYPESELECT, HEAD_FIRST, SITEMAP, STORE_COMPRESSED} OptionType;
 
 typedef struct type{
     int nbTypes; 
@@ -21,7 +23,7 @@ typedef struct type{
 typedef union optionVal{
     int depth;          //>=0; value if the chosen option is MAX_DEPTH 
     int shift;          //value if the chosen option is VERSIONNING 
-                        //off=0, on=1
+                        //or HEAD_FIRST, SITEMAP, STORE_COMPRESSED: off=0, on=1
     Type type;       //array of string, each string is a type 
                         //if the chosen option is TYPESELECT
 }OptionVal;
@@ -44,9 +46,24 @@ typedef struct timeLaunch{
     int hour;
 }TimeLaunch;
 
+#define DEFAULT_HOST_CONNECTIONS 2    //transfers to one host at the same time
+#define DEFAULT_HOST_DELAY 0          //milliseconds between 2 requests to one host
+#define DEFAULT_MAX_TRANSFERS 64      //transfers of a task at the same time
+
+/*Limits of the transfers of a task, given in the
+* configuration file by {host-connections -> N},
+* {host-delay -> milliseconds} and {max-transfers -> N}
+*/
+typedef struct taskLimits{
+    int maxTransfers;       //max nb of transfers of the task at the same time
+    int hostConnections;    //max nb of transfers to one host at the same time
+    int hostDelay;          //min nb of milliseconds between 2 requests to one host
+}TaskLimits;
+
 typedef struct task{
     char *name;
     TimeLaunch time;
+    TaskLimits limits;
     int nbActions; 
     Action **actions;   //array of Action pointers, each action can be performed by different tasks 
                         //Therefore we only use pointers to Action as these actions are shareable
@@ -93,9 +110,17 @@ Action *initAction(char *nameAct, char *urlAct, OptionType *optTypes, OptionVal
  * @param nameActions: an array of names of actions which are executed by this task
  * @param totalActs : the total number of actions in the configuration file
  * @param nbActs: the number of action this task executes = size of nameActions
+ * @param limits : the limits of the transfers of this task
  * @return : a pointer on the initialized task
  */
-Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions, char **nameActions, int totalActs, int nbActs);
+Task *initTask(char *nameTask, int sec, int min, int hour, Action **allActions, char **nameActions, int totalActs, int nbActs, TaskLimits limits);
+
+/**
+ * Initialize the limits of a task to their default values
+ * @param limits : the limits to be initialized
+ * @return : nothing, the limits are modified through the pointer
+ */
+void initLimits(TaskLimits *limits);
 
 /**
  * Read in a configuration 
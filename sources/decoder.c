@@ -0,0 +1,134 @@
+/*
+**  Filename : decoder.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Decoding of the contents compressed by their server
+**              (Content-Encoding gzip or deflate) while they arrive.
+**              - A content is inflated chunk by chunk, the bytes decoded
+**              are handed over in blocks of DECODER_BUFFER_SIZE bytes
+**              at most, a content of any size costs the same memory.
+**              - A deflate content is normally a zlib stream, some
+**              servers send the raw deflate data: both are read.
+**              - A gzip content may be made of several gzip members.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "decoder.h"
+
+
+/**
+ * Get the encoding told by a Content-Encoding header
+ * @param value : the value of the header, NULL if there is none
+ * @return : the encoding, ENCODING_UNKNOWN for an encoding
+ * which cannot be decoded here (or several encodings)
+ */
+Encoding parseEncoding(const char *value){
+  size_t len;
+
+  if (value == NULL) return ENCODING_IDENTITY;
+  while (isspace((unsigned char)*value)) value++;
+  len = strlen(value);
+  while (len > 0 && isspace((unsigned char)value[len - 1])) len--;
+  if (len == 0 || (len == 8 && strncasecmp(value, "identity", 8) == 0)) return ENCODING_IDENTITY;
+  if ((len == 4 && strncasecmp(value, "gzip", 4) == 0)
+      || (len == 6 && strncasecmp(value, "x-gzip", 6) == 0)) return ENCODING_GZIP;
+  if (len == 7 && strncasecmp(value, "deflate", 7) == 0) return ENCODING_DEFLATE;
+  return ENCODING_UNKNOWN;
+}
+
+/**
+ * Get the extension of the files compressed with an encoding
+ * @param encoding : the encoding
+ * @return : the extension (with its '.'), "" if the encoding
+ * does not compress or is unknown
+ */
+const char *getEncodingExtension(Encoding encoding){
+  switch (encoding){
+    case ENCODING_GZIP:
+      return ".gz";
+    case ENCODING_DEFLATE:
+      return ".zz";   //a zlib stream, as written by pigz -z
+    default:
+      return "";
+  }
+}
+
+/**
+ * Initialize a decoder before feeding it the first chunk
+ * @param decoder : the decoder to be initialized
+ * @param encoding : ENCODING_GZIP or ENCODING_DEFLATE
+ * @return : 0 if succeeded, -1 if the encoding cannot be decoded
+ * (the decoder must not be used nor freed then)
+ */
+int initDecoder(Decoder *decoder, Encoding encoding){
+  if (encoding != ENCODING_GZIP && encoding != ENCODING_DEFLATE) return -1;
+  memset(decoder, 0, sizeof(Decoder));
+  decoder->encoding = encoding;
+  if (inflateInit2(&(decoder->zs), encoding == ENCODING_GZIP ? 16 + MAX_WBITS : MAX_WBITS) != Z_OK){
+    return -1;
+  }
+  decoder->out = (char*)malloc(DECODER_BUFFER_SIZE * sizeof(char));
+  if (decoder->out == NULL){
+    fprintf(stderr, "Allocation for decoder failed.\n");
+    exit(1);
+  }
+  return 0;
+}
+
+/**
+ * Decode a chunk of a compressed content
+ * @param decoder : the state of the decoding of this content
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onData : function called with each block of decoded bytes
+ * @param arg : argument passed to onData
+ * @return : 0 if succeeded, -1 if the content is damaged or
+ * onData stopped the decoding
+ */
+int feedDecoder(Decoder *decoder, const char *data, size_t size, DecodedData onData, void *arg){
+  int ret, first = !decoder->started;
+  size_t produced;
+
+  if (size == 0) return 0;
+  decoder->started = 1;
+  decoder->zs.next_in = (Bytef*)data;
+  decoder->zs.avail_in = size;
+  do{
+    decoder->zs.next_out = (Bytef*)decoder->out;
+    decoder->zs.avail_out = DECODER_BUFFER_SIZE;
+    ret = inflate(&(decoder->zs), Z_NO_FLUSH);
+    if (ret == Z_DATA_ERROR && first && decoder->encoding == ENCODING_DEFLATE
+        && decoder->zs.total_out == 0){
+      //no zlib header: the raw deflate data, read again from the start
+      first = 0;
+      if (inflateReset2(&(decoder->zs), -MAX_WBITS) != Z_OK) return -1;
+      decoder->zs.next_in = (Bytef*)data;
+      decoder->zs.avail_in = size;
+      continue;
+    }
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return -1;
+    produced = DECODER_BUFFER_SIZE - decoder->zs.avail_out;
+    if (produced > 0 && onData(decoder->out, produced, arg) != 0) return -1;
+    if (ret == Z_STREAM_END){
+      //another gzip member may follow, nothing follows a deflate stream
+      if (decoder->encoding != ENCODING_GZIP || decoder->zs.avail_in == 0) return 0;
+      inflateReset(&(decoder->zs));
+    }
+  }while (decoder->zs.avail_in > 0 || decoder->zs.avail_out == 0);
+  return 0;
+}
+
+/**
+ * Free the memory held by a decoder
+ * @param decoder : the decoder
+ * @return : nothing
+ */
+void delDecoder(Decoder *decoder){
+  inflateEnd(&(decoder->zs));
+  free(decoder->out);
+  decoder->out = NULL;
+}
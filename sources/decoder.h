@@ -0,0 +1,83 @@
+/*
+**  Filename : decoder.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Decoding of the contents compressed by their server
+**              (Content-Encoding gzip or deflate) while they arrive.
+**              - A content is inflated chunk by chunk, the bytes decoded
+**              are handed over in blocks of DECODER_BUFFER_SIZE bytes
+**              at most, a content of any size costs the same memory.
+**              - A deflate content is normally a zlib stream, some
+**              servers send the raw deflate data: both are read.
+**              - A gzip content may be made of several gzip members.
+*/
+#ifndef __DECODER
+#define __DECODER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#define DECODER_BUFFER_SIZE (16 * 1024)   //size of the buffer of decoded bytes
+
+typedef enum encoding{ENCODING_IDENTITY, ENCODING_GZIP, ENCODING_DEFLATE, ENCODING_UNKNOWN} Encoding;
+
+/*Function called with each block of decoded bytes (only valid during
+* the call) and the pointer given to the decoder, it returns 0 to go
+* on and anything else to stop the decoding.
+*/
+typedef int (*DecodedData)(const char *data, size_t size, void *arg);
+
+typedef struct decoder{
+  Encoding encoding;
+  int started;          //1 once the first chunk was read
+  z_stream zs;
+  char *out;            //buffer of the decoded bytes
+}Decoder;
+
+/**
+ * Get the encoding told by a Content-Encoding header
+ * @param value : the value of the header, NULL if there is none
+ * @return : the encoding, ENCODING_UNKNOWN for an encoding
+ * which cannot be decoded here (or several encodings)
+ */
+Encoding parseEncoding(const char *value);
+
+/**
+ * Get the extension of the files compressed with an encoding
+ * @param encoding : the encoding
+ * @return : the extension (with its '.'), "" if the encoding
+ * does not compress or is unknown
+ */
+const char *getEncodingExtension(Encoding encoding);
+
+/**
+ * Initialize a decoder before feeding it the first chunk
+ * @param decoder : the decoder to be initialized
+ * @param encoding : ENCODING_GZIP or ENCODING_DEFLATE
+ * @return : 0 if succeeded, -1 if the encoding cannot be decoded
+ * (the decoder must not be used nor freed then)
+ */
+int initDecoder(Decoder *decoder, Encoding encoding);
+
+/**
+ * Decode a chunk of a compressed content
+ * @param decoder : the state of the decoding of this content
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onData : function called with each block of decoded bytes
+ * @param arg : argument passed to onData
+ * @return : 0 if succeeded, -1 if the content is damaged or
+ * onData stopped the decoding
+ */
+int feedDecoder(Decoder *decoder, const char *data, size_t size, DecodedData onData, void *arg);
+
+/**
+ * Free the memory held by a decoder
+ * @param decoder : the decoder
+ * @return : nothing
+ */
+void delDecoder(Decoder *decoder);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+**  Filename : directory.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Registry of the directories where the contents are saved.
+**              - The contents of an action are saved in
+**              DATA_DIR/name of action/type of content/
+**              - Each directory is created only once per run with mkdirat,
+**              relatively to the descriptor of its parent which is kept
+**              open, then remembered by the registry with the key
+**              (action, type) so later contents reuse it right away.
+**              - The registry can be used by several threads.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "directory.h"
+
+static int dataFd = -1;                 //descriptor of DATA_DIR
+static Directory *allDirectories = NULL;
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Create (if needed) and open the directory 'name' in the
+ * directory whose descriptor is parentFd
+ * @return : the descriptor of the directory, -1 if failed
+ */
+static int openDirAt(int parentFd, const char *name){
+  if (mkdirat(parentFd, name, 0755) != 0 && errno != EEXIST){
+    fprintf(stderr, "Cannot create directory %s: %s\n", name, strerror(errno));
+    return -1;
+  }
+  return openat(parentFd, name, O_RDONLY | O_DIRECTORY);
+}
+
+/**
+ * Look for a directory in the registry
+ * @param type : NULL to look for the directory of the action
+ * @return : the directory, NULL if not registered yet
+ */
+static Directory *findDirectory(const char *actionName, const char *type){
+  Directory *dir;
+  for (dir = allDirectories; dir != NULL; dir = dir->next){
+    if (strcmp(dir->action, actionName) != 0) continue;
+    if (type == NULL && dir->type == NULL) return dir;
+    if (type != NULL && dir->type != NULL && strcmp(dir->type, type) == 0) return dir;
+  }
+  return NULL;
+}
+
+/**
+ * Create and open a directory then add it to the registry
+ * @param parentFd : descriptor of the parent directory
+ * @param parentPath : path of the parent directory ending with '/'
+ * @param type : NULL for the directory of the action
+ * @return : the directory registered, NULL if failed
+ */
+static Directory *registerDirectory(int parentFd, const char *parentPath, const char *actionName, const char *type){
+  const char *name = type == NULL ? actionName : type;
+  Directory *dir;
+  int fd;
+
+  fd = openDirAt(parentFd, name);
+  if (fd < 0) return NULL;
+
+  dir = (Directory*)malloc(sizeof(Directory));
+  if (dir == NULL){
+    fprintf(stderr, "Allocation for new Directory failed.\n");
+    exit(1);
+  }
+  dir->action = strdup(actionName);
+  dir->type = type == NULL ? NULL : strdup(type);
+  dir->path = (char*)malloc((strlen(parentPath) + strlen(name) + 2) * sizeof(char));
+  strcpy(dir->path, parentPath);
+  strcat(dir->path, name);
+  strcat(dir->path, "/");
+  dir->fd = fd;
+  dir->next = allDirectories;
+  allDirectories = dir;
+  return dir;
+}
+
+/**
+ * Find the directory of (action, type) in the registry,
+ * create and register it (and its parents) if needed
+ * @return : the directory, NULL if it cannot be created
+ */
+static Directory *getOrRegisterDirectory(const char *actionName, const char *type){
+  Directory *typeDir, *actionDir;
+
+  typeDir = findDirectory(actionName, type);
+  if (typeDir != NULL) return typeDir;
+
+  if (dataFd < 0){
+    dataFd = openDirAt(AT_FDCWD, DATA_DIR);
+    if (dataFd < 0) return NULL;
+  }
+
+  actionDir = findDirectory(actionName, NULL);
+  if (actionDir == NULL){
+    actionDir = registerDirectory(dataFd, DATA_DIR "/", actionName, NULL);
+    if (actionDir == NULL) return NULL;
+  }
+  if (type == NULL) return actionDir;
+
+  return registerDirectory(actionDir->fd, actionDir->path, actionName, type);
+}
+
+/**
+ * Get the directory where the contents of type 'type'
+ * of an action are saved, create it if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param type : top-level MIME type of the content,
+ * NULL for the directory of the action itself
+ * @return : the path of the directory ending with '/'
+ * (owned by the registry), NULL if it cannot be created
+ */
+const char *getDirectory(const char *actionName, const char *type){
+  Directory *dir;
+
+  pthread_mutex_lock(&registryLock);
+  dir = getOrRegisterDirectory(actionName, type);
+  pthread_mutex_unlock(&registryLock);
+  //a registered directory is never moved nor freed before delDirectories
+  return dir == NULL ? NULL : dir->path;
+}
+
+/**
+ * Close all the directories and empty the registry
+ * @return : nothing
+ */
+void delDirectories(){
+  Directory *dir;
+  while (allDirectories != NULL){
+    dir = allDirectories;
+    allDirectories = dir->next;
+    close(dir->fd);
+    free(dir->action);
+    free(dir->type);
+    free(dir->path);
+    free(dir);
+  }
+  if (dataFd >= 0) close(dataFd);
+  dataFd = -1;
+}
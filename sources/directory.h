@@ -0,0 +1,49 @@
+/*
+**  Filename : directory.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Registry of the directories where the contents are saved.
+**              - The contents of an action are saved in
+**              DATA_DIR/name of action/type of content/
+**              - Each directory is created only once per run with mkdirat,
+**              relatively to the descriptor of its parent which is kept
+**              open, then remembered by the registry with the key
+**              (action, type) so later contents reuse it right away.
+**              - The registry can be used by several threads.
+*/
+#ifndef __DIRECTORY
+#define __DIRECTORY
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DATA_DIR "../data"
+
+typedef struct directory{
+  char *action;             //name of the action (spaces replaced by '_')
+  char *type;               //top-level MIME type (text, image,...)
+                            //NULL for the directory of the action itself
+  char *path;               //path of the directory ending with '/'
+  int fd;                   //descriptor of the directory
+  struct directory *next;
+}Directory;
+
+/**
+ * Get the directory where the contents of type 'type'
+ * of an action are saved, create it if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param type : top-level MIME type of the content,
+ * NULL for the directory of the action itself
+ * @return : the path of the directory ending with '/'
+ * (owned by the registry), NULL if it cannot be created
+ */
+const char *getDirectory(const char *actionName, const char *type);
+
+/**
+ * Close all the directories and empty the registry
+ * @return : nothing
+ */
+void delDirectories();
+
+#endif
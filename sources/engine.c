@@ -0,0 +1,472 @@
+/*
+**  Filename : engine.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Run the transfers of several crawls with several threads.
+**              - Each worker thread owns its own curl multi handle and runs
+**              its own transfers: download, extraction of the links, update
+**              of the trees and writing to disk all happen in the worker.
+**              - A worker takes the URLs admitted by the crawls (see
+**              admitTransfer in parse.h) into its own deque and starts them
+**              from the bottom. A worker with nothing to do steals half of
+**              the deque of another worker from the top.
+**              - The limits of the crawls (transfer slots, politeness per
+**              host) stay global: an URL holds its slot from the moment it
+**              is admitted, whichever worker runs it.
+**              - An idle worker sleeps in curl_multi_poll and is woken up
+**              with curl_multi_wakeup when there is work to steal or when
+**              the run is over.
+**              - The first worker takes the checkpoints of the crawls
+**              (checkpoint.h): at each checkpoint interval and when a
+**              signal asks for one. When a signal asks to stop, it takes
+**              one and stops the run, the crawls not over are freed with
+**              their transfers in progress.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+
+
+static void initDeque(WorkDeque *deque){
+  deque->items = (WorkItem*)malloc(DEQUE_INITIAL_SIZE * sizeof(WorkItem));
+  if (deque->items == NULL){
+    fprintf(stderr, "Allocation for deque of worker failed.\n");
+    exit(1);
+  }
+  deque->size = DEQUE_INITIAL_SIZE;
+  deque->top = 0;
+  deque->bottom = 0;
+  pthread_mutex_init(&(deque->lock), NULL);
+}
+
+/**
+ * Free a deque (the URLs left in it belong to
+ * the URLs admitted by their crawls)
+ */
+static void delDeque(WorkDeque *deque){
+  free(deque->items);
+  deque->items = NULL;
+  pthread_mutex_destroy(&(deque->lock));
+}
+
+static size_t dequeSize(WorkDeque *deque){
+  size_t res;
+
+  pthread_mutex_lock(&(deque->lock));
+  res = deque->bottom - deque->top;
+  pthread_mutex_unlock(&(deque->lock));
+  return res;
+}
+
+/**
+ * Double the size of a full deque (its lock held)
+ */
+static void growDeque(WorkDeque *deque){
+  WorkItem *items = (WorkItem*)malloc(deque->size * 2 * sizeof(WorkItem));
+  size_t nb = deque->bottom - deque->top;
+
+  if (items == NULL){
+    fprintf(stderr, "Allocation for deque of worker failed.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < nb; i++){
+    items[i] = deque->items[(deque->top + i) & (deque->size - 1)];
+  }
+  free(deque->items);
+  deque->items = items;
+  deque->size *= 2;
+  deque->top = 0;
+  deque->bottom = nb;
+}
+
+/**
+ * Add items at the bottom of a deque (by its owner)
+ */
+static void pushBottom(WorkDeque *deque, WorkItem *items, size_t nb){
+  pthread_mutex_lock(&(deque->lock));
+  while (deque->bottom - deque->top + nb > deque->size) growDeque(deque);
+  for (size_t i = 0; i < nb; i++){
+    deque->items[deque->bottom & (deque->size - 1)] = items[i];
+    deque->bottom++;
+  }
+  pthread_mutex_unlock(&(deque->lock));
+}
+
+/**
+ * Take the newest item of a deque (by its owner)
+ * @return : 1 if an item was taken, 0 if the deque is empty
+ */
+static int popBottom(WorkDeque *deque, WorkItem *item){
+  int res = 0;
+
+  pthread_mutex_lock(&(deque->lock));
+  if (deque->bottom != deque->top){
+    deque->bottom--;
+    *item = deque->items[deque->bottom & (deque->size - 1)];
+    res = 1;
+  }
+  pthread_mutex_unlock(&(deque->lock));
+  return res;
+}
+
+/**
+ * Take the oldest half of a deque (by another worker)
+ * @param items : where the items are saved (at least max items)
+ * @param max : the max nb of items to be taken
+ * @return : the nb of items taken
+ */
+static size_t stealTop(WorkDeque *deque, WorkItem *items, size_t max){
+  size_t nb;
+
+  pthread_mutex_lock(&(deque->lock));
+  nb = (deque->bottom - deque->top + 1) / 2;
+  if (nb > max) nb = max;
+  for (size_t i = 0; i < nb; i++){
+    items[i] = deque->items[deque->top & (deque->size - 1)];
+    deque->top++;
+  }
+  pthread_mutex_unlock(&(deque->lock));
+  return nb;
+}
+
+static int isDone(Engine *engine){
+  int res;
+
+  pthread_mutex_lock(&(engine->lock));
+  res = engine->done;
+  pthread_mutex_unlock(&(engine->lock));
+  return res;
+}
+
+/**
+ * Stop the run and wake all the workers up
+ */
+static void stopEngine(Engine *engine){
+  pthread_mutex_lock(&(engine->lock));
+  engine->done = 1;
+  for (int i = 0; i < engine->nbWorkers; i++){
+    curl_multi_wakeup(engine->workers[i].multi);
+  }
+  pthread_mutex_unlock(&(engine->lock));
+}
+
+/**
+ * Count a crawl as over, the run stops with the last one
+ */
+static void crawlFinished(Engine *engine){
+  int over;
+
+  pthread_mutex_lock(&(engine->lock));
+  engine->nbRunningCrawls--;
+  over = engine->nbRunningCrawls <= 0;
+  pthread_mutex_unlock(&(engine->lock));
+  if (over) stopEngine(engine);
+}
+
+/**
+ * Wake an idle worker up so it steals the URLs
+ * a worker admitted but cannot start yet
+ */
+static void wakeIdleWorker(Worker *worker){
+  Engine *engine = worker->engine;
+
+  pthread_mutex_lock(&(engine->lock));
+  for (int i = 1; i < engine->nbWorkers; i++){
+    Worker *other = engine->workers + (worker->id + i) % engine->nbWorkers;
+    if (other->idle){
+      other->idle = 0;
+      curl_multi_wakeup(other->multi);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&(engine->lock));
+}
+
+/**
+ * Admit URLs from the crawls, in turn, into the deque of a worker:
+ * as many as it can start plus a few spare ones for the others
+ */
+static void refillWorker(Worker *worker){
+  Engine *engine = worker->engine;
+  WorkItem item;
+  long long now = getTimeMs();
+  long target = engine->maxRunning - worker->nbRunning + WORKER_SPARE
+              - (long)dequeSize(&(worker->deque));
+  int nbFailed = 0;
+
+  while (target > 0 && nbFailed < engine->nbCrawls){
+    item.crawl = engine->crawls + worker->nextCrawl;
+    worker->nextCrawl = (worker->nextCrawl + 1) % engine->nbCrawls;
+    if (admitTransfer(item.crawl, now, &(item.entry), &(item.host))){
+      pushBottom(&(worker->deque), &item, 1);
+      target--;
+      nbFailed = 0;
+    }else{
+      nbFailed++;
+    }
+  }
+}
+
+/**
+ * Steal half of the deque of the first worker found with URLs waiting
+ */
+static void stealWork(Worker *worker){
+  Engine *engine = worker->engine;
+  WorkItem items[WORKER_SPARE];
+  size_t nb;
+
+  for (int i = 1; i < engine->nbWorkers; i++){
+    Worker *victim = engine->workers + (worker->id + i) % engine->nbWorkers;
+    nb = stealTop(&(victim->deque), items, WORKER_SPARE);
+    if (nb > 0){
+      pushBottom(&(worker->deque), items, nb);
+      return;
+    }
+  }
+}
+
+/**
+ * Wake the first worker up when a signal is received
+ * @param arg : the engine
+ */
+static void notifySignal(void *arg){
+  Engine *engine = (Engine*)arg;
+  curl_multi_wakeup(engine->workers[0].multi);
+}
+
+/**
+ * Take the checkpoints of the crawls if one is due or asked
+ * and stop the run if a signal asked to (by the first worker)
+ */
+static void takeCheckpoints(Engine *engine){
+  long long now = getTimeMs();
+  int nbAsked = checkpointsAsked(), stop = stopAsked();
+
+  if (!stop && nbAsked == engine->nbCheckpointsAsked
+      && (engine->nextCheckpoint < 0 || now < engine->nextCheckpoint)){
+    return;
+  }
+  engine->nbCheckpointsAsked = nbAsked;
+  for (int i = 0; i < engine->nbCrawls; i++) saveCheckpoint(engine->crawls + i);
+  if (engine->nextCheckpoint >= 0) engine->nextCheckpoint = getTimeMs() + getCheckpointInterval();
+  if (stop) stopEngine(engine);
+}
+
+/**
+ * Handle the transfers of a worker which are over
+ */
+static void readMessages(Worker *worker){
+  CURLMsg *msg;
+  CURL *ce;
+  CURLcode result;
+  int msgs_left = -1;
+  char *url;
+  Transfer *transfer;
+
+  while ((msg = curl_multi_info_read(worker->multi, &msgs_left))){
+    ce = msg->easy_handle;
+    if (msg->msg == CURLMSG_DONE) {
+      result = msg->data.result;
+      //retrieve needed infos
+      curl_easy_getinfo(ce, CURLINFO_EFFECTIVE_URL, &url);
+      curl_easy_getinfo(ce, CURLINFO_PRIVATE, &transfer);
+      //print out message
+      if (transfer->skipped){
+        fprintf(stderr, "R: %d - Not kept by the action, not downloaded <%s>\n", CURLE_OK, url);
+      }else{
+        fprintf(stderr, "R: %d - %s%s <%s>\n", result, curl_easy_strerror(result),
+                transfer->headFirst ? " (HEAD)" : "", url);
+      }
+      //the transfer goes on with a GET on the same handle
+      if (followHeadWithGet(worker->multi, ce, result)) continue;
+    }
+    else{
+      result = CURLE_FAILED_INIT;
+      fprintf(stderr, "E: CURLMsg (%d)\n", msg->msg);
+    }
+    worker->nbRunning--;
+    if (endTransfer(worker->multi, ce, result)) crawlFinished(worker->engine);
+  }
+}
+
+/**
+ * Compute how long a worker can sleep
+ * @return : the delay in ms
+ */
+static long workerTimeout(Worker *worker){
+  Engine *engine = worker->engine;
+  long timeout;
+  long long now = getTimeMs(), wait;
+
+  curl_multi_timeout(worker->multi, &timeout);
+  //a host of a crawl may become allowed to start a transfer
+  for (int i = 0; i < engine->nbCrawls; i++){
+    wait = nextAdmission(engine->crawls + i, now);
+    if (wait >= 0 && (timeout < 0 || wait < timeout)) timeout = (long)wait;
+  }
+  if (worker->id == 0 && engine->nextCheckpoint >= 0){
+    wait = engine->nextCheckpoint > now ? engine->nextCheckpoint - now : 0;
+    if (timeout < 0 || wait < timeout) timeout = (long)wait;
+  }
+  if (worker->nbRunning == 0 && (timeout < 0 || timeout > WORKER_IDLE_WAIT)){
+    //the transfers of the other workers may find URLs at any time
+    timeout = WORKER_IDLE_WAIT;
+  }
+  if (timeout < 0) timeout = 1000;
+  return timeout;
+}
+
+/**
+ * Event loop of a worker, until all the crawls are over
+ * @param arg : the worker
+ */
+static void *runWorker(void *arg){
+  Worker *worker = (Worker*)arg;
+  Engine *engine = worker->engine;
+  WorkItem item;
+  CURLMcode res;
+  int still_alive = 1;
+  long timeout;
+
+  while (!isDone(engine)){
+    refillWorker(worker);
+    if (worker->nbRunning == 0 && dequeSize(&(worker->deque)) == 0) stealWork(worker);
+    //start the URLs admitted, newest first
+    while (worker->nbRunning < engine->maxRunning && popBottom(&(worker->deque), &item)){
+      startTransfer(worker->multi, item.crawl, item.entry, item.host);
+      worker->nbRunning++;
+    }
+    if (dequeSize(&(worker->deque)) > 0) wakeIdleWorker(worker);
+
+    res = curl_multi_perform(worker->multi, &still_alive);
+    if(res != CURLM_OK) {
+      fprintf(stderr, "curl_multi failed, code %d.\n", res);
+      stopEngine(engine);
+      break;
+    }
+    readMessages(worker);
+    if (worker->id == 0) takeCheckpoints(engine);
+    if (isDone(engine)) break;
+
+    timeout = workerTimeout(worker);
+    if (timeout > 0){
+      pthread_mutex_lock(&(engine->lock));
+      worker->idle = worker->nbRunning == 0;
+      pthread_mutex_unlock(&(engine->lock));
+      curl_multi_poll(worker->multi, NULL, 0, (int)timeout, NULL);
+      pthread_mutex_lock(&(engine->lock));
+      worker->idle = 0;
+      pthread_mutex_unlock(&(engine->lock));
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Create the multi handle of a worker
+ */
+static CURLM *initWorkerMulti(Engine *engine){
+  CURLM *cm = curl_multi_init();
+  long maxHostConnections = 0;
+
+  if (cm == NULL){
+    fprintf(stderr, "Cannot initialize curl_multi.\n");
+    exit(1);
+  }
+  for (int i = 0; i < engine->nbCrawls; i++){
+    if (engine->crawls[i].task->limits.hostConnections > maxHostConnections){
+      maxHostConnections = engine->crawls[i].task->limits.hostConnections;
+    }
+  }
+  //one connection kept per transfer slot of the worker
+  curl_multi_setopt(cm, CURLMOPT_MAXCONNECTS, (long)engine->maxRunning);
+  //the frontier of a task never starts more transfers per host
+  curl_multi_setopt(cm, CURLMOPT_MAX_HOST_CONNECTIONS, maxHostConnections);
+  return cm;
+}
+
+/**
+ * Run the crawls with nbThreads worker threads
+ * until all the crawls are over
+ * @param crawls : the crawls, initialized
+ * @param nbCrawls : the number of crawls
+ * @param nbThreads : the number of worker threads (the calling
+ * thread is the only worker if nbThreads is 1)
+ * @return : nothing
+ */
+void runEngine(Crawl *crawls, int nbCrawls, int nbThreads){
+  Engine engine;
+  long maxTransfers = 0;
+
+  if (nbThreads < 1) nbThreads = 1;
+  engine.crawls = crawls;
+  engine.nbCrawls = nbCrawls;
+  engine.nbRunningCrawls = nbCrawls;
+  engine.nbWorkers = nbThreads;
+  engine.done = 0;
+  pthread_mutex_init(&(engine.lock), NULL);
+  engine.nbCheckpointsAsked = checkpointsAsked();
+  engine.nextCheckpoint = getCheckpointInterval() > 0 ? getTimeMs() + getCheckpointInterval() : -1;
+
+  for (int i = 0; i < nbCrawls; i++){
+    maxTransfers += crawls[i].maxTransfers;
+    //a crawl without any URL is over already
+    if (crawls[i].nbActive == 0 && crawls[i].frontier.nbWaiting == 0){
+      delCrawl(crawls + i);
+      engine.nbRunningCrawls--;
+    }
+  }
+  //the slots of the crawls are shared out among the workers
+  engine.maxRunning = (int)((maxTransfers + nbThreads - 1) / nbThreads);
+  if (engine.maxRunning < 1) engine.maxRunning = 1;
+  if (engine.nbRunningCrawls <= 0) engine.done = 1;
+
+  engine.workers = (Worker*)malloc(nbThreads * sizeof(Worker));
+  if (engine.workers == NULL){
+    fprintf(stderr, "Allocation for workers failed.\n");
+    exit(1);
+  }
+  for (int i = 0; i < nbThreads; i++){
+    engine.workers[i].id = i;
+    engine.workers[i].engine = &engine;
+    engine.workers[i].multi = initWorkerMulti(&engine);
+    engine.workers[i].nbRunning = 0;
+    engine.workers[i].nextCrawl = i % (nbCrawls > 0 ? nbCrawls : 1);
+    engine.workers[i].idle = 0;
+    initDeque(&(engine.workers[i].deque));
+  }
+  engine.watcher.notify = notifySignal;
+  engine.watcher.arg = &engine;
+  watchSignals(&(engine.watcher));
+
+  if (nbThreads == 1){
+    runWorker(engine.workers);
+  }else{
+    for (int i = 0; i < nbThreads; i++){
+      if (pthread_create(&(engine.workers[i].thread), NULL, runWorker, engine.workers + i) != 0){
+        fprintf(stderr, "Cannot create worker thread.\n");
+        exit(1);
+      }
+    }
+    for (int i = 0; i < nbThreads; i++){
+      pthread_join(engine.workers[i].thread, NULL);
+    }
+  }
+  unwatchSignals(&(engine.watcher));
+
+  //the crawls not over were stopped (by a signal or a failure of curl)
+  for (int i = 0; i < nbCrawls; i++){
+    if (crawls[i].finished) continue;
+    fprintf(stderr, "C: %s - stopped before its end\n", crawls[i].task->name);
+    stopCrawl(crawls + i);
+  }
+
+  for (int i = 0; i < nbThreads; i++){
+    curl_multi_cleanup(engine.workers[i].multi);
+    delDeque(&(engine.workers[i].deque));
+  }
+  free(engine.workers);
+  pthread_mutex_destroy(&(engine.lock));
+}
@@ -0,0 +1,94 @@
+/*
+**  Filename : engine.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Run the transfers of several crawls with several threads.
+**              - Each worker thread owns its own curl multi handle and runs
+**              its own transfers: download, extraction of the links, update
+**              of the trees and writing to disk all happen in the worker.
+**              - A worker takes the URLs admitted by the crawls (see
+**              admitTransfer in parse.h) into its own deque and starts them
+**              from the bottom. A worker with nothing to do steals half of
+**              the deque of another worker from the top.
+**              - The limits of the crawls (transfer slots, politeness per
+**              host) stay global: an URL holds its slot from the moment it
+**              is admitted, whichever worker runs it.
+**              - An idle worker sleeps in curl_multi_poll and is woken up
+**              with curl_multi_wakeup when there is work to steal or when
+**              the run is over.
+**              - The first worker takes the checkpoints of the crawls
+**              (checkpoint.h): at each checkpoint interval and when a
+**              signal asks for one. When a signal asks to stop, it takes
+**              one and stops the run, the crawls not over are freed with
+**              their transfers in progress.
+*/
+#ifndef __ENGINE
+#define __ENGINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "parse.h"
+#include "checkpoint.h"
+
+#define WORKER_SPARE 4            //URLs a worker admits beyond what it can start
+#define WORKER_IDLE_WAIT 100      //max ms an idle worker sleeps before looking for work
+#define DEQUE_INITIAL_SIZE 64
+
+/*An URL admitted by a crawl, waiting to be started by a worker*/
+typedef struct workItem{
+  FrontierEntry *entry;
+  FrontierHost *host;
+  Crawl *crawl;
+}WorkItem;
+
+/*Deque of a worker: its owner pushes and pops at the bottom,
+* the other workers steal from the top.
+*/
+typedef struct workDeque{
+  WorkItem *items;          //circular array
+  size_t size;              //always a power of 2
+  size_t top;               //index of the oldest item
+  size_t bottom;            //index after the newest item
+  pthread_mutex_t lock;
+}WorkDeque;
+
+typedef struct worker{
+  pthread_t thread;
+  int id;
+  struct engine *engine;
+  CURLM *multi;
+  WorkDeque deque;
+  int nbRunning;            //nb of transfers in its multi handle
+  int nextCrawl;            //crawl it admits from first (in turn)
+  int idle;                 //1 while it sleeps with nothing to do
+}Worker;
+
+typedef struct engine{
+  Crawl *crawls;
+  int nbCrawls;
+  int nbRunningCrawls;      //nb of crawls not over yet
+  Worker *workers;
+  int nbWorkers;
+  int maxRunning;           //max nb of transfers of a worker
+  int done;                 //1 once all the crawls are over (or stopped)
+  pthread_mutex_t lock;     //guards nbRunningCrawls, done and the idle flags
+  SignalWatcher watcher;    //wakes the first worker up on a signal
+  int nbCheckpointsAsked;   //checkpoints asked by signal already taken
+  long long nextCheckpoint; //time of the next checkpoint (ms), -1 if none
+}Engine;
+
+/**
+ * Run the crawls with nbThreads worker threads
+ * until all the crawls are over or a signal stops them
+ * @param crawls : the crawls, initialized
+ * @param nbCrawls : the number of crawls
+ * @param nbThreads : the number of worker threads (the calling
+ * thread is the only worker if nbThreads is 1)
+ * @return : nothing
+ */
+void runEngine(Crawl *crawls, int nbCrawls, int nbThreads);
+
+#endif
@@ -0,0 +1,308 @@
+/*
+**  Filename : extract.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Extract the links (href="..." and src="...") of an html
+**              document while it is being downloaded.
+**              - libcurl delivers the document by chunks of arbitrary size,
+**              an attribute or an URL can therefore be cut in 2 by the
+**              boundary of a chunk.
+**              - The scanner keeps the state of its search between 2 chunks
+**              (the last bytes read, the tag or the part of the URL being
+**              read) so that no link is lost.
+**              - Each URL found is handed to a callback as soon as its end
+**              (closing quote, space or '>') is read.
+**              - The href of a <base> tag is reported as such: the links
+**              of the document are relative to it instead of its URL.
+**              - The chunk is searched for the only characters which can
+**              start or end something of interest, '=', '<' and '>', 32 or
+**              16 bytes at a time with AVX2 or SSE2 (one byte at a time
+**              elsewhere). The name of the attribute is checked backwards
+**              from its '=', in any case and with spaces around '='.
+**              - The values quoted with '"' or '\'' are read, and the
+**              unquoted ones inside a tag (not those of the scripts). A value
+**              inside one chunk is handed over in place, only a value cut
+**              by the boundary of a chunk is copied.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "extract.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+
+/**
+ * Find the next '=', '<' or '>' one byte at a time
+ * @return : its position, end if there is none
+ */
+static const char *findSpecialScalar(const char *c, const char *end){
+  while (c < end && *c != '=' && *c != '<' && *c != '>') c++;
+  return c;
+}
+
+#ifdef SCAN_X86
+/**
+ * Find the next '=', '<' or '>' 16 bytes at a time
+ * (SSE2 is in every x86-64 processor)
+ */
+static const char *findSpecialSSE2(const char *c, const char *end){
+  const __m128i eq = _mm_set1_epi8('='), lt = _mm_set1_epi8('<'), gt = _mm_set1_epi8('>');
+  __m128i block;
+  int mask;
+
+  for (; end - c >= 16; c += 16){
+    block = _mm_loadu_si128((const __m128i*)c);
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, eq),
+                                                       _mm_cmpeq_epi8(block, lt)),
+                                          _mm_cmpeq_epi8(block, gt)));
+    if (mask != 0) return c + __builtin_ctz(mask);
+  }
+  return findSpecialScalar(c, end);
+}
+
+/**
+ * Find the next '=', '<' or '>' 32 bytes at a time
+ * (only called if the processor has AVX2)
+ */
+__attribute__((target("avx2")))
+static const char *findSpecialAVX2(const char *c, const char *end){
+  const __m256i eq = _mm256_set1_epi8('='), lt = _mm256_set1_epi8('<'), gt = _mm256_set1_epi8('>');
+  __m256i block;
+  unsigned mask;
+
+  //the next one is often close: the first 16 bytes cost less with SSE2
+  if (end - c >= 16){
+    __m128i head = _mm_loadu_si128((const __m128i*)c);
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(head, _mm256_castsi256_si128(eq)),
+                                                       _mm_cmpeq_epi8(head, _mm256_castsi256_si128(lt))),
+                                          _mm_cmpeq_epi8(head, _mm256_castsi256_si128(gt))));
+    if (mask != 0) return c + __builtin_ctz(mask);
+    c += 16;
+  }
+  for (; end - c >= 32; c += 32){
+    block = _mm256_loadu_si256((const __m256i*)c);
+    mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, eq),
+                                                                          _mm256_cmpeq_epi8(block, lt)),
+                                                          _mm256_cmpeq_epi8(block, gt)));
+    if (mask != 0) return c + __builtin_ctz(mask);
+  }
+  return findSpecialSSE2(c, end);
+}
+#endif
+
+/**
+ * Choose the fastest search of '=', '<' and '>' for the processor
+ * @return : the search function
+ */
+static FindSpecial chooseFindSpecial(){
+#ifdef SCAN_X86
+  return __builtin_cpu_supports("avx2") ? findSpecialAVX2 : findSpecialSSE2;
+#else
+  return findSpecialScalar;
+#endif
+}
+
+/**
+ * Initialize a scanner before feeding it the first chunk
+ * @param scanner : the scanner to be initialized
+ * @return : nothing, the scanner is modified through the pointer
+ */
+void initScanner(LinkScanner *scanner){
+  scanner->state = SCAN_TEXT;
+  scanner->lenTagName = 0;
+  scanner->inTag = 0;
+  scanner->inBase = 0;
+  scanner->valueIsBase = 0;
+  scanner->quote = '\0';
+  scanner->dropped = 0;
+  scanner->lenValue = 0;
+  scanner->lenTail = 0;
+  scanner->findSpecial = chooseFindSpecial();
+  scanner->value = (char*)malloc((MAX_URL_LENGTH + 1) * sizeof(char));
+  if (scanner->value == NULL){
+    fprintf(stderr, "Allocation for link scanner failed.\n");
+    exit(1);
+  }
+}
+
+/**
+ * Free the memory held by a scanner
+ * @param scanner : the scanner to be freed
+ * @return : nothing
+ */
+void delScanner(LinkScanner *scanner){
+  free(scanner->value);
+  scanner->value = NULL;
+}
+
+/**
+ * Get the character k bytes before pos, in the chunk or
+ * in the bytes kept from the previous ones
+ * @return : the character, '\0' if it was not kept
+ */
+static char charBefore(const LinkScanner *scanner, const char *data, const char *pos, int k){
+  if (pos - data >= k) return pos[-k];
+  k -= pos - data;
+  return k <= scanner->lenTail ? scanner->tail[scanner->lenTail - k] : '\0';
+}
+
+/**
+ * Read the name of the attribute whose '=' is at pos
+ * @return : 2 for href, 1 for src, 0 for any other name
+ */
+static int attributeBefore(const LinkScanner *scanner, const char *data, const char *pos){
+  const char *names[] = {"src", "href"};
+  int k = 1, len, i;
+
+  while (k < SCAN_TAIL_SIZE && isspace((unsigned char)charBefore(scanner, data, pos, k))) k++;
+  for (int n = 1; n >= 0; n--){
+    len = strlen(names[n]);
+    for (i = 0; i < len && tolower((unsigned char)charBefore(scanner, data, pos, k + i))
+                           == names[n][len - 1 - i]; i++);
+    if (i == len) return n + 1;
+  }
+  return 0;
+}
+
+/**
+ * Keep the last bytes of a chunk for the name of an attribute
+ * whose '=' is at the start of the next chunk
+ */
+static void keepTail(LinkScanner *scanner, const char *data, size_t size){
+  size_t kept;
+
+  if (size >= SCAN_TAIL_SIZE){
+    memcpy(scanner->tail, data + size - SCAN_TAIL_SIZE, SCAN_TAIL_SIZE);
+    scanner->lenTail = SCAN_TAIL_SIZE;
+    return;
+  }
+  kept = scanner->lenTail + size > SCAN_TAIL_SIZE ? SCAN_TAIL_SIZE - size : scanner->lenTail;
+  memmove(scanner->tail, scanner->tail + scanner->lenTail - kept, kept);
+  memcpy(scanner->tail + kept, data, size);
+  scanner->lenTail = kept + size;
+}
+
+/**
+ * Find the end of the value being read
+ * @return : the position of its closing quote (or of the space or
+ * '>' after an unquoted value), end if it is not in the chunk
+ */
+static const char *findEndOfValue(LinkScanner *scanner, const char *c, const char *end){
+  const char *res;
+
+  if (scanner->quote != '\0'){
+    res = memchr(c, scanner->quote, end - c);
+    return res == NULL ? end : res;
+  }
+  while (c < end && !isspace((unsigned char)*c) && *c != '>'){
+    //characters an unquoted value cannot hold, it is not an attribute
+    if (strchr("\"'<=`", *c) != NULL) scanner->dropped = 1;
+    c++;
+  }
+  return c;
+}
+
+/**
+ * Read the value of an attribute until its end or the end of the chunk
+ * @return : where the scan of the chunk goes on
+ */
+static const char *readValue(LinkScanner *scanner, const char *c, const char *end, URLFound onURL, void *arg){
+  const char *stop = findEndOfValue(scanner, c, end);
+  size_t len = stop - c;
+
+  if (stop == end || scanner->lenValue > 0){
+    //the URL is cut by the boundary of a chunk, its parts are copied
+    if (scanner->lenValue + len > MAX_URL_LENGTH){
+      scanner->dropped = 1;
+    }else{
+      memcpy(scanner->value + scanner->lenValue, c, len);
+      scanner->lenValue += len;
+    }
+    if (stop == end) return end;   //the URL continues in the next chunk
+    c = scanner->value;
+    len = scanner->lenValue;
+  }
+  //an URL inside the chunk is handed over in place
+  if (!scanner->dropped && len > 0 && len <= MAX_URL_LENGTH){
+    onURL(c, len, scanner->valueIsBase, arg);
+  }
+  scanner->state = SCAN_TEXT;
+  scanner->dropped = 0;
+  scanner->lenValue = 0;
+  //the '>' ending an unquoted value is read as text
+  return scanner->quote != '\0' ? stop + 1 : stop;
+}
+
+/**
+ * Scan a chunk of an html document and call onURL for
+ * each URL whose end is in this chunk
+ * @param scanner : the state of the scan of this document
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onURL : function called for each URL found
+ * @param arg : argument passed to onURL
+ * @return : nothing
+ */
+void feedScanner(LinkScanner *scanner, const char *data, size_t size, URLFound onURL, void *arg){
+  const char *c = data, *end = data + size;
+  FindSpecial findSpecial = scanner->findSpecial;
+  int attribute;
+
+  while (c < end){
+    switch (scanner->state){
+      case SCAN_TEXT:
+        c = findSpecial(c, end);
+        if (c == end) break;
+        if (*c == '<'){
+          scanner->inTag = 0;
+          scanner->inBase = 0;
+          scanner->lenTagName = 0;
+          scanner->state = SCAN_TAG_NAME;
+        }else if (*c == '>'){
+          scanner->inTag = 0;
+          scanner->inBase = 0;
+        }else if ((attribute = attributeBefore(scanner, data, c)) != 0){
+          scanner->valueIsBase = scanner->inBase && attribute == 2;
+          scanner->state = SCAN_BEFORE_VALUE;
+        }
+        c++;
+        break;
+      case SCAN_TAG_NAME:
+        //only the names up to 5 letters are read, enough to tell <base>
+        while (c < end && scanner->lenTagName < 5 && isalpha((unsigned char)*c)){
+          scanner->tagName[scanner->lenTagName++] = tolower((unsigned char)*c);
+          c++;
+        }
+        if (c == end && scanner->lenTagName < 5) break;
+        //the closing tags and the comments have no attributes
+        scanner->inTag = scanner->lenTagName > 0;
+        scanner->inBase = scanner->lenTagName == 4 && memcmp(scanner->tagName, "base", 4) == 0;
+        scanner->state = SCAN_TEXT;
+        break;
+      case SCAN_BEFORE_VALUE:
+        while (c < end && isspace((unsigned char)*c)) c++;
+        if (c == end) break;
+        if (*c == '>' || *c == '<' || *c == '='){
+          //an attribute without value
+          scanner->state = SCAN_TEXT;
+          break;
+        }
+        scanner->quote = *c == '"' || *c == '\'' ? *c : '\0';
+        if (scanner->quote != '\0') c++;
+        //the unquoted values in the scripts are code, not attributes
+        scanner->dropped = scanner->quote == '\0' && !scanner->inTag;
+        scanner->state = SCAN_VALUE;
+        break;
+      case SCAN_VALUE:
+        c = readValue(scanner, c, end, onURL, arg);
+        break;
+    }
+  }
+  keepTail(scanner, data, size);
+}
@@ -0,0 +1,97 @@
+/*
+**  Filename : extract.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Extract the links (href="..." and src="...") of an html
+**              document while it is being downloaded.
+**              - libcurl delivers the document by chunks of arbitrary size,
+**              an attribute or an URL can therefore be cut in 2 by the
+**              boundary of a chunk.
+**              - The scanner keeps the state of its search between 2 chunks
+**              (the last bytes read, the tag or the part of the URL being
+**              read) so that no link is lost.
+**              - Each URL found is handed to a callback as soon as its end
+**              (closing quote, space or '>') is read.
+**              - The href of a <base> tag is reported as such: the links
+**              of the document are relative to it instead of its URL.
+**              - The chunk is searched for the only characters which can
+**              start or end something of interest, '=', '<' and '>', 32 or
+**              16 bytes at a time with AVX2 or SSE2 (one byte at a time
+**              elsewhere). The name of the attribute is checked backwards
+**              from its '=', in any case and with spaces around '='.
+**              - The values quoted with '"' or '\'' are read, and the
+**              unquoted ones inside a tag (not those of the scripts). A value
+**              inside one chunk is handed over in place, only a value cut
+**              by the boundary of a chunk is copied.
+*/
+#ifndef __EXTRACT
+#define __EXTRACT
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//URLs longer than this are considered as garbage and dropped
+#define MAX_URL_LENGTH 2048
+//nb of bytes of the previous chunk kept to read the name of an attribute
+#define SCAN_TAIL_SIZE 16
+
+/*Function called for each URL found by the scanner.
+* The span url (len bytes, not ended by '\0') belongs to the
+* scanner or to the chunk and is only valid during the call,
+* isBase is 1 if it is the href of a <base> tag, arg is the
+* pointer given to feedScanner.
+*/
+typedef void (*URLFound)(const char *url, size_t len, int isBase, void *arg);
+
+typedef enum scanState{SCAN_TEXT, SCAN_TAG_NAME, SCAN_BEFORE_VALUE, SCAN_VALUE} ScanState;
+
+/*Search of the next '=', '<' or '>' from c,
+* it returns end if there is none
+*/
+typedef const char *(*FindSpecial)(const char *c, const char *end);
+
+typedef struct linkScanner{
+  ScanState state;
+  char tagName[5];    //start of the name of the tag being read (lowercase)
+  int lenTagName;
+  int inTag;          //1 if we are inside a tag (after its name)
+  int inBase;         //1 if we are inside a <base> tag
+  int valueIsBase;    //1 if the URL being read is the href of a <base>
+  char quote;         //closing quote of the URL being read, '\0' if unquoted
+  int dropped;        //1 if the URL being read is dropped (longer than
+                      //MAX_URL_LENGTH or not the value of an attribute)
+  char *value;        //the part of the URL read in the previous chunks
+  size_t lenValue;    //length of value
+  char tail[SCAN_TAIL_SIZE];  //last bytes of the previous chunks
+  int lenTail;
+  FindSpecial findSpecial;    //chosen for the processor
+}LinkScanner;
+
+/**
+ * Initialize a scanner before feeding it the first chunk
+ * @param scanner : the scanner to be initialized
+ * @return : nothing, the scanner is modified through the pointer
+ */
+void initScanner(LinkScanner *scanner);
+
+/**
+ * Free the memory held by a scanner
+ * @param scanner : the scanner to be freed
+ * @return : nothing
+ */
+void delScanner(LinkScanner *scanner);
+
+/**
+ * Scan a chunk of an html document and call onURL for
+ * each URL whose end is in this chunk
+ * @param scanner : the state of the scan of this document
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onURL : function called for each URL found
+ * @param arg : argument passed to onURL
+ * @return : nothing
+ */
+void feedScanner(LinkScanner *scanner, const char *data, size_t size, URLFound onURL, void *arg);
+
+#endif
@@ -0,0 +1,424 @@
+/*
+**  Filename : frontier.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Frontier of a crawl: the URLs found but not downloaded yet.
+**              - The URLs are queued by host, each host has its own queue
+**              ordered by depth (FIFO among the URLs of the same depth).
+**              An URL only costs one small block holding its string and
+**              its depth while it waits, no curl handle is created for it.
+**              - The dispatcher hands out the URLs breadth-first: among
+**              the hosts allowed to start a transfer, the one whose next
+**              URL is the least deep is served. Hosts with the same depth
+**              are served round-robin, so a host with thousands of links
+**              does not starve the other hosts (and the other actions) of
+**              the task.
+**              - The hosts allowed to start a transfer are in a heap ordered
+**              by the depth of their next URL (then by their turn), those
+**              waiting for their delay in a heap ordered by the time of
+**              their last request. A busy host is in none of them until
+**              one of its transfers is over. Handing out an URL costs
+**              O(log hosts) and the next time a host is ready is read
+**              in O(1), whatever the number of hosts.
+**              - The number of transfers in progress is bounded by the
+**              crawl (parse.h), the frontier only hands out an URL when
+**              there is a free slot.
+**              - Politeness: a host never has more than hostConnections
+**              transfers at the same time, and 2 requests to the same host
+**              are at least hostDelay milliseconds apart. Keeping a host
+**              to a few transfers keeps its pages on the same warm
+**              keep-alive connections.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frontier.h"
+
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in milliseconds
+ */
+long long getTimeMs(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Order of the heap of the hosts allowed to start a transfer:
+ * the least deep next URL first, then the host given its turn first
+ */
+static int isServedBefore(const FrontierHost *host1, const FrontierHost *host2){
+  if (host1->first->depth != host2->first->depth) return host1->first->depth < host2->first->depth;
+  return host1->turn < host2->turn;
+}
+
+/**
+ * Order of the heap of the hosts waiting for their delay:
+ * the delay is the same for all, the oldest request first
+ */
+static int isAllowedBefore(const FrontierHost *host1, const FrontierHost *host2){
+  if (host1->lastRequest != host2->lastRequest) return host1->lastRequest < host2->lastRequest;
+  return host1->turn < host2->turn;
+}
+
+static void initHeap(FrontierHeap *heap, int (*before)(const FrontierHost*, const FrontierHost*)){
+  heap->hosts = (FrontierHost**)malloc(HEAP_INITIAL_SIZE * sizeof(FrontierHost*));
+  if (heap->hosts == NULL){
+    fprintf(stderr, "Allocation for frontier failed.\n");
+    exit(1);
+  }
+  heap->nbHosts = 0;
+  heap->size = HEAP_INITIAL_SIZE;
+  heap->before = before;
+}
+
+static void setInHeap(FrontierHeap *heap, size_t i, FrontierHost *host){
+  heap->hosts[i] = host;
+  host->heapIndex = i;
+}
+
+/**
+ * Move the host at position i of a heap up to its place
+ */
+static void siftUp(FrontierHeap *heap, size_t i){
+  FrontierHost *host = heap->hosts[i];
+  size_t parent;
+
+  while (i > 0){
+    parent = (i - 1) / 2;
+    if (!heap->before(host, heap->hosts[parent])) break;
+    setInHeap(heap, i, heap->hosts[parent]);
+    i = parent;
+  }
+  setInHeap(heap, i, host);
+}
+
+/**
+ * Move the host at position i of a heap down to its place
+ */
+static void siftDown(FrontierHeap *heap, size_t i){
+  FrontierHost *host = heap->hosts[i];
+  size_t child;
+
+  while ((child = 2 * i + 1) < heap->nbHosts){
+    if (child + 1 < heap->nbHosts && heap->before(heap->hosts[child + 1], heap->hosts[child])) child++;
+    if (!heap->before(heap->hosts[child], host)) break;
+    setInHeap(heap, i, heap->hosts[child]);
+    i = child;
+  }
+  setInHeap(heap, i, host);
+}
+
+static void pushHeap(FrontierHeap *heap, FrontierHost *host){
+  if (heap->nbHosts == heap->size){
+    heap->size *= 2;
+    heap->hosts = (FrontierHost**)realloc(heap->hosts, heap->size * sizeof(FrontierHost*));
+    if (heap->hosts == NULL){
+      fprintf(stderr, "Allocation for frontier failed.\n");
+      exit(1);
+    }
+  }
+  host->heap = heap;
+  setInHeap(heap, heap->nbHosts++, host);
+  siftUp(heap, host->heapIndex);
+}
+
+/**
+ * Take the first host out of a heap
+ */
+static FrontierHost *popHeap(FrontierHeap *heap){
+  FrontierHost *host = heap->hosts[0];
+
+  heap->nbHosts--;
+  if (heap->nbHosts > 0){
+    setInHeap(heap, 0, heap->hosts[heap->nbHosts]);
+    siftDown(heap, 0);
+  }
+  host->heap = NULL;
+  return host;
+}
+
+/**
+ * Put a host with URLs waiting and a free transfer back in the heaps
+ * (it waits for its delay, even if it is over), its turn comes
+ * after those of all the hosts already queued
+ */
+static void queueHost(Frontier *frontier, FrontierHost *host){
+  if (host->heap == NULL && host->first != NULL && host->active < frontier->hostConnections){
+    host->turn = frontier->nbTurns++;
+    pushHeap(&(frontier->delayed), host);
+  }
+}
+
+static void allocBuckets(Frontier *frontier, size_t size){
+  frontier->buckets = (FrontierHost**)calloc(size, sizeof(FrontierHost*));
+  if (frontier->buckets == NULL){
+    fprintf(stderr, "Allocation for frontier failed.\n");
+    exit(1);
+  }
+  frontier->sizeBuckets = size;
+}
+
+/**
+ * Initialize an empty frontier
+ * @param frontier : the frontier to be initialized
+ * @param hostConnections : max nb of transfers to one host at the same time
+ * @param hostDelay : min nb of milliseconds between 2 requests to one host
+ * @return : nothing, the frontier is modified through the pointer
+ */
+void initFrontier(Frontier *frontier, int hostConnections, int hostDelay){
+  allocBuckets(frontier, HOSTS_INITIAL_SIZE);
+  frontier->nbHosts = 0;
+  initHeap(&(frontier->ready), isServedBefore);
+  initHeap(&(frontier->delayed), isAllowedBefore);
+  frontier->nbTurns = 0;
+  frontier->nbWaiting = 0;
+  frontier->hostConnections = hostConnections;
+  frontier->hostDelay = hostDelay;
+}
+
+/**
+ * Free an entry taken from the frontier
+ * @param entry : the entry to be freed
+ * @return : nothing
+ */
+void delFrontierEntry(FrontierEntry *entry){
+  free(entry);
+}
+
+/**
+ * Free a frontier, its hosts and the URLs still waiting
+ * @param frontier : the frontier to be freed
+ * @return : nothing
+ */
+void delFrontier(Frontier *frontier){
+  FrontierHost *host;
+  FrontierEntry *entry;
+
+  for (size_t i = 0; i < frontier->sizeBuckets; i++){
+    while ((host = frontier->buckets[i]) != NULL){
+      frontier->buckets[i] = host->nextInBucket;
+      while ((entry = host->first) != NULL){
+        host->first = entry->next;
+        delFrontierEntry(entry);
+      }
+      free(host->name);
+      free(host);
+    }
+  }
+  free(frontier->buckets);
+  free(frontier->ready.hosts);
+  free(frontier->delayed.hosts);
+  frontier->buckets = NULL;
+  frontier->ready.hosts = NULL;
+  frontier->delayed.hosts = NULL;
+  frontier->nbHosts = 0;
+  frontier->ready.nbHosts = 0;
+  frontier->delayed.nbHosts = 0;
+  frontier->nbWaiting = 0;
+}
+
+static size_t hashHost(const char *name, size_t len){
+  size_t h = 2166136261U;
+  for (size_t i = 0; i < len; i++){
+    h = (h ^ (unsigned char)name[i]) * 16777619U;
+  }
+  return h;
+}
+
+/**
+ * Find the host part (host[:port]) of an URL
+ * @param len : where the length of the host is saved
+ * @return : the pointer to the first character of the host
+ */
+static const char *findHost(const char *url, size_t *len){
+  const char *start = strstr(url, "://");
+  start = start == NULL ? url : start + 3;
+  *len = strcspn(start, "/?#");
+  return start;
+}
+
+/**
+ * Double the number of buckets of the table of hosts
+ */
+static void growHosts(Frontier *frontier){
+  FrontierHost **oldBuckets = frontier->buckets, *host;
+  size_t oldSize = frontier->sizeBuckets, idx;
+
+  allocBuckets(frontier, oldSize * 2);
+  for (size_t i = 0; i < oldSize; i++){
+    while ((host = oldBuckets[i]) != NULL){
+      oldBuckets[i] = host->nextInBucket;
+      idx = hashHost(host->name, strlen(host->name)) & (frontier->sizeBuckets - 1);
+      host->nextInBucket = frontier->buckets[idx];
+      frontier->buckets[idx] = host;
+    }
+  }
+  free(oldBuckets);
+}
+
+/**
+ * Find the host of an URL in the table, add it if it is new
+ */
+static FrontierHost *getHost(Frontier *frontier, const char *url){
+  size_t len, idx;
+  const char *name = findHost(url, &len);
+  FrontierHost *host;
+
+  idx = hashHost(name, len) & (frontier->sizeBuckets - 1);
+  for (host = frontier->buckets[idx]; host != NULL; host = host->nextInBucket){
+    if (strncmp(host->name, name, len) == 0 && host->name[len] == '\0') return host;
+  }
+
+  host = (FrontierHost*)malloc(sizeof(FrontierHost));
+  if (host == NULL){
+    fprintf(stderr, "Allocation for new host of the frontier failed.\n");
+    exit(1);
+  }
+  host->name = strndup(name, len);
+  host->first = NULL;
+  host->last = NULL;
+  host->active = 0;
+  host->lastRequest = -(long long)frontier->hostDelay;
+  host->turn = 0;
+  host->heap = NULL;
+  host->heapIndex = 0;
+  host->nextInBucket = frontier->buckets[idx];
+  frontier->buckets[idx] = host;
+  frontier->nbHosts++;
+  if (frontier->nbHosts > frontier->sizeBuckets) growHosts(frontier);
+  return host;
+}
+
+/**
+ * Add an URL in the queue of its host, after all the
+ * URLs of the same depth or less
+ * @param frontier : the frontier
+ * @param url : the absolute URL (copied)
+ * @param depth : the depth of the URL from the initial URL
+ * @param kind : what the URL is for its owner, given back by popFrontier
+ * @param owner : what the URL belongs to, given back by popFrontier
+ * @return : nothing
+ */
+void pushFrontier(Frontier *frontier, const char *url, int depth, int kind, void *owner){
+  size_t len = strlen(url);
+  FrontierEntry *entry = (FrontierEntry*)malloc(sizeof(FrontierEntry) + len + 1);
+  FrontierEntry **prev;
+  FrontierHost *host;
+
+  if (entry == NULL){
+    fprintf(stderr, "Allocation for new entry of the frontier failed.\n");
+    exit(1);
+  }
+  host = getHost(frontier, url);
+  memcpy(entry->url, url, len + 1);
+  entry->depth = depth;
+  entry->kind = kind;
+  entry->owner = owner;
+  entry->next = NULL;
+  entry->prev = NULL;
+
+  if (host->last == NULL || host->last->depth <= depth){
+    //links are mostly found in breadth-first order
+    if (host->last == NULL) host->first = entry;
+    else host->last->next = entry;
+    host->last = entry;
+  }else{
+    for (prev = &(host->first); (*prev)->depth <= depth; prev = &((*prev)->next));
+    entry->next = *prev;
+    *prev = entry;
+  }
+  frontier->nbWaiting++;
+
+  if (host->heap == &(frontier->ready) && host->first == entry){
+    //its next URL is less deep, it is served sooner
+    siftUp(&(frontier->ready), host->heapIndex);
+  }else{
+    queueHost(frontier, host);
+  }
+}
+
+/**
+ * Take the least deep URL which can be downloaded now, the hosts
+ * with the same depth are served in turn. The host of the URL counts
+ * it as one of its transfers until doneFrontier is called.
+ * @param frontier : the frontier
+ * @param now : the current time (ms)
+ * @param host : where the host of the URL is saved
+ * @return : the entry of the URL (to be freed with delFrontierEntry)
+ *           NULL if no host can start a transfer now
+ */
+FrontierEntry *popFrontier(Frontier *frontier, long long now, FrontierHost **host){
+  FrontierHost *best;
+  FrontierEntry *entry;
+
+  //the hosts whose delay is over get their turn
+  while (frontier->delayed.nbHosts > 0
+         && now - frontier->delayed.hosts[0]->lastRequest >= frontier->hostDelay){
+    pushHeap(&(frontier->ready), popHeap(&(frontier->delayed)));
+  }
+  if (frontier->ready.nbHosts == 0) return NULL;
+
+  best = popHeap(&(frontier->ready));
+  entry = best->first;
+  best->first = entry->next;
+  if (best->first == NULL) best->last = NULL;
+  entry->next = NULL;
+  best->active++;
+  best->lastRequest = now;
+  frontier->nbWaiting--;
+  //served after the hosts of the same depth
+  queueHost(frontier, best);
+  *host = best;
+  return entry;
+}
+
+/**
+ * Tell the frontier a transfer of a host is over
+ * @param frontier : the frontier
+ * @param host : the host of the transfer
+ * @return : nothing
+ */
+void doneFrontier(Frontier *frontier, FrontierHost *host){
+  if (host->active > 0) host->active--;
+  queueHost(frontier, host);
+}
+
+/**
+ * Call a function on each URL waiting in the frontier
+ * @param frontier : the frontier
+ * @param visit : the function called with each entry and arg
+ * @param arg : given to visit
+ * @return : nothing
+ */
+void browseFrontier(Frontier *frontier, void (*visit)(FrontierEntry *entry, void *arg), void *arg){
+  for (size_t i = 0; i < frontier->sizeBuckets; i++){
+    for (FrontierHost *host = frontier->buckets[i]; host != NULL; host = host->nextInBucket){
+      for (FrontierEntry *entry = host->first; entry != NULL; entry = entry->next){
+        visit(entry, arg);
+      }
+    }
+  }
+}
+
+/**
+ * Compute how long until a host with URLs waiting
+ * is allowed to start a transfer again
+ * @param frontier : the frontier
+ * @param now : the current time (ms)
+ * @return : the delay in ms, 0 if a host is ready
+ *           -1 if no host can be ready by waiting (no URL waiting
+ *           or all the hosts with URLs waiting are busy)
+ */
+long long nextDispatchFrontier(Frontier *frontier, long long now){
+  long long wait;
+
+  if (frontier->ready.nbHosts > 0) return 0;
+  if (frontier->delayed.nbHosts == 0) return -1;
+  wait = frontier->delayed.hosts[0]->lastRequest + frontier->hostDelay - now;
+  return wait < 0 ? 0 : wait;
+}
@@ -0,0 +1,170 @@
+/*
+**  Filename : frontier.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Frontier of a crawl: the URLs found but not downloaded yet.
+**              - The URLs are queued by host, each host has its own queue
+**              ordered by depth (FIFO among the URLs of the same depth).
+**              An URL only costs one small block holding its string and
+**              its depth while it waits, no curl handle is created for it.
+**              - The dispatcher hands out the URLs breadth-first: among
+**              the hosts allowed to start a transfer, the one whose next
+**              URL is the least deep is served. Hosts with the same depth
+**              are served round-robin, so a host with thousands of links
+**              does not starve the other hosts (and the other actions) of
+**              the task.
+**              - The hosts allowed to start a transfer are in a heap ordered
+**              by the depth of their next URL (then by their turn), those
+**              waiting for their delay in a heap ordered by the time of
+**              their last request. A busy host is in none of them until
+**              one of its transfers is over. Handing out an URL costs
+**              O(log hosts) and the next time a host is ready is read
+**              in O(1), whatever the number of hosts.
+**              - The number of transfers in progress is bounded by the
+**              crawl (parse.h), the frontier only hands out an URL when
+**              there is a free slot.
+**              - Politeness: a host never has more than hostConnections
+**              transfers at the same time, and 2 requests to the same host
+**              are at least hostDelay milliseconds apart. Keeping a host
+**              to a few transfers keeps its pages on the same warm
+**              keep-alive connections.
+*/
+#ifndef __FRONTIER
+#define __FRONTIER
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOSTS_INITIAL_SIZE 64     //initial nb of buckets of the table of hosts
+#define HEAP_INITIAL_SIZE 64      //initial nb of hosts of a heap of hosts
+
+/*An URL waiting in the queue of its host,
+* allocated in one block with its string
+*/
+typedef struct frontierEntry{
+  struct frontierEntry *next;
+  struct frontierEntry *prev;     //only used once the URL left the frontier
+  void *owner;                    //what the URL belongs to (its action)
+  int depth;
+  int kind;                       //what the URL is for its owner
+  char url[];
+}FrontierEntry;
+
+struct frontierHost;
+
+/*Binary heap of hosts, the first host is the one before all the others*/
+typedef struct frontierHeap{
+  struct frontierHost **hosts;
+  size_t nbHosts;
+  size_t size;
+  int (*before)(const struct frontierHost *host1, const struct frontierHost *host2);
+}FrontierHeap;
+
+/*A host of the frontier with its queue of URLs*/
+typedef struct frontierHost{
+  char *name;                     //host[:port] of the URLs
+  FrontierEntry *first;           //queue of the URLs of this host
+  FrontierEntry *last;            //sorted by depth
+  int active;                     //nb of transfers of this host in progress
+  long long lastRequest;          //time (ms) of the last request to this host
+  unsigned long long turn;        //order of the hosts of the same depth
+  FrontierHeap *heap;             //heap the host is in, NULL if none
+  size_t heapIndex;               //position of the host in its heap
+  struct frontierHost *nextInBucket;
+}FrontierHost;
+
+typedef struct frontier{
+  FrontierHost **buckets;         //table of all the hosts met
+  size_t sizeBuckets;
+  size_t nbHosts;
+  FrontierHeap ready;             //hosts with URLs allowed to start a transfer
+  FrontierHeap delayed;           //hosts with URLs waiting for their delay
+  unsigned long long nbTurns;     //nb of turns given to the hosts
+  size_t nbWaiting;               //nb of URLs waiting
+  int hostConnections;
+  int hostDelay;
+}Frontier;
+
+/**
+ * Get the current time of a monotonic clock
+ * @return : the time in milliseconds
+ */
+long long getTimeMs();
+
+/**
+ * Initialize an empty frontier
+ * @param frontier : the frontier to be initialized
+ * @param hostConnections : max nb of transfers to one host at the same time
+ * @param hostDelay : min nb of milliseconds between 2 requests to one host
+ * @return : nothing, the frontier is modified through the pointer
+ */
+void initFrontier(Frontier *frontier, int hostConnections, int hostDelay);
+
+/**
+ * Free a frontier, its hosts and the URLs still waiting
+ * @param frontier : the frontier to be freed
+ * @return : nothing
+ */
+void delFrontier(Frontier *frontier);
+
+/**
+ * Add an URL in the queue of its host, after all the
+ * URLs of the same depth or less
+ * @param frontier : the frontier
+ * @param url : the absolute URL (copied)
+ * @param depth : the depth of the URL from the initial URL
+ * @param kind : what the URL is for its owner, given back by popFrontier
+ * @param owner : what the URL belongs to, given back by popFrontier
+ * @return : nothing
+ */
+void pushFrontier(Frontier *frontier, const char *url, int depth, int kind, void *owner);
+
+/**
+ * Take the least deep URL which can be downloaded now, the hosts
+ * with the same depth are served in turn. The host of the URL counts
+ * it as one of its transfers until doneFrontier is called.
+ * @param frontier : the frontier
+ * @param now : the current time (ms)
+ * @param host : where the host of the URL is saved
+ * @return : the entry of the URL (to be freed with delFrontierEntry)
+ *           NULL if no host can start a transfer now
+ */
+FrontierEntry *popFrontier(Frontier *frontier, long long now, FrontierHost **host);
+
+/**
+ * Tell the frontier a transfer of a host is over
+ * @param frontier : the frontier
+ * @param host : the host of the transfer
+ * @return : nothing
+ */
+void doneFrontier(Frontier *frontier, FrontierHost *host);
+
+/**
+ * Compute how long until a host with URLs waiting
+ * is allowed to start a transfer again
+ * @param frontier : the frontier
+ * @param now : the current time (ms)
+ * @return : the delay in ms, 0 if a host is ready
+ *           -1 if no host can be ready by waiting (no URL waiting
+ *           or all the hosts with URLs waiting are busy)
+ */
+long long nextDispatchFrontier(Frontier *frontier, long long now);
+
+/**
+ * Call a function on each URL waiting in the frontier
+ * @param frontier : the frontier
+ * @param visit : the function called with each entry and arg
+ * @param arg : given to visit
+ * @return : nothing
+ */
+void browseFrontier(Frontier *frontier, void (*visit)(FrontierEntry *entry, void *arg), void *arg);
+
+/**
+ * Free an entry taken from the frontier
+ * @param entry : the entry to be freed
+ * @return : nothing
+ */
+void delFrontierEntry(FrontierEntry *entry);
+
+#endif
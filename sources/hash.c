@@ -0,0 +1,131 @@
+/*
+**  Filename : hash.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : SHA-256 of the contents downloaded (FIPS 180-4).
+**              - The hash is computed chunk by chunk while the content
+**              is downloaded, the content is never read back.
+**              - The digest is saved in hexadecimal in the metadata
+**              of the URLs to tell if a content has changed.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * Initialize the hash of a new content
+ * @param ctx : the hash to be initialized
+ * @return : nothing
+ */
+void initSha256(Sha256 *ctx){
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->length = 0;
+  ctx->lenBlock = 0;
+}
+
+/**
+ * Hash one block of 64 bytes
+ */
+static void hashBlock(Sha256 *ctx, const unsigned char *block){
+  uint32_t w[64], s[8], t1, t2;
+
+  for (int i = 0; i < 16; i++){
+    w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16
+         | (uint32_t)block[4 * i + 2] << 8 | (uint32_t)block[4 * i + 3];
+  }
+  for (int i = 16; i < 64; i++){
+    w[i] = w[i - 16] + (ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3))
+         + w[i - 7] + (ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+  }
+  memcpy(s, ctx->state, sizeof(s));
+  for (int i = 0; i < 64; i++){
+    t1 = s[7] + (ROTR(s[4], 6) ^ ROTR(s[4], 11) ^ ROTR(s[4], 25))
+       + ((s[4] & s[5]) ^ (~s[4] & s[6])) + K[i] + w[i];
+    t2 = (ROTR(s[0], 2) ^ ROTR(s[0], 13) ^ ROTR(s[0], 22))
+       + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+    memmove(s + 1, s, 7 * sizeof(uint32_t));
+    s[4] += t1;
+    s[0] = t1 + t2;
+  }
+  for (int i = 0; i < 8; i++) ctx->state[i] += s[i];
+}
+
+/**
+ * Add a chunk of content to the hash
+ * @param ctx : the hash
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @return : nothing
+ */
+void updateSha256(Sha256 *ctx, const void *data, size_t size){
+  const unsigned char *bytes = (const unsigned char*)data;
+  size_t n;
+
+  ctx->length += size;
+  if (ctx->lenBlock > 0){
+    n = 64 - ctx->lenBlock < size ? 64 - ctx->lenBlock : size;
+    memcpy(ctx->block + ctx->lenBlock, bytes, n);
+    ctx->lenBlock += n;
+    bytes += n;
+    size -= n;
+    if (ctx->lenBlock < 64) return;
+    hashBlock(ctx, ctx->block);
+    ctx->lenBlock = 0;
+  }
+  //the full blocks are hashed right from the chunk
+  for (; size >= 64; bytes += 64, size -= 64) hashBlock(ctx, bytes);
+  memcpy(ctx->block, bytes, size);
+  ctx->lenBlock = size;
+}
+
+/**
+ * Finish the hash and write its digest in hexadecimal
+ * @param ctx : the hash (cannot be updated anymore)
+ * @param hex : where the digest is written (SHA256_HEX_SIZE bytes)
+ * @return : nothing
+ */
+void finalSha256(Sha256 *ctx, char *hex){
+  static const char digits[] = "0123456789abcdef";
+  uint64_t bits = ctx->length * 8;
+  unsigned char byte;
+
+  //padding: 0x80, zeros then the length in bits on 8 bytes
+  ctx->block[ctx->lenBlock++] = 0x80;
+  if (ctx->lenBlock > 56){
+    memset(ctx->block + ctx->lenBlock, 0, 64 - ctx->lenBlock);
+    hashBlock(ctx, ctx->block);
+    ctx->lenBlock = 0;
+  }
+  memset(ctx->block + ctx->lenBlock, 0, 56 - ctx->lenBlock);
+  for (int i = 0; i < 8; i++) ctx->block[63 - i] = (unsigned char)(bits >> (8 * i));
+  hashBlock(ctx, ctx->block);
+
+  for (int i = 0; i < SHA256_SIZE; i++){
+    byte = (unsigned char)(ctx->state[i / 4] >> (24 - 8 * (i % 4)));
+    hex[2 * i] = digits[byte >> 4];
+    hex[2 * i + 1] = digits[byte & 0xf];
+  }
+  hex[2 * SHA256_SIZE] = '\0';
+}
@@ -0,0 +1,53 @@
+/*
+**  Filename : hash.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : SHA-256 of the contents downloaded (FIPS 180-4).
+**              - The hash is computed chunk by chunk while the content
+**              is downloaded, the content is never read back.
+**              - The digest is saved in hexadecimal in the metadata
+**              of the URLs to tell if a content has changed.
+*/
+#ifndef __HASH
+#define __HASH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define SHA256_SIZE 32                      //size of a digest in bytes
+#define SHA256_HEX_SIZE (2 * SHA256_SIZE + 1) //size of a digest in hexadecimal with '\0'
+
+typedef struct sha256{
+  uint32_t state[8];
+  uint64_t length;          //nb of bytes hashed
+  unsigned char block[64];  //block not full yet
+  size_t lenBlock;
+}Sha256;
+
+/**
+ * Initialize the hash of a new content
+ * @param ctx : the hash to be initialized
+ * @return : nothing
+ */
+void initSha256(Sha256 *ctx);
+
+/**
+ * Add a chunk of content to the hash
+ * @param ctx : the hash
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @return : nothing
+ */
+void updateSha256(Sha256 *ctx, const void *data, size_t size);
+
+/**
+ * Finish the hash and write its digest in hexadecimal
+ * @param ctx : the hash (cannot be updated anymore)
+ * @param hex : where the digest is written (SHA256_HEX_SIZE bytes)
+ * @return : nothing
+ */
+void finalSha256(Sha256 *ctx, char *hex);
+
+#endif
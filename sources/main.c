@@ -7,19 +7,52 @@
 #include "url.h"
 #include "configuration.h"
 #include "parse.h"
+#include "directory.h"
+#include "network.h"
+#include "scheduler.h"
+#include "metastore.h"
+#include "checkpoint.h"
 
  
-int main(void)
+int main(int argc, char **argv)
 {
-  char *configName = writeConfig();
+  int nbThreads = 1, daemon = 0;
+  char *mimeFile = NULL;
+  int opt;
+
+  //-d : run the tasks at their intervals (TimeLaunch)
+  //-j N : number of threads running the transfers
+  //-c N : seconds between 2 checkpoints of a run, 0 for on signal only
+  //-m file : MIME types overriding those built in (mime.types format)
+  while ((opt = getopt(argc, argv, "dj:c:m:")) != -1){
+    if (opt == 'd') daemon = 1;
+    else if (opt == 'j' && atoi(optarg) > 0) nbThreads = atoi(optarg);
+    else if (opt == 'c' && atoi(optarg) >= 0) setCheckpointInterval(atoi(optarg));
+    else if (opt == 'm') mimeFile = optarg;
+    else{
+      fprintf(stderr, "Usage : %s [-d] [-j nbThreads] [-c seconds] [-m mime.types] [configuration.sconf]\n", argv[0]);
+      return 1;
+    }
+  }
+  //before any thread: SIGINT/SIGTERM/SIGUSR1 only go to the thread of the signals
+  initSignals();
+
+  //the configuration is written interactively if none is given
+  char *configName = optind < argc ? strdup(argv[optind]) : writeConfig();
   Configure *config = readConfigure(configName);
-  allMIMEs = initAllMIME();
+  //in daemon mode the runs of several tasks may be in progress at once
+  initNetwork(daemon ? nbThreads * config->nbTask : nbThreads);
+  initAllMIME(mimeFile);
 
-  parseConfig(config);
+  if (daemon) runScheduler(config, nbThreads, NULL);
+  else parseConfig(config, nbThreads);
 
   delConfigure(&config);
-  delAllMIME(allMIMEs);
+  delAllMIME();
+  delMetaStores();
+  delDirectories();
+  delNetwork();
   free(configName);
   
   return 0;
-} 
\ No newline at end of file
+} 
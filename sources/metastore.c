@@ -0,0 +1,383 @@
+/*
+**  Filename : metastore.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Metadata of the contents saved by an action, kept from
+**              one run to the next.
+**              - For each URL whose content was saved: its ETag, its
+**              Last-Modified date, its content type, the file where it
+**              was saved, where it starts in this file, its length, its
+**              SHA-256 and its encoding if it was saved compressed.
+**              - The next runs send If-None-Match/If-Modified-Since with
+**              these values, the server answers 304 and sends nothing if
+**              the content has not changed.
+**              - The store of an action is loaded from the file
+**              DATA_DIR/name of action/METADATA_FILE the first time it is
+**              needed and written back at the end of each run.
+**              - The stores can be used by several threads.
+**
+**              The file has one line per URL, its fields are separated
+**              by tabs: url, etag, last-modified, content type, file,
+**              offset, length, sha-256, encoding (missing in the files
+**              of the first versions, read as "").
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metastore.h"
+#include "directory.h"
+
+#define NB_FIELDS 9
+
+static MetaStore *allStores = NULL;
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static size_t hashURL(const char *url){
+  size_t h = 2166136261U;
+  for (; *url != '\0'; url++){
+    h = (h ^ (unsigned char)*url) * 16777619U;
+  }
+  return h;
+}
+
+static void allocBuckets(MetaStore *store, size_t size){
+  store->buckets = (URLRecord**)calloc(size, sizeof(URLRecord*));
+  if (store->buckets == NULL){
+    fprintf(stderr, "Allocation for metadata store failed.\n");
+    exit(1);
+  }
+  store->sizeBuckets = size;
+}
+
+/**
+ * Double the number of buckets of a store
+ */
+static void growStore(MetaStore *store){
+  URLRecord **oldBuckets = store->buckets, *record;
+  size_t oldSize = store->sizeBuckets, idx;
+
+  allocBuckets(store, oldSize * 2);
+  for (size_t i = 0; i < oldSize; i++){
+    while ((record = oldBuckets[i]) != NULL){
+      oldBuckets[i] = record->next;
+      idx = hashURL(record->url) & (store->sizeBuckets - 1);
+      record->next = store->buckets[idx];
+      store->buckets[idx] = record;
+    }
+  }
+  free(oldBuckets);
+}
+
+/**
+ * Create an empty record
+ * @param url : the URL of the record (copied)
+ * @return : the record
+ */
+URLRecord *initRecord(const char *url){
+  URLRecord *res = (URLRecord*)malloc(sizeof(URLRecord));
+  if (res == NULL){
+    fprintf(stderr, "Allocation for new URLRecord failed.\n");
+    exit(1);
+  }
+  res->url = strdup(url);
+  res->etag = strdup("");
+  res->lastModified = strdup("");
+  res->contentType = strdup("");
+  res->contentEncoding = strdup("");
+  res->filePath = strdup("");
+  res->offset = 0;
+  res->length = 0;
+  res->hash[0] = '\0';
+  res->next = NULL;
+  return res;
+}
+
+/**
+ * Free a record
+ * @param record : the record to be freed
+ * @return : nothing
+ */
+void delRecord(URLRecord **record){
+  free((*record)->url);
+  free((*record)->etag);
+  free((*record)->lastModified);
+  free((*record)->contentType);
+  free((*record)->contentEncoding);
+  free((*record)->filePath);
+  free(*record);
+  *record = NULL;
+}
+
+static URLRecord *copyRecord(URLRecord *record){
+  URLRecord *res = (URLRecord*)malloc(sizeof(URLRecord));
+  if (res == NULL){
+    fprintf(stderr, "Allocation for new URLRecord failed.\n");
+    exit(1);
+  }
+  *res = *record;
+  res->url = strdup(record->url);
+  res->etag = strdup(record->etag);
+  res->lastModified = strdup(record->lastModified);
+  res->contentType = strdup(record->contentType);
+  res->contentEncoding = strdup(record->contentEncoding);
+  res->filePath = strdup(record->filePath);
+  res->next = NULL;
+  return res;
+}
+
+/**
+ * Find a record in a store (its lock held)
+ * @param prev : where the link to the record is saved
+ */
+static URLRecord *lookupRecord(MetaStore *store, const char *url, URLRecord ***prev){
+  URLRecord **link = &(store->buckets[hashURL(url) & (store->sizeBuckets - 1)]);
+
+  for (; *link != NULL; link = &((*link)->next)){
+    if (strcmp((*link)->url, url) == 0) break;
+  }
+  *prev = link;
+  return *link;
+}
+
+/**
+ * Look for the record of an URL
+ * @param store : the store
+ * @param url : the URL
+ * @return : a copy of the record (to be freed with delRecord),
+ *           NULL if the URL has no record
+ */
+URLRecord *findRecord(MetaStore *store, const char *url){
+  URLRecord *record, **prev;
+
+  pthread_mutex_lock(&(store->lock));
+  record = lookupRecord(store, url, &prev);
+  if (record != NULL) record = copyRecord(record);
+  pthread_mutex_unlock(&(store->lock));
+  return record;
+}
+
+/**
+ * Replace the tabs and the ends of line of a field,
+ * they separate the fields in the file
+ */
+static void cleanField(char *field){
+  for (; *field != '\0'; field++){
+    if (*field == '\t' || *field == '\n' || *field == '\r') *field = ' ';
+  }
+}
+
+/**
+ * Add a record to a store (its lock held)
+ */
+static void putRecord(MetaStore *store, URLRecord *record){
+  URLRecord *old, **prev;
+
+  old = lookupRecord(store, record->url, &prev);
+  if (old != NULL){
+    record->next = old->next;
+    *prev = record;
+    delRecord(&old);
+    return;
+  }
+  record->next = NULL;
+  *prev = record;
+  store->nbRecords++;
+  if (store->nbRecords > store->sizeBuckets) growStore(store);
+}
+
+/**
+ * Add the record of an URL, the old one is replaced
+ * @param store : the store
+ * @param record : the record (the store takes its ownership)
+ * @return : nothing
+ */
+void updateRecord(MetaStore *store, URLRecord *record){
+  cleanField(record->url);
+  cleanField(record->etag);
+  cleanField(record->lastModified);
+  cleanField(record->contentType);
+  cleanField(record->contentEncoding);
+  cleanField(record->filePath);
+
+  pthread_mutex_lock(&(store->lock));
+  putRecord(store, record);
+  store->modified = 1;
+  pthread_mutex_unlock(&(store->lock));
+}
+
+/**
+ * Remove the record of an URL, if it has one
+ * @param store : the store
+ * @param url : the URL
+ * @return : nothing
+ */
+void removeRecord(MetaStore *store, const char *url){
+  URLRecord *record, **prev;
+
+  pthread_mutex_lock(&(store->lock));
+  record = lookupRecord(store, url, &prev);
+  if (record != NULL){
+    *prev = record->next;
+    delRecord(&record);
+    store->nbRecords--;
+    store->modified = 1;
+  }
+  pthread_mutex_unlock(&(store->lock));
+}
+
+/**
+ * Read the records of a store from its file, if it exists
+ */
+static void loadMetaStore(MetaStore *store){
+  char *path, *line = NULL, *cursor, *fields[NB_FIELDS];
+  size_t size = 0, len;
+  URLRecord *record;
+  FILE *f;
+  int nb;
+
+  path = (char*)malloc(strlen(DATA_DIR) + strlen(store->action) + strlen(METADATA_FILE) + 3);
+  sprintf(path, "%s/%s/%s", DATA_DIR, store->action, METADATA_FILE);
+  f = fopen(path, "r");
+  free(path);
+  if (f == NULL) return;    //first run of the action
+
+  while (getline(&line, &size, f) != -1){
+    len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+    cursor = line;
+    for (nb = 0; nb < NB_FIELDS && cursor != NULL; nb++) fields[nb] = strsep(&cursor, "\t");
+    if (nb < NB_FIELDS - 1 || strlen(fields[7]) >= SHA256_HEX_SIZE) continue;  //damaged line
+
+    record = initRecord(fields[0]);
+    free(record->etag);
+    free(record->lastModified);
+    free(record->contentType);
+    free(record->filePath);
+    record->etag = strdup(fields[1]);
+    record->lastModified = strdup(fields[2]);
+    record->contentType = strdup(fields[3]);
+    record->filePath = strdup(fields[4]);
+    record->offset = atol(fields[5]);
+    record->length = atol(fields[6]);
+    strcpy(record->hash, fields[7]);
+    if (nb == NB_FIELDS){
+      free(record->contentEncoding);
+      record->contentEncoding = strdup(fields[8]);
+    }
+    putRecord(store, record);
+  }
+  free(line);
+  fclose(f);
+}
+
+/**
+ * Get the store of an action, load it from its file the first time
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the store (owned by the registry of the stores)
+ */
+MetaStore *getMetaStore(const char *actionName){
+  MetaStore *store;
+
+  pthread_mutex_lock(&registryLock);
+  for (store = allStores; store != NULL; store = store->next){
+    if (strcmp(store->action, actionName) == 0) break;
+  }
+  if (store == NULL){
+    store = (MetaStore*)malloc(sizeof(MetaStore));
+    if (store == NULL){
+      fprintf(stderr, "Allocation for metadata store failed.\n");
+      exit(1);
+    }
+    store->action = strdup(actionName);
+    allocBuckets(store, METASTORE_INITIAL_SIZE);
+    store->nbRecords = 0;
+    store->modified = 0;
+    pthread_mutex_init(&(store->lock), NULL);
+    loadMetaStore(store);
+    store->next = allStores;
+    allStores = store;
+  }
+  pthread_mutex_unlock(&registryLock);
+  return store;
+}
+
+/**
+ * Write a store in its file if it has changed
+ * @param store : the store
+ * @return : 0 if succeeded, -1 if not
+ */
+int saveMetaStore(MetaStore *store){
+  const char *dirPath;
+  char *path, *tmpPath;
+  URLRecord *record;
+  FILE *f;
+  int res = 0;
+
+  pthread_mutex_lock(&(store->lock));
+  if (!store->modified){
+    pthread_mutex_unlock(&(store->lock));
+    return 0;
+  }
+  dirPath = getDirectory(store->action, NULL);
+  if (dirPath == NULL){
+    pthread_mutex_unlock(&(store->lock));
+    return -1;
+  }
+  path = (char*)malloc(strlen(dirPath) + strlen(METADATA_FILE) + 1);
+  tmpPath = (char*)malloc(strlen(dirPath) + strlen(METADATA_FILE) + 5);
+  sprintf(path, "%s%s", dirPath, METADATA_FILE);
+  sprintf(tmpPath, "%s.tmp", path);
+
+  //written aside then renamed, the old file stays whole if the write fails
+  f = fopen(tmpPath, "w");
+  if (f == NULL){
+    fprintf(stderr, "Cannot open file %s\n", tmpPath);
+    res = -1;
+  }else{
+    for (size_t i = 0; i < store->sizeBuckets; i++){
+      for (record = store->buckets[i]; record != NULL; record = record->next){
+        fprintf(f, "%s\t%s\t%s\t%s\t%s\t%ld\t%ld\t%s\t%s\n", record->url, record->etag,
+                record->lastModified, record->contentType, record->filePath,
+                record->offset, record->length, record->hash, record->contentEncoding);
+      }
+    }
+    if (fclose(f) != 0 || rename(tmpPath, path) != 0){
+      fprintf(stderr, "Cannot write file %s\n", path);
+      res = -1;
+    }else{
+      store->modified = 0;
+    }
+  }
+  pthread_mutex_unlock(&(store->lock));
+  free(path);
+  free(tmpPath);
+  return res;
+}
+
+/**
+ * Free all the stores (without writing them)
+ * @return : nothing
+ */
+void delMetaStores(){
+  MetaStore *store;
+  URLRecord *record;
+
+  pthread_mutex_lock(&registryLock);
+  while (allStores != NULL){
+    store = allStores;
+    allStores = store->next;
+    for (size_t i = 0; i < store->sizeBuckets; i++){
+      while ((record = store->buckets[i]) != NULL){
+        store->buckets[i] = record->next;
+        delRecord(&record);
+      }
+    }
+    free(store->buckets);
+    free(store->action);
+    pthread_mutex_destroy(&(store->lock));
+    free(store);
+  }
+  pthread_mutex_unlock(&registryLock);
+}
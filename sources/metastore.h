@@ -0,0 +1,114 @@
+/*
+**  Filename : metastore.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Metadata of the contents saved by an action, kept from
+**              one run to the next.
+**              - For each URL whose content was saved: its ETag, its
+**              Last-Modified date, its content type, the file where it
+**              was saved, where it starts in this file, its length, its
+**              SHA-256 and its encoding if it was saved compressed.
+**              - The next runs send If-None-Match/If-Modified-Since with
+**              these values, the server answers 304 and sends nothing if
+**              the content has not changed.
+**              - The store of an action is loaded from the file
+**              DATA_DIR/name of action/METADATA_FILE the first time it is
+**              needed and written back at the end of each run.
+**              - The stores can be used by several threads.
+*/
+#ifndef __METASTORE
+#define __METASTORE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "hash.h"
+
+#define METADATA_FILE "metadata.txt"
+#define METASTORE_INITIAL_SIZE 256    //initial nb of buckets of a store
+
+/*What is known about the content of an URL*/
+typedef struct urlRecord{
+  char *url;
+  char *etag;               //"" if the server sent none
+  char *lastModified;       //"" if the server sent none
+  char *contentType;
+  char *contentEncoding;    //"" if saved decoded, else as saved ("gzip"...)
+  char *filePath;           //file where the content was saved
+  long offset;              //where the content starts in this file
+  long length;              //size of the content
+  char hash[SHA256_HEX_SIZE];   //SHA-256 of the content (hexadecimal)
+  struct urlRecord *next;
+}URLRecord;
+
+typedef struct metaStore{
+  char *action;             //name of the action (spaces replaced by '_')
+  URLRecord **buckets;
+  size_t sizeBuckets;
+  size_t nbRecords;
+  int modified;             //1 if changed since it was last written
+  pthread_mutex_t lock;
+  struct metaStore *next;
+}MetaStore;
+
+/**
+ * Get the store of an action, load it from its file the first time
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the store (owned by the registry of the stores)
+ */
+MetaStore *getMetaStore(const char *actionName);
+
+/**
+ * Create an empty record
+ * @param url : the URL of the record (copied)
+ * @return : the record
+ */
+URLRecord *initRecord(const char *url);
+
+/**
+ * Free a record
+ * @param record : the record to be freed
+ * @return : nothing
+ */
+void delRecord(URLRecord **record);
+
+/**
+ * Look for the record of an URL
+ * @param store : the store
+ * @param url : the URL
+ * @return : a copy of the record (to be freed with delRecord),
+ *           NULL if the URL has no record
+ */
+URLRecord *findRecord(MetaStore *store, const char *url);
+
+/**
+ * Add the record of an URL, the old one is replaced
+ * @param store : the store
+ * @param record : the record (the store takes its ownership)
+ * @return : nothing
+ */
+void updateRecord(MetaStore *store, URLRecord *record);
+
+/**
+ * Remove the record of an URL, if it has one
+ * @param store : the store
+ * @param url : the URL
+ * @return : nothing
+ */
+void removeRecord(MetaStore *store, const char *url);
+
+/**
+ * Write a store in its file if it has changed
+ * @param store : the store
+ * @return : 0 if succeeded, -1 if not
+ */
+int saveMetaStore(MetaStore *store);
+
+/**
+ * Free all the stores (without writing them)
+ * @return : nothing
+ */
+void delMetaStores();
+
+#endif
@@ -0,0 +1,601 @@
+/*
+**  Filename : mime.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Table of the common MIME types with the extension of the
+**              files of each type, to name the files saved.
+**              - The table is built into the program (the common types
+**              listed by MDN), starting needs no network nor any file.
+**              - A local file can override it: each line holds a type and
+**              its extensions ("image/png png"), as in the mime.types
+**              files, '#' starts a comment. Its types replace those of the
+**              table or are added to it, the first extension is used.
+**              - The types of the table are found through a perfect hash
+**              (hash and displace, fixed seed) built once at start: one
+**              hash and one compare per lookup, whatever the size of the
+**              table.
+**              - The Content-Type of a content is parsed once into its
+**              type, subtype and parameters (ContentType), the selection
+**              of types of an action is compiled once into a TypeMatcher
+**              (a star as subtype, or no subtype, selects all the subtypes).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "mime.h"
+
+#define MIME_HASH_SEED 0x2545f4914f6cdd1dULL
+#define MAX_DISPLACEMENT 1024   //tried per bucket before the table grows
+
+/*The common MIME types listed by MDN*/
+static const TypeMIME defaultMIMEs[] = {
+  {"audio/aac", ".aac"},
+  {"application/x-abiword", ".abw"},
+  {"image/apng", ".apng"},
+  {"application/x-freearc", ".arc"},
+  {"image/avif", ".avif"},
+  {"video/x-msvideo", ".avi"},
+  {"application/vnd.amazon.ebook", ".azw"},
+  {"application/octet-stream", ".bin"},
+  {"image/bmp", ".bmp"},
+  {"application/x-bzip", ".bz"},
+  {"application/x-bzip2", ".bz2"},
+  {"application/x-cdf", ".cda"},
+  {"application/x-csh", ".csh"},
+  {"text/css", ".css"},
+  {"text/csv", ".csv"},
+  {"application/msword", ".doc"},
+  {"application/vnd.openxmlformats-officedocument.wordprocessingml.document", ".docx"},
+  {"application/vnd.ms-fontobject", ".eot"},
+  {"application/epub+zip", ".epub"},
+  {"application/gzip", ".gz"},
+  {"image/gif", ".gif"},
+  {"text/html", ".html"},
+  {"image/vnd.microsoft.icon", ".ico"},
+  {"text/calendar", ".ics"},
+  {"application/java-archive", ".jar"},
+  {"image/jpeg", ".jpg"},
+  {"text/javascript", ".js"},
+  {"application/json", ".json"},
+  {"application/ld+json", ".jsonld"},
+  {"audio/midi", ".midi"},
+  {"audio/x-midi", ".midi"},
+  {"audio/mpeg", ".mp3"},
+  {"video/mp4", ".mp4"},
+  {"video/mpeg", ".mpeg"},
+  {"application/vnd.apple.installer+xml", ".mpkg"},
+  {"application/vnd.oasis.opendocument.presentation", ".odp"},
+  {"application/vnd.oasis.opendocument.spreadsheet", ".ods"},
+  {"application/vnd.oasis.opendocument.text", ".odt"},
+  {"audio/ogg", ".oga"},
+  {"video/ogg", ".ogv"},
+  {"application/ogg", ".ogx"},
+  {"audio/opus", ".opus"},
+  {"font/otf", ".otf"},
+  {"image/png", ".png"},
+  {"application/pdf", ".pdf"},
+  {"application/x-httpd-php", ".php"},
+  {"application/vnd.ms-powerpoint", ".ppt"},
+  {"application/vnd.openxmlformats-officedocument.presentationml.presentation", ".pptx"},
+  {"application/vnd.rar", ".rar"},
+  {"application/rtf", ".rtf"},
+  {"application/x-sh", ".sh"},
+  {"image/svg+xml", ".svg"},
+  {"application/x-tar", ".tar"},
+  {"image/tiff", ".tiff"},
+  {"video/mp2t", ".ts"},
+  {"font/ttf", ".ttf"},
+  {"text/plain", ".txt"},
+  {"application/vnd.visio", ".vsd"},
+  {"audio/wav", ".wav"},
+  {"audio/webm", ".weba"},
+  {"video/webm", ".webm"},
+  {"image/webp", ".webp"},
+  {"font/woff", ".woff"},
+  {"font/woff2", ".woff2"},
+  {"application/xhtml+xml", ".xhtml"},
+  {"application/vnd.ms-excel", ".xls"},
+  {"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", ".xlsx"},
+  {"application/xml", ".xml"},
+  {"application/vnd.mozilla.xul+xml", ".xul"},
+  {"application/zip", ".zip"},
+  {"video/3gpp", ".3gp"},
+  {"video/3gpp2", ".3g2"},
+  {"application/x-7z-compressed", ".7z"}
+};
+
+#define NB_DEFAULT_MIMES (sizeof(defaultMIMEs) / sizeof(TypeMIME))
+
+const TypeMIME *allMIMEs = defaultMIMEs;
+size_t nbMIMEs = NB_DEFAULT_MIMES;
+
+//the table with the types of the local file (NULL if there is none)
+//and the strings read from this file
+static TypeMIME *overridden = NULL;
+static char **ownedStrings = NULL;
+static size_t nbOwnedStrings = 0;
+
+//the perfect hash of the types of allMIMEs: the bucket of a type gives
+//the displacement which leads to its slot, a slot holds an index in
+//allMIMEs (-1 if empty)
+static uint32_t *displacements = NULL;
+static size_t nbBuckets = 0;
+static int *slots = NULL;
+static size_t nbSlots = 0;
+
+/*A bucket of types, while the hash is built*/
+typedef struct bucket{
+  size_t index;
+  size_t nbTypes;
+}Bucket;
+
+
+/**
+ * Keep a string read from the local file until delAllMIME
+ */
+static const char *ownString(char *str){
+  char **res = (char**)realloc(ownedStrings, (nbOwnedStrings + 1) * sizeof(char*));
+
+  if (res == NULL || str == NULL){
+    fprintf(stderr, "Allocation for MIME types failed.\n");
+    exit(1);
+  }
+  ownedStrings = res;
+  ownedStrings[nbOwnedStrings++] = str;
+  return str;
+}
+
+/**
+ * Add a type of the local file to the table,
+ * its extension replaces the one of the table
+ * @param size : the size of the table, doubled when it is full
+ */
+static void overrideMIME(char *type, char *extension, size_t *size){
+  char *dotted = (char*)malloc(strlen(extension) + 2);
+  size_t i;
+
+  if (dotted == NULL){
+    fprintf(stderr, "Allocation for MIME types failed.\n");
+    exit(1);
+  }
+  sprintf(dotted, ".%s", extension);
+  for (char *c = type; *c != '\0'; c++) *c = tolower((unsigned char)*c);
+  for (i = 0; i < nbMIMEs && strcasecmp(overridden[i].type, type) != 0; i++);
+  if (i == nbMIMEs){
+    //a type the table does not know
+    if (nbMIMEs == *size){
+      *size *= 2;
+      overridden = (TypeMIME*)realloc(overridden, *size * sizeof(TypeMIME));
+      if (overridden == NULL){
+        fprintf(stderr, "Allocation for MIME types failed.\n");
+        exit(1);
+      }
+    }
+    overridden[i].type = ownString(strdup(type));
+    nbMIMEs++;
+  }
+  overridden[i].extension = ownString(dotted);
+}
+
+/**
+ * Hash a type (FNV-1a then mixed, so that the low bits giving
+ * the bucket and the high bits giving the slot are independent)
+ */
+static uint64_t hashType(const char *type, size_t len){
+  uint64_t h = 14695981039346656037ULL ^ MIME_HASH_SEED;
+
+  for (size_t i = 0; i < len; i++){
+    h = (h ^ (unsigned char)type[i]) * 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * Get the slot of a type of hash h with the displacement d
+ */
+static size_t slotOf(uint64_t h, uint32_t d){
+  return ((uint32_t)(h >> 32) + d * ((uint32_t)(h >> 16) | 1)) & (nbSlots - 1);
+}
+
+static size_t powerOf2(size_t n){
+  size_t res = 1;
+  while (res < n) res <<= 1;
+  return res;
+}
+
+static int compareBuckets(const void *a, const void *b){
+  const Bucket *x = (const Bucket*)a, *y = (const Bucket*)b;
+  if (x->nbTypes != y->nbTypes) return x->nbTypes < y->nbTypes ? 1 : -1;
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/**
+ * Find a displacement putting all the types of a bucket in free slots
+ * @param members : the indexes of its types in allMIMEs
+ * @param hashes : the hashes of all the types
+ * @return : 1 if the bucket is placed, 0 if no displacement fits
+ */
+static int placeBucket(Bucket *bucket, const size_t *members, const uint64_t *hashes){
+  size_t j, slot;
+
+  for (uint32_t d = 0; d < MAX_DISPLACEMENT; d++){
+    for (j = 0; j < bucket->nbTypes; j++){
+      slot = slotOf(hashes[members[j]], d);
+      if (slots[slot] != -1) break;
+      slots[slot] = (int)members[j];
+    }
+    if (j == bucket->nbTypes){
+      displacements[bucket->index] = d;
+      return 1;
+    }
+    //the types already put take their slots back
+    while (j-- > 0) slots[slotOf(hashes[members[j]], d)] = -1;
+  }
+  return 0;
+}
+
+/**
+ * Build the perfect hash of the types of allMIMEs: the buckets
+ * with the most types are placed first, the table grows if one
+ * of them cannot be placed
+ */
+static void buildMIMEHash(){
+  uint64_t *hashes = (uint64_t*)malloc(nbMIMEs * sizeof(uint64_t));
+  size_t *next = (size_t*)malloc(nbMIMEs * sizeof(size_t));
+  size_t *members = (size_t*)malloc(nbMIMEs * sizeof(size_t));
+  size_t *first, i, k, n;
+  Bucket *buckets;
+  int placed = 0;
+
+  nbBuckets = powerOf2((nbMIMEs + 3) / 4);
+  nbSlots = powerOf2(2 * nbMIMEs);
+  first = (size_t*)malloc(nbBuckets * sizeof(size_t));
+  buckets = (Bucket*)malloc(nbBuckets * sizeof(Bucket));
+  displacements = (uint32_t*)calloc(nbBuckets, sizeof(uint32_t));
+  if (hashes == NULL || next == NULL || members == NULL || first == NULL
+      || buckets == NULL || displacements == NULL){
+    fprintf(stderr, "Allocation for hash of MIME types failed.\n");
+    exit(1);
+  }
+
+  for (i = 0; i < nbBuckets; i++){
+    first[i] = nbMIMEs;
+    buckets[i].index = i;
+    buckets[i].nbTypes = 0;
+  }
+  for (k = 0; k < nbMIMEs; k++){
+    hashes[k] = hashType(allMIMEs[k].type, strlen(allMIMEs[k].type));
+    i = hashes[k] & (nbBuckets - 1);
+    next[k] = first[i];
+    first[i] = k;
+    buckets[i].nbTypes++;
+  }
+  qsort(buckets, nbBuckets, sizeof(Bucket), compareBuckets);
+
+  while (!placed){
+    //2 types alike never get apart
+    if (nbSlots > 64 * powerOf2(nbMIMEs)){
+      fprintf(stderr, "Hash of MIME types failed, a type is listed twice.\n");
+      exit(1);
+    }
+    free(slots);
+    slots = (int*)malloc(nbSlots * sizeof(int));
+    if (slots == NULL){
+      fprintf(stderr, "Allocation for hash of MIME types failed.\n");
+      exit(1);
+    }
+    for (i = 0; i < nbSlots; i++) slots[i] = -1;
+    placed = 1;
+    for (i = 0; i < nbBuckets && buckets[i].nbTypes > 0 && placed; i++){
+      n = 0;
+      for (k = first[buckets[i].index]; k != nbMIMEs; k = next[k]) members[n++] = k;
+      placed = placeBucket(&(buckets[i]), members, hashes);
+    }
+    if (!placed) nbSlots *= 2;
+  }
+
+  free(hashes);
+  free(next);
+  free(members);
+  free(first);
+  free(buckets);
+}
+
+/**
+ * Look for a type in allMIMEs
+ * @param type : the type (lowercase "type/subtype")
+ * @param len : its length
+ * @return : its index, -1 if it is not there
+ */
+static int findMIME(const char *type, size_t len){
+  uint64_t h = hashType(type, len);
+  int res = slots[slotOf(h, displacements[h & (nbBuckets - 1)])];
+
+  if (res < 0 || strncmp(allMIMEs[res].type, type, len) != 0
+      || allMIMEs[res].type[len] != '\0') return -1;
+  return res;
+}
+
+/**
+ * Set up the table of the MIME types: the table built into
+ * the program, overridden by a local file if one is given
+ * @param overridePath : the file overriding the table, NULL if none
+ * @return : nothing, allMIMEs and nbMIMEs are set
+ */
+void initAllMIME(const char *overridePath){
+  char *line = NULL, *cursor, *type, *extension;
+  size_t sizeLine = 0, size = 2 * NB_DEFAULT_MIMES;
+  FILE *f;
+
+  allMIMEs = defaultMIMEs;
+  nbMIMEs = NB_DEFAULT_MIMES;
+  if (overridePath == NULL){
+    buildMIMEHash();
+    return;
+  }
+  f = fopen(overridePath, "r");
+  if (f == NULL){
+    fprintf(stderr, "Cannot open file %s, the built-in MIME types are used\n", overridePath);
+    buildMIMEHash();
+    return;
+  }
+
+  overridden = (TypeMIME*)malloc(size * sizeof(TypeMIME));
+  if (overridden == NULL){
+    fprintf(stderr, "Allocation for MIME types failed.\n");
+    exit(1);
+  }
+  memcpy(overridden, defaultMIMEs, sizeof(defaultMIMEs));
+  while (getline(&line, &sizeLine, f) != -1){
+    cursor = strchr(line, '#');
+    if (cursor != NULL) *cursor = '\0';
+    cursor = line;
+    type = strtok_r(cursor, " \t\r\n;", &cursor);
+    extension = type == NULL ? NULL : strtok_r(NULL, " \t\r\n;", &cursor);
+    //a type without extension names no file
+    if (extension == NULL) continue;
+    if (extension[0] == '.') extension++;
+    overrideMIME(type, extension, &size);
+  }
+  free(line);
+  fclose(f);
+  allMIMEs = overridden;
+  buildMIMEHash();
+}
+
+/**
+ * Free the table of the MIME types
+ * @return : nothing
+ */
+void delAllMIME(){
+  for (size_t i = 0; i < nbOwnedStrings; i++) free(ownedStrings[i]);
+  free(ownedStrings);
+  free(overridden);
+  free(displacements);
+  free(slots);
+  displacements = NULL;
+  slots = NULL;
+  nbBuckets = 0;
+  nbSlots = 0;
+  ownedStrings = NULL;
+  nbOwnedStrings = 0;
+  overridden = NULL;
+  allMIMEs = defaultMIMEs;
+  nbMIMEs = NB_DEFAULT_MIMES;
+}
+
+/**
+ * Parse a Content-Type header
+ * @param ct : the Content-Type parsed
+ * @param header : the value of the header, NULL if the
+ * server sent none ("application/octet-stream" is used)
+ * @return : nothing, ct is filled
+ */
+void parseContentType(ContentType *ct, const char *header){
+  const char *c;
+  size_t len = 0, n = 0;
+
+  if (header == NULL) header = "application/octet-stream";
+  for (c = header; *c == ' ' || *c == '\t'; c++);
+  for (; *c != '\0' && *c != ';' && *c != ' ' && *c != '\t'; c++, n++){
+    if (n + 1 < MIME_TYPE_SIZE) ct->type[len++] = tolower((unsigned char)*c);
+  }
+  //a type too long to be kept is not readable
+  if (n >= MIME_TYPE_SIZE) len = 0;
+  ct->type[len] = '\0';
+  for (ct->lenMain = 0; ct->lenMain < len && ct->type[ct->lenMain] != '/'; ct->lenMain++);
+
+  while (*c != '\0' && *c != ';') c++;
+  if (*c == ';') c++;
+  while (*c == ' ' || *c == '\t') c++;
+  for (len = 0; *c != '\0' && len + 1 < MIME_PARAMS_SIZE; c++) ct->params[len++] = *c;
+  while (len > 0 && isspace((unsigned char)ct->params[len - 1])) len--;
+  ct->params[len] = '\0';
+
+  ct->mime = ct->type[0] == '\0' ? -1 : findMIME(ct->type, strlen(ct->type));
+}
+
+/**
+ * Tell if a content is of a type
+ * @param ct : the Content-Type of the content
+ * @param type : the type (lowercase "type/subtype")
+ * @return : 1 if it is, 0 if not
+ */
+int isOfType(const ContentType *ct, const char *type){
+  return strcmp(ct->type, type) == 0;
+}
+
+/**
+ * Get the extension of the files of a Content-Type
+ * @param ct : the Content-Type parsed
+ * @return : the extension (with its '.'), NULL if the type
+ * is not a common one
+ */
+const char *getExtension(const ContentType *ct){
+  return ct->mime < 0 ? NULL : allMIMEs[ct->mime].extension;
+}
+
+/**
+ * From contentType, look for the corresponding extension
+ * in the table allMIMEs
+ * @param contentType : the content type of a content
+ * @return : the extension (with its '.'), NULL if the type
+ * is not a common one
+ */
+const char *getExtensionFromCt(const char *contentType){
+  ContentType ct;
+
+  parseContentType(&ct, contentType);
+  return getExtension(&ct);
+}
+
+/**
+ * Guess the type of a content from the extension of its URL
+ * @param url : the URL
+ * @return : the index of the type in allMIMEs, -1 if the URL
+ * has no extension or an extension of no common type
+ */
+int guessTypeFromURL(const char *url){
+  const char *end = url + strcspn(url, "?#"), *ext = NULL, *c;
+  size_t len;
+
+  for (c = end; c > url && c[-1] != '/'; c--){
+    if (c[-1] == '.'){
+      ext = c - 1;
+      break;
+    }
+  }
+  if (ext == NULL) return -1;
+  len = end - ext;
+  for (size_t i = 0; i < nbMIMEs; i++){
+    if (strncasecmp(allMIMEs[i].extension, ext, len) == 0
+        && allMIMEs[i].extension[len] == '\0') return (int)i;
+  }
+  return -1;
+}
+
+/**
+ * Tell if the contents of a type are usually large
+ * (videos, sounds and archives)
+ * @param mime : the index of the type in allMIMEs
+ * @return : 1 if they are, 0 if not
+ */
+int isBulkyType(int mime){
+  static const char *archives[] = {"application/zip", "application/gzip",
+    "application/x-tar", "application/x-7z-compressed", "application/vnd.rar",
+    "application/x-bzip", "application/x-bzip2", "application/x-freearc",
+    "application/octet-stream", "application/java-archive"};
+  const char *type;
+
+  if (mime < 0) return 0;
+  type = allMIMEs[mime].type;
+  if (strncmp(type, "video/", 6) == 0 || strncmp(type, "audio/", 6) == 0) return 1;
+  for (size_t i = 0; i < sizeof(archives) / sizeof(archives[0]); i++){
+    if (strcmp(type, archives[i]) == 0) return 1;
+  }
+  return 0;
+}
+
+/**
+ * Add a copy of a string to an array of strings
+ */
+static char **addString(char **array, size_t *nb, const char *str){
+  char **res = (char**)realloc(array, (*nb + 1) * sizeof(char*));
+
+  if (res == NULL || (res[*nb] = strdup(str)) == NULL){
+    fprintf(stderr, "Allocation for types selected failed.\n");
+    exit(1);
+  }
+  (*nb)++;
+  return res;
+}
+
+/**
+ * Compile the types selected by an action
+ * (allMIMEs must be set up before)
+ * @param matcher : the matcher to be initialized
+ * @param types : the types selected ("image/png", "image" for all the images...)
+ * @param nbTypes : their number, 0 to select all the types
+ * @return : nothing, the matcher is modified through the pointer
+ */
+void initTypeMatcher(TypeMatcher *matcher, char **types, int nbTypes){
+  ContentType ct;
+
+  matcher->all = nbTypes == 0;
+  matcher->selected = (unsigned char*)calloc(nbMIMEs + 1, sizeof(unsigned char));
+  if (matcher->selected == NULL){
+    fprintf(stderr, "Allocation for types selected failed.\n");
+    exit(1);
+  }
+  matcher->others = NULL;
+  matcher->nbOthers = 0;
+  matcher->mains = NULL;
+  matcher->nbMains = 0;
+
+  for (int i = 0; i < nbTypes; i++){
+    parseContentType(&ct, types[i]);
+    if (ct.type[0] == '\0') continue;
+    if (strcmp(ct.type, "*/*") == 0 || strcmp(ct.type, "*") == 0){
+      matcher->all = 1;
+    }else if (ct.type[ct.lenMain] == '\0' || strcmp(ct.type + ct.lenMain, "/*") == 0){
+      //all the subtypes of a type
+      ct.type[ct.lenMain] = '\0';
+      matcher->mains = addString(matcher->mains, &(matcher->nbMains), ct.type);
+      for (size_t j = 0; j < nbMIMEs; j++){
+        if (strncmp(allMIMEs[j].type, ct.type, ct.lenMain) == 0
+            && allMIMEs[j].type[ct.lenMain] == '/') matcher->selected[j] = 1;
+      }
+    }else if (ct.mime >= 0){
+      matcher->selected[ct.mime] = 1;
+    }else{
+      matcher->others = addString(matcher->others, &(matcher->nbOthers), ct.type);
+    }
+  }
+}
+
+/**
+ * Tell if a Content-Type is selected by a matcher
+ * @param matcher : the types selected by an action
+ * @param ct : the Content-Type parsed
+ * @return : 1 if the content is to be saved, 0 if not
+ */
+int matchType(const TypeMatcher *matcher, const ContentType *ct){
+  size_t i;
+
+  if (matcher->all) return 1;
+  //the common types were all resolved when the matcher was compiled
+  if (ct->mime >= 0) return matcher->selected[ct->mime];
+  for (i = 0; i < matcher->nbOthers; i++){
+    if (strcmp(matcher->others[i], ct->type) == 0) return 1;
+  }
+  for (i = 0; i < matcher->nbMains; i++){
+    if (strlen(matcher->mains[i]) == ct->lenMain && ct->type[ct->lenMain] == '/'
+        && strncmp(matcher->mains[i], ct->type, ct->lenMain) == 0) return 1;
+  }
+  return 0;
+}
+
+/**
+ * Free a matcher
+ * @param matcher : the matcher
+ * @return : nothing
+ */
+void delTypeMatcher(TypeMatcher *matcher){
+  size_t i;
+
+  for (i = 0; i < matcher->nbOthers; i++) free(matcher->others[i]);
+  for (i = 0; i < matcher->nbMains; i++) free(matcher->mains[i]);
+  free(matcher->others);
+  free(matcher->mains);
+  free(matcher->selected);
+  matcher->others = NULL;
+  matcher->mains = NULL;
+  matcher->selected = NULL;
+}
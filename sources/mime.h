@@ -0,0 +1,150 @@
+/*
+**  Filename : mime.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Table of the common MIME types with the extension of the
+**              files of each type, to name the files saved.
+**              - The table is built into the program (the common types
+**              listed by MDN), starting needs no network nor any file.
+**              - A local file can override it: each line holds a type and
+**              its extensions ("image/png png"), as in the mime.types
+**              files, '#' starts a comment. Its types replace those of the
+**              table or are added to it, the first extension is used.
+**              - The types of the table are found through a perfect hash
+**              (hash and displace, fixed seed) built once at start: one
+**              hash and one compare per lookup, whatever the size of the
+**              table.
+**              - The Content-Type of a content is parsed once into its
+**              type, subtype and parameters (ContentType), the selection
+**              of types of an action is compiled once into a TypeMatcher
+**              (a star as subtype, or no subtype, selects all the subtypes).
+*/
+#ifndef __MIME
+#define __MIME
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct typeMIME{
+  const char *type;
+  const char *extension;        //with its '.'
+}TypeMIME;
+
+extern const TypeMIME *allMIMEs;
+extern size_t nbMIMEs;
+
+#define MIME_TYPE_SIZE 128      //longest type/subtype kept + 1
+#define MIME_PARAMS_SIZE 128    //longest parameters kept + 1
+
+/*A Content-Type parsed: "Text/HTML; charset=UTF-8" gives
+* the type "text/html" (lowercase) and the parameters
+* "charset=UTF-8"
+*/
+typedef struct contentType{
+  char type[MIME_TYPE_SIZE];        //type/subtype, "" if unreadable
+  size_t lenMain;                   //length of the type before '/'
+  char params[MIME_PARAMS_SIZE];    //after the first ';', "" if none
+  int mime;                         //index in allMIMEs, -1 if not there
+}ContentType;
+
+/*The types selected by an action, compiled once*/
+typedef struct typeMatcher{
+  int all;                  //1 if the action selects no type: all are saved
+  unsigned char *selected;  //one flag per type of allMIMEs
+  char **others;            //selected types not in allMIMEs
+  size_t nbOthers;
+  char **mains;             //types selected whole ("image" for "image/*")
+  size_t nbMains;
+}TypeMatcher;
+
+/**
+ * Set up the table of the MIME types: the table built into
+ * the program, overridden by a local file if one is given
+ * @param overridePath : the file overriding the table, NULL if none
+ * @return : nothing, allMIMEs and nbMIMEs are set
+ */
+void initAllMIME(const char *overridePath);
+
+/**
+ * Free the table of the MIME types
+ * @return : nothing
+ */
+void delAllMIME();
+
+/**
+ * Parse a Content-Type header
+ * @param ct : the Content-Type parsed
+ * @param header : the value of the header, NULL if the
+ * server sent none ("application/octet-stream" is used)
+ * @return : nothing, ct is filled
+ */
+void parseContentType(ContentType *ct, const char *header);
+
+/**
+ * Tell if a content is of a type
+ * @param ct : the Content-Type of the content
+ * @param type : the type (lowercase "type/subtype")
+ * @return : 1 if it is, 0 if not
+ */
+int isOfType(const ContentType *ct, const char *type);
+
+/**
+ * Get the extension of the files of a Content-Type
+ * @param ct : the Content-Type parsed
+ * @return : the extension (with its '.'), NULL if the type
+ * is not a common one
+ */
+const char *getExtension(const ContentType *ct);
+
+/**
+ * From contentType, look for the corresponding extension
+ * in the table allMIMEs
+ * @param contentType : the content type of a content
+ * @return : the extension (with its '.'), NULL if the type
+ * is not a common one
+ */
+const char *getExtensionFromCt(const char *contentType);
+
+/**
+ * Guess the type of a content from the extension of its URL
+ * @param url : the URL
+ * @return : the index of the type in allMIMEs, -1 if the URL
+ * has no extension or an extension of no common type
+ */
+int guessTypeFromURL(const char *url);
+
+/**
+ * Tell if the contents of a type are usually large
+ * (videos, sounds and archives)
+ * @param mime : the index of the type in allMIMEs
+ * @return : 1 if they are, 0 if not
+ */
+int isBulkyType(int mime);
+
+/**
+ * Compile the types selected by an action
+ * (allMIMEs must be set up before)
+ * @param matcher : the matcher to be initialized
+ * @param types : the types selected ("image/png", "image" for all the images...)
+ * @param nbTypes : their number, 0 to select all the types
+ * @return : nothing, the matcher is modified through the pointer
+ */
+void initTypeMatcher(TypeMatcher *matcher, char **types, int nbTypes);
+
+/**
+ * Tell if a Content-Type is selected by a matcher
+ * @param matcher : the types selected by an action
+ * @param ct : the Content-Type parsed
+ * @return : 1 if the content is to be saved, 0 if not
+ */
+int matchType(const TypeMatcher *matcher, const ContentType *ct);
+
+/**
+ * Free a matcher
+ * @param matcher : the matcher
+ * @return : nothing
+ */
+void delTypeMatcher(TypeMatcher *matcher);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+**  Filename : network.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : State of libcurl shared by all the transfers of the process.
+**              - libcurl is initialized once, when the program starts.
+**              - One share object holds the DNS cache, the TLS sessions
+**              and the connection cache for all the tasks and actions,
+**              so a host resolved, or a connection or TLS session opened,
+**              by one transfer is reused by the following ones.
+**              - Easy handles are kept in a pool once their transfer is
+**              over and reset for the next URL instead of being destroyed
+**              and created again.
+**              - The number of connections opened (the handshakes done)
+**              is counted to show how much is reused.
+**              - The pool and the share object can be used by several
+**              threads. libcurl does not support sharing a connection
+**              cache between threads, so with several threads each multi
+**              handle keeps its own connections and only the DNS cache
+**              and the TLS sessions are shared.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "network.h"
+
+static CURLSH *share = NULL;
+static pthread_mutex_t shareLocks[CURL_LOCK_DATA_LAST];
+static CURL **pool = NULL;          //easy handles ready to be reused
+static int nbPooled = 0;
+static int sizePool = 0;
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void lockShare(CURL *easy, curl_lock_data data, curl_lock_access access, void *arg){
+  pthread_mutex_lock(shareLocks + data);
+}
+
+static void unlockShare(CURL *easy, curl_lock_data data, void *arg){
+  pthread_mutex_unlock(shareLocks + data);
+}
+
+
+/**
+ * Initialize libcurl, the share object and the pool of easy handles
+ * (to be called once, before any transfer)
+ * @param nbThreads : the number of threads running transfers
+ * @return : nothing
+ */
+void initNetwork(int nbThreads){
+  if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK){
+    fprintf(stderr, "Cannot initialize libcurl.\n");
+    exit(1);
+  }
+
+  share = curl_share_init();
+  if (share == NULL){
+    fprintf(stderr, "Cannot initialize curl_share.\n");
+    exit(1);
+  }
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++){
+    pthread_mutex_init(shareLocks + i, NULL);
+  }
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  if (nbThreads <= 1){
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+  }
+
+  pool = (CURL**)malloc(POOL_INITIAL_SIZE * sizeof(CURL*));
+  if (pool == NULL){
+    fprintf(stderr, "Allocation for pool of easy handles failed.\n");
+    exit(1);
+  }
+  sizePool = POOL_INITIAL_SIZE;
+  nbPooled = 0;
+}
+
+/**
+ * Free the pool of easy handles and the share object
+ * and clean libcurl up (to be called once, at the end)
+ * @return : nothing
+ */
+void delNetwork(){
+  for (int i = 0; i < nbPooled; i++){
+    curl_easy_cleanup(pool[i]);
+  }
+  free(pool);
+  pool = NULL;
+  nbPooled = 0;
+  sizePool = 0;
+
+  //the handles using the share are all cleaned up
+  curl_share_cleanup(share);
+  share = NULL;
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++){
+    pthread_mutex_destroy(shareLocks + i);
+  }
+  curl_global_cleanup();
+}
+
+/**
+ * Take an easy handle from the pool, or create one if the
+ * pool is empty. The handle uses the share object.
+ * @param stats : the statistics of the run of the transfer
+ * @return : the handle, NULL if it cannot be created
+ */
+CURL *takeEasyHandle(NetworkStats *stats){
+  CURL *easy = NULL;
+
+  pthread_mutex_lock(&poolLock);
+  if (nbPooled > 0) easy = pool[--nbPooled];
+  pthread_mutex_unlock(&poolLock);
+
+  if (easy == NULL){
+    easy = curl_easy_init();
+    if (easy == NULL) return NULL;
+    stats->nbHandles++;
+  }
+  //reset by giveBackEasyHandle like all the other options
+  curl_easy_setopt(easy, CURLOPT_SHARE, share);
+  return easy;
+}
+
+/**
+ * Add the counters of a transfer over to the statistics
+ * @param easy : the handle of the transfer
+ * @param stats : the statistics of the run of the transfer
+ * @return : nothing
+ */
+void addTransferStats(CURL *easy, NetworkStats *stats){
+  long nbConnects = 0, code = 0;
+  curl_off_t nbBytes = 0;
+
+  curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &nbConnects);
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &nbBytes);
+  stats->nbTransfers++;
+  stats->nbConnects += nbConnects;
+  stats->nbBytes += nbBytes;
+  if (code == 304) stats->nbNotModified++;
+}
+
+/**
+ * Give an easy handle whose transfer is over back to the pool,
+ * its counters are added to the statistics and its options reset
+ * @param easy : the handle (not in a multi handle anymore)
+ * @param stats : the statistics of the run of the transfer
+ * @return : nothing
+ */
+void giveBackEasyHandle(CURL *easy, NetworkStats *stats){
+  addTransferStats(easy, stats);
+  curl_easy_reset(easy);
+  pthread_mutex_lock(&poolLock);
+  if (nbPooled == sizePool){
+    sizePool *= 2;
+    pool = (CURL**)realloc(pool, sizePool * sizeof(CURL*));
+    if (pool == NULL){
+      fprintf(stderr, "Allocation for pool of easy handles failed.\n");
+      exit(1);
+    }
+  }
+  pool[nbPooled++] = easy;
+  pthread_mutex_unlock(&poolLock);
+}
+
+/**
+ * Print out the statistics of a run
+ * @param stats : the statistics
+ * @param name : the name of the run (name of its task)
+ * @param f : where to print
+ * @return : nothing
+ */
+void printNetworkStats(NetworkStats *stats, char *name, FILE *f){
+  fprintf(f, "N: %s - %ld transfers (%ld HEAD), %ld not modified, %lld bytes downloaded, "
+          "%ld skipped (%lld bytes not downloaded), "
+          "%ld new connections (handshakes), %ld easy handles created\n",
+          name, stats->nbTransfers, stats->nbHeads, stats->nbNotModified,
+          (long long)stats->nbBytes, stats->nbSkipped, (long long)stats->nbBytesSkipped,
+          stats->nbConnects, stats->nbHandles);
+}
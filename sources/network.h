@@ -0,0 +1,93 @@
+/*
+**  Filename : network.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : State of libcurl shared by all the transfers of the process.
+**              - libcurl is initialized once, when the program starts.
+**              - One share object holds the DNS cache, the TLS sessions
+**              and the connection cache for all the tasks and actions,
+**              so a host resolved, or a connection or TLS session opened,
+**              by one transfer is reused by the following ones.
+**              - Easy handles are kept in a pool once their transfer is
+**              over and reset for the next URL instead of being destroyed
+**              and created again.
+**              - The number of connections opened (the handshakes done)
+**              is counted to show how much is reused.
+**              - The pool and the share object can be used by several
+**              threads. libcurl does not support sharing a connection
+**              cache between threads, so with several threads each multi
+**              handle keeps its own connections and only the DNS cache
+**              and the TLS sessions are shared.
+*/
+#ifndef __NETWORK
+#define __NETWORK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <curl/curl.h>
+
+#define POOL_INITIAL_SIZE 64      //initial nb of handles the pool can keep
+
+/*Counters of the transfers of a run*/
+typedef struct networkStats{
+  long nbTransfers;         //nb of transfers done
+  long nbNotModified;       //nb of answers 304 (content unchanged since the last run)
+  long nbHeads;             //nb of HEAD requests sent before a GET (see parse.h)
+  long nbSkipped;           //nb of contents not downloaded, not kept by their action
+  curl_off_t nbBytesSkipped;    //their size when their server told it
+  curl_off_t nbBytes;       //nb of bytes of the contents downloaded
+  long nbConnects;          //nb of new connections (TCP and TLS handshakes)
+  long nbHandles;           //nb of easy handles created
+}NetworkStats;
+
+/**
+ * Initialize libcurl, the share object and the pool of easy handles
+ * (to be called once, before any transfer)
+ * @param nbThreads : the number of threads running transfers
+ * @return : nothing
+ */
+void initNetwork(int nbThreads);
+
+/**
+ * Free the pool of easy handles and the share object
+ * and clean libcurl up (to be called once, at the end)
+ * @return : nothing
+ */
+void delNetwork();
+
+/**
+ * Take an easy handle from the pool, or create one if the
+ * pool is empty. The handle uses the share object.
+ * @param stats : the statistics of the run of the transfer
+ * @return : the handle, NULL if it cannot be created
+ */
+CURL *takeEasyHandle(NetworkStats *stats);
+
+/**
+ * Add the counters of a transfer over to the statistics
+ * @param easy : the handle of the transfer
+ * @param stats : the statistics of the run of the transfer
+ * @return : nothing
+ */
+void addTransferStats(CURL *easy, NetworkStats *stats);
+
+/**
+ * Give an easy handle whose transfer is over back to the pool,
+ * its counters are added to the statistics and its options reset
+ * @param easy : the handle (not in a multi handle anymore)
+ * @param stats : the statistics of the run of the transfer
+ * @return : nothing
+ */
+void giveBackEasyHandle(CURL *easy, NetworkStats *stats);
+
+/**
+ * Print out the statistics of a run
+ * @param stats : the statistics
+ * @param name : the name of the run (name of its task)
+ * @param f : where to print
+ * @return : nothing
+ */
+void printNetworkStats(NetworkStats *stats, char *name, FILE *f);
+
+#endif
@@ -0,0 +1,406 @@
+/*
+**  Filename : normalize.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Put every URL in one canonical form (RFC 3986) before it
+**              reaches the tree of URLs, so that the same resource is not
+**              fetched again because it is spelled differently.
+**              - A link is first resolved against the URL of its page
+**              (or its <base href>): "page.html", "./page.html", "../x",
+**              "/x", "//host/x" and "?q" are all made absolute.
+**              - The scheme and the host are lowercased, the default port
+**              (80 for http, 443 for https) is removed and an empty path
+**              becomes "/".
+**              - The dot-segments ("." and "..") of the path are removed.
+**              - Percent-encodings of unreserved characters are decoded,
+**              the others are written in uppercase and the characters
+**              not allowed in an URL are encoded.
+**              - The parameters of the query are sorted and the fragment
+**              is dropped, as neither changes the resource.
+**              Only http and https URLs are kept, the other schemes
+**              (mailto:, javascript:, data:,...) cannot be crawled.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "normalize.h"
+
+static const char HEX[] = "0123456789ABCDEF";
+
+/*A part of an URL, read in place*/
+typedef struct span{
+  const char *s;
+  size_t len;
+  int defined;        //1 if the part is present (even empty)
+}Span;
+
+/*The components of an URL (RFC 3986 section 3),
+* the fragment is never kept.
+*/
+typedef struct urlParts{
+  Span scheme;
+  Span authority;
+  Span path;
+  Span query;
+}URLParts;
+
+/*A string built piece by piece*/
+typedef struct buffer{
+  char *s;
+  size_t len;
+  size_t size;
+}Buffer;
+
+
+static void initBuffer(Buffer *b, size_t size){
+  b->s = (char*)malloc(size * sizeof(char));
+  if (b->s == NULL){
+    fprintf(stderr, "Allocation for URL normalization failed.\n");
+    exit(1);
+  }
+  b->len = 0;
+  b->size = size;
+}
+
+static void appendBuffer(Buffer *b, const char *s, size_t len){
+  if (b->len + len + 1 > b->size){
+    while (b->len + len + 1 > b->size) b->size *= 2;
+    b->s = (char*)realloc(b->s, b->size * sizeof(char));
+    if (b->s == NULL){
+      fprintf(stderr, "Allocation for URL normalization failed.\n");
+      exit(1);
+    }
+  }
+  memcpy(b->s + b->len, s, len);
+  b->len += len;
+  b->s[b->len] = '\0';
+}
+
+static void appendChar(Buffer *b, char c){
+  appendBuffer(b, &c, 1);
+}
+
+/**
+ * Split an URL into its components (RFC 3986 appendix B)
+ * @param s : the URL
+ * @param len : the length of s
+ * @param parts : the components, pointing inside s
+ * @return : nothing
+ */
+static void splitURL(const char *s, size_t len, URLParts *parts){
+  const char *c = s, *end = s + len;
+
+  memset(parts, 0, sizeof(URLParts));
+
+  //scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) ":"
+  if (c < end && isalpha((unsigned char)*c)){
+    while (c < end && (isalnum((unsigned char)*c) || *c == '+' || *c == '-' || *c == '.')) c++;
+    if (c < end && *c == ':'){
+      parts->scheme = (Span){s, c - s, 1};
+      c++;
+    }else{
+      c = s;
+    }
+  }
+
+  if (end - c >= 2 && c[0] == '/' && c[1] == '/'){
+    c += 2;
+    parts->authority = (Span){c, 0, 1};
+    while (c < end && *c != '/' && *c != '?' && *c != '#') c++;
+    parts->authority.len = c - parts->authority.s;
+  }
+
+  parts->path = (Span){c, 0, 1};
+  while (c < end && *c != '?' && *c != '#') c++;
+  parts->path.len = c - parts->path.s;
+
+  if (c < end && *c == '?'){
+    c++;
+    parts->query = (Span){c, 0, 1};
+    while (c < end && *c != '#') c++;
+    parts->query.len = c - parts->query.s;
+  }
+}
+
+static int hexValue(char c){
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+//unreserved = ALPHA / DIGIT / "-" / "." / "_" / "~"
+static int isUnreserved(unsigned char c){
+  return isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+/**
+ * Append a part of an URL to a buffer with its percent-encodings
+ * in canonical form: unreserved characters decoded, the others in
+ * uppercase, the characters not allowed in an URL encoded
+ */
+static void appendEncoded(Buffer *b, const char *s, size_t len){
+  const char *end = s + len;
+  unsigned char c;
+  int high, low;
+  char escaped[3] = {'%', 0, 0};
+
+  for (; s < end; s++){
+    c = (unsigned char)*s;
+    if (c == '%'){
+      high = end - s > 2 ? hexValue(s[1]) : -1;
+      low = end - s > 2 ? hexValue(s[2]) : -1;
+      if (high >= 0 && low >= 0){
+        c = (unsigned char)(high * 16 + low);
+        s += 2;
+        if (isUnreserved(c)){
+          appendChar(b, (char)c);
+          continue;
+        }
+      }
+    }else if (c > 0x20 && c < 0x7f && strchr("\"<>\\^`{|}", c) == NULL){
+      appendChar(b, (char)c);
+      continue;
+    }
+    //a '%' not followed by 2 hex digits is encoded as well
+    escaped[1] = HEX[c >> 4];
+    escaped[2] = HEX[c & 0xf];
+    appendBuffer(b, escaped, 3);
+  }
+}
+
+/**
+ * Append an absolute path to a buffer without its
+ * dot-segments (RFC 3986 section 5.2.4)
+ */
+static void appendWithoutDots(Buffer *b, const char *path, size_t len){
+  const char *c = path, *end = path + len, *segment, *next;
+  size_t start = b->len, lenSegment;
+
+  while (c < end){
+    //c points on the '/' starting a segment
+    segment = c + 1;
+    next = memchr(segment, '/', end - segment);
+    if (next == NULL) next = end;
+    lenSegment = next - segment;
+
+    if (lenSegment == 1 && segment[0] == '.'){
+      if (next == end) appendChar(b, '/');
+    }else if (lenSegment == 2 && segment[0] == '.' && segment[1] == '.'){
+      //remove the last segment written
+      while (b->len > start && b->s[b->len - 1] != '/') b->len--;
+      if (b->len > start) b->len--;
+      b->s[b->len] = '\0';
+      if (next == end) appendChar(b, '/');
+    }else{
+      appendChar(b, '/');
+      appendBuffer(b, segment, lenSegment);
+    }
+    c = next;
+  }
+}
+
+static int compareSpans(const void *a, const void *b){
+  const Span *s1 = (const Span*)a, *s2 = (const Span*)b;
+  int res = memcmp(s1->s, s2->s, s1->len < s2->len ? s1->len : s2->len);
+  if (res != 0) return res;
+  return s1->len < s2->len ? -1 : s1->len > s2->len;
+}
+
+/**
+ * Append a query to a buffer with its parameters in
+ * canonical form, sorted and without the empty ones
+ */
+static void appendQuery(Buffer *b, const char *query, size_t len){
+  Buffer encoded;
+  Span *params;
+  size_t nbParams = 0, maxParams = 1;
+  const char *c, *end, *amp;
+
+  initBuffer(&encoded, len + 1);
+  appendEncoded(&encoded, query, len);
+  for (size_t i = 0; i < encoded.len; i++){
+    if (encoded.s[i] == '&') maxParams++;
+  }
+  params = (Span*)malloc(maxParams * sizeof(Span));
+  if (params == NULL){
+    fprintf(stderr, "Allocation for URL normalization failed.\n");
+    exit(1);
+  }
+
+  c = encoded.s;
+  end = encoded.s + encoded.len;
+  while (c <= end){
+    amp = memchr(c, '&', end - c);
+    if (amp == NULL) amp = end;
+    if (amp > c) params[nbParams++] = (Span){c, amp - c, 1};
+    c = amp + 1;
+  }
+  qsort(params, nbParams, sizeof(Span), compareSpans);
+
+  for (size_t i = 0; i < nbParams; i++){
+    appendChar(b, i == 0 ? '?' : '&');
+    appendBuffer(b, params[i].s, params[i].len);
+  }
+  free(params);
+  free(encoded.s);
+}
+
+/**
+ * Append the authority of an URL to a buffer with its host
+ * in lowercase and without the default port of its scheme
+ */
+static void appendAuthority(Buffer *b, Span authority, int https){
+  const char *c = authority.s, *end = authority.s + authority.len;
+  const char *at, *host, *colon = NULL;
+  const char *defaultPort = https ? "443" : "80";
+
+  //userinfo@host:port
+  for (at = end; at > c && at[-1] != '@'; at--);
+  if (at > c) appendEncoded(b, c, at - c);
+  host = at;
+
+  if (host < end && *host == '['){
+    //IPv6 literal, the port can only follow the ']'
+    c = memchr(host, ']', end - host);
+    if (c != NULL && c + 1 < end && c[1] == ':') colon = c + 1;
+  }else{
+    for (c = end; c > host && c[-1] != ':'; c--);
+    if (c > host) colon = c - 1;
+  }
+  if (colon == NULL) colon = end;
+
+  for (c = host; c < colon; c++){
+    appendChar(b, tolower((unsigned char)*c));
+  }
+  if (colon < end){
+    c = colon + 1;
+    while (c < end - 1 && *c == '0') c++;
+    if (c < end && !(strlen(defaultPort) == (size_t)(end - c) && memcmp(c, defaultPort, end - c) == 0)){
+      appendChar(b, ':');
+      appendBuffer(b, c, end - c);
+    }
+  }
+}
+
+/**
+ * Copy an URL found in a page without the spaces around it
+ * and with its "&amp;" turned into '&' (the URLs of the
+ * attributes are html encoded)
+ */
+static void appendRawURL(Buffer *b, const char *url, size_t len){
+  const char *end = url + len, *amp;
+
+  while (url < end && isspace((unsigned char)*url)) url++;
+  while (end > url && isspace((unsigned char)end[-1])) end--;
+
+  while ((amp = memchr(url, '&', end - url)) != NULL){
+    appendBuffer(b, url, amp - url + 1);
+    url = amp + 1;
+    if (end - url >= 4 && memcmp(url, "amp;", 4) == 0) url += 4;
+  }
+  appendBuffer(b, url, end - url);
+}
+
+/**
+ * Resolve an URL against a base URL and put it in canonical form
+ * @param url : the URL (absolute or relative) as found in a page
+ * @param base : the absolute URL the relative URLs are resolved against
+ * NULL if there is none (an URL without scheme is then taken as http)
+ * @return : the canonical absolute URL (to be freed by the caller)
+ *           NULL if the URL is not an http or https URL
+ */
+char *normalizeURL(const char *url, const char *base){
+  return normalizeURLSpan(url, strlen(url), base);
+}
+
+/**
+ * Resolve an URL which is not ended by '\0' (found in place
+ * in a page) against a base URL and put it in canonical form
+ * @param url : the URL (absolute or relative) as found in a page
+ * @param len : the length of the URL
+ * @param base : the absolute URL the relative URLs are resolved against
+ * NULL if there is none (an URL without scheme is then taken as http)
+ * @return : the canonical absolute URL (to be freed by the caller)
+ *           NULL if the URL is not an http or https URL
+ */
+char *normalizeURLSpan(const char *url, size_t len, const char *base){
+  Buffer ref, path, encoded, res;
+  URLParts r, b, t;
+  const char *lastSlash;
+  int https;
+
+  initBuffer(&ref, len + 8);
+  appendRawURL(&ref, url, len);
+  splitURL(ref.s, ref.len, &r);
+  if (base == NULL && !r.scheme.defined){
+    //"www.host.com/x" or "//www.host.com/x"
+    ref.len = 0;
+    appendBuffer(&ref, r.authority.defined ? "http:" : "http://", r.authority.defined ? 5 : 7);
+    appendRawURL(&ref, url, len);
+    splitURL(ref.s, ref.len, &r);
+  }
+  memset(&b, 0, sizeof(URLParts));
+  if (base != NULL) splitURL(base, strlen(base), &b);
+
+  //resolve the reference (RFC 3986 section 5.2.2),
+  //the dot-segments are removed afterwards for all cases
+  initBuffer(&path, ref.len + (base == NULL ? 0 : strlen(base)) + 2);
+  if (r.scheme.defined){
+    t = r;
+  }else{
+    t.scheme = b.scheme;
+    if (r.authority.defined){
+      t.authority = r.authority;
+      t.path = r.path;
+      t.query = r.query;
+    }else{
+      t.authority = b.authority;
+      if (r.path.len == 0){
+        t.path = b.path;
+        t.query = r.query.defined ? r.query : b.query;
+      }else{
+        t.query = r.query;
+        if (r.path.s[0] == '/'){
+          t.path = r.path;
+        }else{
+          //merge with the directory of the base
+          if (b.authority.defined && b.path.len == 0) appendChar(&path, '/');
+          for (lastSlash = b.path.s + b.path.len; lastSlash > b.path.s && lastSlash[-1] != '/'; lastSlash--);
+          if (b.path.len > 0) appendBuffer(&path, b.path.s, lastSlash - b.path.s);
+          appendBuffer(&path, r.path.s, r.path.len);
+          t.path = (Span){NULL, 0, 1};
+        }
+      }
+    }
+  }
+  if (t.path.s != NULL) appendBuffer(&path, t.path.s, t.path.len);
+
+  https = t.scheme.len == 5 && strncasecmp(t.scheme.s, "https", 5) == 0;
+  if (!t.scheme.defined || !t.authority.defined || t.authority.len == 0
+      || (!https && !(t.scheme.len == 4 && strncasecmp(t.scheme.s, "http", 4) == 0))){
+    free(ref.s);
+    free(path.s);
+    return NULL;
+  }
+
+  initBuffer(&res, ref.len + path.len + 16);
+  appendBuffer(&res, https ? "https://" : "http://", https ? 8 : 7);
+  appendAuthority(&res, t.authority, https);
+
+  //percent-encodings first, as "%2E" is a dot-segment
+  initBuffer(&encoded, path.len + 2);
+  if (path.len == 0 || path.s[0] != '/') appendChar(&encoded, '/');
+  appendEncoded(&encoded, path.s, path.len);
+  appendWithoutDots(&res, encoded.s, encoded.len);
+
+  if (t.query.defined) appendQuery(&res, t.query.s, t.query.len);
+
+  free(ref.s);
+  free(path.s);
+  free(encoded.s);
+  return res.s;
+}
@@ -0,0 +1,52 @@
+/*
+**  Filename : normalize.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Put every URL in one canonical form (RFC 3986) before it
+**              reaches the tree of URLs, so that the same resource is not
+**              fetched again because it is spelled differently.
+**              - A link is first resolved against the URL of its page
+**              (or its <base href>): "page.html", "./page.html", "../x",
+**              "/x", "//host/x" and "?q" are all made absolute.
+**              - The scheme and the host are lowercased, the default port
+**              (80 for http, 443 for https) is removed and an empty path
+**              becomes "/".
+**              - The dot-segments ("." and "..") of the path are removed.
+**              - Percent-encodings of unreserved characters are decoded,
+**              the others are written in uppercase and the characters
+**              not allowed in an URL are encoded.
+**              - The parameters of the query are sorted and the fragment
+**              is dropped, as neither changes the resource.
+**              Only http and https URLs are kept, the other schemes
+**              (mailto:, javascript:, data:,...) cannot be crawled.
+*/
+#ifndef __NORMALIZE
+#define __NORMALIZE
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Resolve an URL against a base URL and put it in canonical form
+ * @param url : the URL (absolute or relative) as found in a page
+ * @param base : the absolute URL the relative URLs are resolved against
+ * NULL if there is none (an URL without scheme is then taken as http)
+ * @return : the canonical absolute URL (to be freed by the caller)
+ *           NULL if the URL is not an http or https URL
+ */
+char *normalizeURL(const char *url, const char *base);
+
+/**
+ * Resolve an URL which is not ended by '\0' (found in place
+ * in a page) against a base URL and put it in canonical form
+ * @param url : the URL (absolute or relative) as found in a page
+ * @param len : the length of the URL
+ * @param base : the absolute URL the relative URLs are resolved against
+ * NULL if there is none (an URL without scheme is then taken as http)
+ * @return : the canonical absolute URL (to be freed by the caller)
+ *           NULL if the URL is not an http or https URL
+ */
+char *normalizeURLSpan(const char *url, size_t len, const char *base);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+**  Filename : objectstore.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Storage of the contents of the actions with versionning.
+**              - A content is saved once, under its SHA-256, in
+**              DATA_DIR/name of action/OBJECTS_DIR/first 2 digits of the
+**              hash/hash. A content which has not changed since a previous
+**              run, or which is the same for several URLs, costs no write.
+**              - Each run writes a manifest, DATA_DIR/name of action/
+**              MANIFESTS_DIR/time of the run.txt, with one line per URL:
+**              hash, length and URL. A version of the site is its manifest,
+**              keeping N versions only costs the contents which changed.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "objectstore.h"
+#include "directory.h"
+
+
+/**
+ * Get the directory of the objects of an action, create it if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the path of the directory ending with '/'
+ * (owned by the registry of directories), NULL if it cannot be created
+ */
+const char *getObjectsDirectory(const char *actionName){
+  return getDirectory(actionName, OBJECTS_DIR);
+}
+
+/**
+ * Get the file of the object of a content, create its directory if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param hash : the SHA-256 of the content (hexadecimal)
+ * @return : the path of the file (to be freed), NULL if its
+ * directory cannot be created
+ */
+char *makeObjectPath(const char *actionName, const char *hash){
+  const char *dirPath = getObjectsDirectory(actionName);
+  char *res;
+  size_t len;
+
+  if (dirPath == NULL) return NULL;
+  len = strlen(dirPath);
+  res = (char*)malloc(len + strlen(hash) + 4);
+  if (res == NULL){
+    fprintf(stderr, "Allocation for path of object failed.\n");
+    exit(1);
+  }
+  //the objects are spread in 256 directories by the first 2 digits of their hash
+  sprintf(res, "%s%.2s", dirPath, hash);
+  if (mkdir(res, 0755) != 0 && errno != EEXIST){
+    fprintf(stderr, "Cannot create directory %s: %s\n", res, strerror(errno));
+    free(res);
+    return NULL;
+  }
+  sprintf(res + len + 2, "/%s", hash);
+  return res;
+}
+
+/**
+ * Initialize the manifest of a run starting now,
+ * its file is created with its first line
+ * @param manifest : the manifest to be initialized
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : nothing, the manifest is modified through the pointer
+ */
+void initManifest(Manifest *manifest, const char *actionName){
+  struct timespec ts;
+  struct tm date;
+  char name[64];
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  localtime_r(&(ts.tv_sec), &date);
+  strftime(name, sizeof(name), "%Y%m%d-%H%M%S", &date);
+  //the milliseconds tell apart the runs started in the same second
+  sprintf(name + strlen(name), ".%03ld.txt", ts.tv_nsec / 1000000);
+
+  manifest->actionName = strdup(actionName);
+  manifest->name = strdup(name);
+  manifest->f = NULL;
+  pthread_mutex_init(&(manifest->lock), NULL);
+}
+
+/**
+ * Open the file of a manifest (its lock held)
+ * @return : 0 if succeeded, -1 if not
+ */
+static int openManifest(Manifest *manifest){
+  const char *dirPath = getDirectory(manifest->actionName, MANIFESTS_DIR);
+  char *path;
+
+  if (dirPath == NULL) return -1;
+  path = (char*)malloc(strlen(dirPath) + strlen(manifest->name) + 1);
+  if (path == NULL){
+    fprintf(stderr, "Allocation for path of manifest failed.\n");
+    exit(1);
+  }
+  strcpy(path, dirPath);
+  strcat(path, manifest->name);
+  manifest->f = fopen(path, "a");
+  if (manifest->f == NULL) fprintf(stderr, "Cannot open file %s\n", path);
+  free(path);
+  return manifest->f == NULL ? -1 : 0;
+}
+
+/**
+ * Add the content of an URL to a manifest
+ * @param manifest : the manifest of the run
+ * @param url : the URL
+ * @param hash : the SHA-256 of its content (hexadecimal)
+ * @param length : the size of its content
+ * @return : nothing
+ */
+void addToManifest(Manifest *manifest, const char *url, const char *hash, long length){
+  pthread_mutex_lock(&(manifest->lock));
+  if (manifest->f != NULL || openManifest(manifest) == 0){
+    fprintf(manifest->f, "%s\t%ld\t%s\n", hash, length, url);
+  }
+  pthread_mutex_unlock(&(manifest->lock));
+}
+
+/**
+ * Close the file of a manifest and free it
+ * @param manifest : the manifest
+ * @return : 0 if the manifest is on disk, -1 if not
+ */
+int closeManifest(Manifest *manifest){
+  int res = 0;
+
+  if (manifest->f != NULL && fclose(manifest->f) != 0) res = -1;
+  manifest->f = NULL;
+  free(manifest->actionName);
+  free(manifest->name);
+  pthread_mutex_destroy(&(manifest->lock));
+  return res;
+}
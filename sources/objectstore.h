@@ -0,0 +1,77 @@
+/*
+**  Filename : objectstore.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Storage of the contents of the actions with versionning.
+**              - A content is saved once, under its SHA-256, in
+**              DATA_DIR/name of action/OBJECTS_DIR/first 2 digits of the
+**              hash/hash. A content which has not changed since a previous
+**              run, or which is the same for several URLs, costs no write.
+**              - Each run writes a manifest, DATA_DIR/name of action/
+**              MANIFESTS_DIR/time of the run.txt, with one line per URL:
+**              hash, length and URL. A version of the site is its manifest,
+**              keeping N versions only costs the contents which changed.
+*/
+#ifndef __OBJECTSTORE
+#define __OBJECTSTORE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define OBJECTS_DIR "objects"
+#define MANIFESTS_DIR "manifests"
+
+/*Manifest of a run of an action*/
+typedef struct manifest{
+  char *actionName;         //name of the action (spaces replaced by '_')
+  char *name;               //name of its file: the time the run started
+  FILE *f;                  //NULL until its first line
+  pthread_mutex_t lock;
+}Manifest;
+
+/**
+ * Get the directory of the objects of an action, create it if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the path of the directory ending with '/'
+ * (owned by the registry of directories), NULL if it cannot be created
+ */
+const char *getObjectsDirectory(const char *actionName);
+
+/**
+ * Get the file of the object of a content, create its directory if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param hash : the SHA-256 of the content (hexadecimal)
+ * @return : the path of the file (to be freed), NULL if its
+ * directory cannot be created
+ */
+char *makeObjectPath(const char *actionName, const char *hash);
+
+/**
+ * Initialize the manifest of a run starting now,
+ * its file is created with its first line
+ * @param manifest : the manifest to be initialized
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : nothing, the manifest is modified through the pointer
+ */
+void initManifest(Manifest *manifest, const char *actionName);
+
+/**
+ * Add the content of an URL to a manifest
+ * @param manifest : the manifest of the run
+ * @param url : the URL
+ * @param hash : the SHA-256 of its content (hexadecimal)
+ * @param length : the size of its content
+ * @return : nothing
+ */
+void addToManifest(Manifest *manifest, const char *url, const char *hash, long length);
+
+/**
+ * Close the file of a manifest and free it
+ * @param manifest : the manifest
+ * @return : 0 if the manifest is on disk, -1 if not
+ */
+int closeManifest(Manifest *manifest);
+
+#endif
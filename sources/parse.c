@@ -1,576 +1,1467 @@
-/*
-**  Filename : parse.c
-**
-**  Made by : CAO Song Toan
-**
-**  Description :   Interface managing the parsing of website 
-**                  determined by the configuration
-*/
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <curl/curl.h>
-#include "configuration.h"
-#include "url.h"
-#include "parse.h"
-
-TypeMIME *allMIMEs;
-
-/** 
- * Initialize the WrapAction
- */
-WrapAction *initWrap(Action *action, Node root){
-  WrapAction *res = (WrapAction*)malloc(sizeof(WrapAction));
-  res->action = action;
-  res->root = root;
-  return res;
-}
-
-void delWrap(WrapAction **wrapper){
-  delTree(&((*wrapper)->root));
-  free(*wrapper);
-  *wrapper = NULL;
-}
-
-LinkEasyMulti *initLink(CURL *easy, CURLM *multi){
-  LinkEasyMulti *res = (LinkEasyMulti*)malloc(sizeof(LinkEasyMulti));
-  res->easy = easy;
-  res->multi = multi;
-  return res;
-}
-
-void delLink(LinkEasyMulti *link){
-  free(link);
-}
-
-/**
- * Create an array of all commun MIME types
- * by browsing through a website.
-**/
-TypeMIME *initAllMIME(){
-  CURL *curl;
-  FILE *fp;
-  CURLcode res;
-  TypeMIME *typesMime;
-  char *ext = NULL, *typeMime = NULL, *startExt, *endExt, *startTypeMime, *endTypeMime;
-  char buffer[BUFFER_SIZE];
-  char *url = "https://developer.mozilla.org/fr/docs/Web/HTTP/Basics_of_HTTP/MIME_types/Complete_list_of_MIME_types";
-  char *outfilename = "MIME_Types.txt";
-  int nb_types = 0;
-
-  // Download the content of the website who refer the list of mime types
-  curl = curl_easy_init();
-  if (curl) {
-    fp = fopen(outfilename,"wb");
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, fwrite);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-    res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-    fclose(fp);
-  }
-  // Open our file to parse and get type mime and its extension
-  fp = fopen(outfilename,"r");
-  if(fp == NULL) {
-    printf("Impossible d'accéder au fichier\n");
-    exit(1);
-  }
-
-  typesMime = (TypeMIME*)malloc(NB_MIME_TYPES * sizeof(TypeMIME));
-  // Get each line of html content
-  while((fgets(buffer,BUFFER_SIZE, fp) != NULL)) {
-    // Get line where we find an <td><code>. 
-    //-> the line where we can find the extension
-    if (strstr(buffer, "<td><code>.") != NULL) {
-      ext = strstr(buffer, "<td><code>.");
-      if (strstr(buffer, "<br>") == NULL){
-        //there is no breakline 
-        //-> only one extension for this MIME type
-        startExt = ext + strlen("<td><code>");
-        endExt = strstr(startExt, "</code></td>");
-      }else{
-        //There is a break line
-        //-> there are 2 extensions possible for this MIME type
-        //We take the second one in the following line
-        fgets(buffer, BUFFER_SIZE, fp);
-        startExt = strchr(buffer, '.');
-        endExt = strstr(startExt, "</code></td>");
-      }
-      ext = strndup(startExt, endExt - startExt);
-    }
-    // Same use as for extension but we check here if we dont have a "."
-    else if(strstr(buffer, "<td><code>") != NULL) {
-      typeMime = strstr(buffer, "<td><code>");
-      startTypeMime = typeMime + strlen("<td><code>");
-      endTypeMime = strstr(startTypeMime, "</code>");
-      typeMime = strndup(startTypeMime, endTypeMime - startTypeMime);
-    }else if (strstr(buffer, "</tr>") != NULL && ext != NULL && typeMime != NULL){
-      typesMime[nb_types].extension = ext;
-      typesMime[nb_types].type = typeMime;
-      // printf("%d. ext = %s\n",nb_types+1, typesMime[nb_types].extension);
-      // printf("%d. type = %s\n", nb_types+1, typesMime[nb_types].type);
-      nb_types++;
-    // When we get the end of tbody we stop the process
-    }else if(strstr(buffer, "</tbody>") != NULL) {
-      break;
-    }
-  }
-  fclose(fp);
-  return typesMime;
-}
-
-
-void delAllMIME(TypeMIME *allMIME){
-  for (int i = 0; i < NB_MIME_TYPES; i++){
-    free(allMIME[i].extension);
-    free(allMIME[i].type);
-  }free(allMIME);
-}
-
-/**
- * From contentType, look for the corresponding extension
- * in the table allMIMEs.
- * (allMIMEs contains only the commun MIME types)
-**/
-char *getExtensionFromCt(char *contentType){
-  for (int i = 0; i < NB_MIME_TYPES; i++){
-    if (strstr(contentType, allMIMEs[i].type) != NULL){
-      return allMIMEs[i].extension;
-    }
-  }
-  return NULL;
-}
-
-/**
- * This function fix the extension in the name of a file
- * according to its type. 
- * If the file name alr has a valid extension then 
- * *fileName won't be changed.
- * Else, we create a new name with valid extension 
- * then assign this name to the string pointed by fileName
- * @param fileName: pointer to the string of fileName
- * @param contentType : the MIME type of the content 
- * to be saved
- * @return : this function does not return anything
- * the filename fixed (or not) will be assigned back
- * to the pointer passed in argument.
- **/ 
-void fixExtension(char **fileName, char *contentType){
-  char *validExt = getExtensionFromCt(contentType);
-  char *pointExt;
-  char *newName;
-
-  if (validExt == NULL) {
-    fprintf(stderr, "File %s is not of a commun MIME type.", *fileName);
-    return;
-  }
-
-  pointExt = strstr(*fileName, validExt);
-  if (pointExt != NULL){
-    //the extension exists in fileName
-    newName = strndup(*fileName, pointExt + strlen(validExt) - *fileName);
-  }else{
-    //the current fileName does not contain valid extension
-    newName = (char*)malloc((strlen(*fileName) + strlen(validExt)) * sizeof(char));
-    strcpy(newName, *fileName);
-    strcat(newName, validExt);
-  }
-  free(*fileName);
-  *fileName = newName;
-}
-
-/**
- * Get the value of max-depth option of the action
- * If the action does not have a max-depth option then return 0
-**/
-int getMaxDepth(Action *action){
-  int res = 0;
-  for (int i = 0; i < action->nbOptions; i++){
-    switch (action->options[i].type){
-      case MAX_DEPTH:
-        res = action->options[i].val.depth;
-        break;
-      default:
-        break;
-    }
-  }
-  return res;
-}
-
-/**
- * Return the value of versionning of the action
- * If the action does not have versionning option, 
- * versionning will be considered "off".
-**/ 
-int getVersionning(Action *action){
-  int res = 0;
-  for (int i = 0; i < action->nbOptions; i++){
-    switch (action->options[i].type){
-      case VERSIONNING:
-        res = action->options[i].val.shift;
-        break;
-      default:
-        break;
-    }
-  }
-  return res;
-}
-
-/**
- * Check if type (content type of an url) is one 
- * of the selected types of the action
- **/
-int isTypeSelected(char *type, Action *action){
-  char **typesSelected = NULL;
-  int nbTypes = 0;
-
-  for (int i = 0; i < action->nbOptions; i++){
-    switch (action->options[i].type){
-      case TYPESELECT:
-        typesSelected = action->options[i].val.type.types;
-        nbTypes = action->options[i].val.type.nbTypes;
-        break;
-      default:
-        break;
-    }
-  }
-
-  if (nbTypes == 0){
-    //this action has no option TYPESELECT
-    //save all type of data
-    return 1;
-  }else{
-    for (int i = 0; i < nbTypes; i++){
-      if (strstr(type, typesSelected[i]) != NULL){
-        return 1;
-      }
-    }
-    return 0;
-  }
-}
-
-
-/**
- * In a html script, there may be relative link 
- * which will direct back to a file in host link.
- * We need to reconstruct the relative url 
- * before initialize a curl_easy for it
- **/
-void reconstructURL(char **URLRelative, char *URLHost){
-  char *slash, *res;
-
-  //special case URL relative = #
-  if (**URLRelative == '#'){
-    URLHost = delProtocol(URLHost);
-    slash = strchr(URLHost, '/');
-    res = (char*)malloc((slash - URLHost + strlen(*URLRelative) + 1) * sizeof(char));
-    strncpy(res, URLHost, (slash-URLHost)/sizeof(char));
-    res[slash-URLHost] = '\0';
-    strcat(res, "/");
-    strcat(res, *URLRelative);
-    free(URLHost);
-  }else{
-    //check if URLRelative is really a relative url
-    if (**URLRelative != '/'){ //not relative
-      res = strdup(*URLRelative);    
-    }else{
-      URLHost = delProtocol(URLHost);
-      slash = strchr(URLHost, '/');
-      res = (char*)malloc((slash - URLHost + strlen(*URLRelative)) * sizeof(char));
-      strncpy(res, URLHost, (slash-URLHost)/sizeof(char));
-      res[slash-URLHost] = '\0';
-      strcat(res, *URLRelative);
-      free(URLHost);
-    }
-  }
-  free(*URLRelative);
-
-  
-  *URLRelative = res;
-}
-  
-//   url = strndup(startURL, endURL-startURL);
-//   *dataLeft = endURL;
-//   return url;
-// }
-
-/**
- * Reading through file f, retrieve all URLs and 
- * add these URLs to curl multi cm if the depth 
- * of URLOfFile < max-depth of the action
- **/
-void getURLsFromFile(FILE *f, CURLM *cm, WrapAction *wrapper, char* URLOfFile){
-  char buffer[BUFFER_SIZE], *copyBuffer;
-  char *href, *src, *startURL, *endURL, *url;
-  int currDepth, maxdepth;
-
-  currDepth = findNode(wrapper->root, URLOfFile)->depth;
-  maxdepth = getMaxDepth(wrapper->action);
-
-  if (currDepth >= maxdepth) return;
-
-  while (fgets(buffer, BUFFER_SIZE, f) != NULL){
-    copyBuffer = buffer;
-    href = strstr(copyBuffer, "href=\"");
-    src = strstr(copyBuffer, "src=\"");
-    while (href != NULL || src != NULL){
-      if (href != NULL){
-        if (src != NULL){
-          if (href < src){
-            //find a href tag before a src tag
-            startURL = href + strlen("href=\"");
-            endURL = strstr(startURL, "\"");
-          }else{
-            startURL = src + strlen("src=\"");
-            endURL = strstr(startURL, "\"");
-          }
-        }else{
-          startURL = href + strlen("href=\"");
-          endURL = strstr(startURL, "\"");
-        }
-      }else{
-        if (src != NULL){
-          startURL = src + strlen("src=\"");
-          endURL = strstr(startURL, "\"");
-        }else{
-          break;
-        }
-      }
-      if (startURL == NULL || endURL == NULL) break;
-      url = strndup(startURL, endURL-startURL);
-      reconstructURL(&url, URLOfFile);
-      url = delProtocol(url);
-
-      if (!URLAlrParsed(wrapper->root, url)){
-        add_transfer(cm, wrapper, url);
-        insertURL(wrapper->root, url, currDepth+1);
-      }
-
-      href = strstr(endURL+1, "href=\"");
-      src = strstr(endURL+1, "src=\"");
-    }
-    
-  }
-}
-
-/**
- * Extract the last part after '/' of url
- * This part will be used to name the file that
- * are saved the content of @param url
- **/
-char *extractLastPart(char *url){
-  char *slash = strrchr(url, '/'); //last occurence of / in url
-  int size;
-  if (slash == url + strlen(url) - 1){
-    // www.abc.com/ the last / is useless
-    //we have to retrieve the / before this one
-    for (int i = strlen(url) - 2; i >= 0; --i){
-      if (*(url + i) == '/'){
-        slash = url + i;
-        size = (url + strlen(url) - 1) - slash - 1;
-        break;
-      }
-    }
-  }else{
-    size = (url + strlen(url)) - slash - 1;
-  }
-
-  return strndup(slash + 1, size);
-}
-
-
-/**
- * Generate a path to save the content returned by libcurl
- * Create directories if necessary 
- * Path will be of format: 
- * scrapper/data/name of Action/type of content (text, image,..)/name of file with extension
- * This function return the pointer to the opened file
- **/
-char *makeFilePath(Action *action, char *contentType, char *url){
-  char *filePath, *nameFile, *type, *actionName, command[200];
-  actionName = strdup(action->name);
-  strcpy(command, "mkdir -p ");
-  for (char *c = actionName; *c != '\0'; c++){
-    if (*c == ' ') *c = '_';
-  }
-
-  nameFile = extractLastPart(url);
-  type = strchr(contentType, '/');
-  type = strndup(contentType, type - contentType);
-  fixExtension(&nameFile, contentType);
-  filePath = (char*)malloc((strlen("../data/") + strlen(actionName) + strlen(type) + strlen(nameFile) + 3) * sizeof(char));
-  strcpy(filePath, "../data/");
-  strcat(filePath, actionName);
-  strcat(filePath, "/");
-  strcat(filePath, type);
-  strcat(filePath, "/");
-  //create directories
-  strcat(command, filePath);
-  system(command);
-
-  strcat(filePath, nameFile);
-
-  free(type);
-  free(nameFile);
-  free(actionName);
-  return filePath;
-}
-
-
-/*  
-* Get content type to know if this should be saved or not: easy handle, action options type selected
-* Save the content if its type satisfy the condition: action 
-* Parse the data to retrieve all URLs (data)
-* for each URLs retrieve, check if it exists in tree to know if it should be insert or not to the tree: tree, depth
-* new depth can be refound by find the handle's url in tree and then +1 
-* If it's a new URL, need to create a new handle for it and add to the multi handle of task: multi handle
-* After that cleanup the ez handle in argument
-* 
-*/ 
-size_t write_cb(void *data, size_t size, size_t nmemb, CURL *easy){
-  size_t res;
-  FILE *f;
-  char *contentType;
-  char *currURL;
-  char *filePath;
-  WrapAction *wrapper;
-
-  //retrieve the content type 
-  curl_easy_getinfo(easy, CURLINFO_CONTENT_TYPE, &contentType);
-
-  //retrieve the URL of the curl that called write_cb
-  curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &currURL);
-
-  //retrieve the wrapper
-  curl_easy_getinfo(easy, CURLINFO_PRIVATE, &wrapper);
-
-  //if the content type is one of those selected to save 
-  //defined in the option of action then save data 
-  //we also save all html file even if text/html is not
-  //a selected type in order to find URLs in it after
-  if (isTypeSelected(contentType, wrapper->action) || strstr(contentType, "text/html") != NULL){
-    filePath = makeFilePath(wrapper->action, contentType, currURL);
-    f = fopen(filePath, "a");
-    if (f == NULL) return 0; 
-    res = fwrite(data, size, nmemb, f);
-    free(filePath);
-    fclose(f);
-  }
-  return res;
-}
- 
-void add_transfer(CURLM *cm, WrapAction *wrapper, char *url)
-{
-  CURL *eh;
-  if (url == NULL) url = wrapper->action->url;
-  
-  eh = curl_easy_init();
-  if (eh){
-    curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(eh, CURLOPT_WRITEDATA, eh);
-    curl_easy_setopt(eh, CURLOPT_URL, url);
-    curl_easy_setopt(eh, CURLOPT_PRIVATE, (void*)wrapper);
-    curl_easy_setopt(eh, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_multi_add_handle(cm, eh);
-  }
-}
-
-
-void parseATask(Task *task){
-  CURLM *cm;
-  CURLMsg *msg;
-  CURLMcode res;
-  CURL *ce; 
-  int msgs_left = -1;
-  int still_alive = 1;
-  WrapAction *wrappers[task->nbActions];
-  WrapAction *wrapper;
-  int currDepth, maxDepth;
-  long timeout;
-  char *url, *contentType, *filePath;
-  FILE *f;
-
-  curl_global_init(CURL_GLOBAL_ALL);
-  cm = curl_multi_init();
-
-  if (cm == NULL){
-    fprintf(stderr, "Cannot initialize curl_multi.\n");
-    exit(1);
-  }
-
-  //Limit the amount of simultaneous connections curl should allow:
-  curl_multi_setopt(cm, CURLOPT_MAXCONNECTS, 10 * task->nbActions);
-
-  //add URLs from actions of the task to curl_multi handle
-  for (int i = 0; i < task->nbActions; i++){
-    wrappers[i] = initWrap(task->actions[i], makeTree(task->actions[i]->url));
-    add_transfer(cm, wrappers[i], NULL);
-  }
-
-  do {
-    res = curl_multi_perform(cm, &still_alive);
-    if(res != CURLM_OK) {
-      fprintf(stderr, "curl_multi failed, code %d.\n", res);
-      break;
-    }
-    while ((msg = curl_multi_info_read(cm, &msgs_left))){
-      if (msg->msg == CURLMSG_DONE) {
-        //retrieve needed infos
-        ce = msg->easy_handle;
-        curl_easy_getinfo(ce, CURLINFO_PRIVATE, &wrapper);
-        curl_easy_getinfo(ce, CURLINFO_CONTENT_TYPE, &contentType);
-        curl_easy_getinfo(ce, CURLINFO_EFFECTIVE_URL, &url);
-        //print out message
-        fprintf(stderr, "R: %d - %s <%s>\n",
-                msg->data.result, curl_easy_strerror(msg->data.result), url);
-
-        if (msg->data.result != 0) continue;
-        //if the content type is text/html 
-        //then we need to parse the saved data 
-        //to retrieve all URLs
-        if (strstr(contentType, "text/html")){
-          url = delProtocol(url);
-          maxDepth = getMaxDepth(wrapper->action);
-          currDepth = findNode(wrapper->root, url)->depth;
-          if (currDepth < maxDepth){
-            filePath = makeFilePath(wrapper->action, contentType, url);
-            f = fopen(filePath, "r");
-            if (f == NULL) continue;
-            getURLsFromFile(f, cm, wrapper, url);
-            fclose(f);
-            
-            //if the content type (text/html) is actually
-            //not a selected type then delte the file
-            if (!isTypeSelected(contentType, wrapper->action)){
-              remove(filePath);
-            }
-            free(filePath);
-          }
-        }
-        curl_multi_remove_handle(cm, ce);
-        curl_easy_cleanup(ce);
-      }
-      else{
-        fprintf(stderr, "E: CURLMsg (%d)\n", msg->msg);
-        curl_multi_remove_handle(cm, msg->easy_handle);
-        curl_easy_cleanup(msg->easy_handle);
-      }
-    }
-    curl_multi_timeout(cm, &timeout);
-    if (timeout < 0) curl_multi_wait(cm, NULL, 0, 1000, NULL);
-    else if (timeout == 0) curl_multi_perform(cm, &still_alive);
-    else curl_multi_wait(cm, NULL, 0, (int)timeout, NULL);
-  }while (still_alive);
-
-  //clean up and free space
-  for (int i = 0; i < task->nbActions; i++) delWrap(&(wrappers[i]));
-  curl_multi_cleanup(cm);
-  curl_global_cleanup();
-}
-
-void parseConfig(Configure *config){
-  for (int i = 0; i < config->nbTask; i++){
-    parseATask(config->tasks[i]);
-  }
-}
-
+/*
+**  Filename : parse.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description :   Interface managing the parsing of website 
+**                  determined by the configuration
+*/
+#define _GNU_SOURCE       //rwlocks preferring the writer
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include "configuration.h"
+#include "url.h"
+#include "parse.h"
+#include "directory.h"
+#include "normalize.h"
+#include "engine.h"
+#include "metastore.h"
+#include "checkpoint.h"
+
+/**
+ * Get the name of the directory of an action:
+ * its name whose spaces are replaced by '_'
+ */
+static char *actionDirName(Action *action){
+  char *res = strdup(action->name);
+  for (char *c = res; *c != '\0'; c++){
+    if (*c == ' ') *c = '_';
+  }
+  return res;
+}
+
+/*The directories of the actions whose crawl is in progress, an
+* action is only crawled by one task at a time (see Crawl)
+*/
+typedef struct busyAction{
+  char *dirName;
+  struct busyAction *next;
+}BusyAction;
+
+static BusyAction *busyActions = NULL;
+static pthread_mutex_t busyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t busyFree = PTHREAD_COND_INITIALIZER;
+
+/** 
+ * Initialize the WrapAction
+ * @param resumed : 1 if the crawl goes on from its checkpoint
+ */
+WrapAction *initWrap(Action *action, URLTree *tree, int resumed){
+  WrapAction *res = (WrapAction*)malloc(sizeof(WrapAction));
+  char **types;
+  int nbTypes;
+
+  res->action = action;
+  res->tree = tree;
+  res->dirName = actionDirName(action);
+  res->store = getMetaStore(res->dirName);
+  res->versionning = getVersionning(action);
+  res->maxDepth = getMaxDepth(action);
+  res->headFirst = getHeadFirst(action);
+  res->sitemap = getSitemap(action);
+  res->storeCompressed = getStoreCompressed(action);
+  types = getTypesSelected(action, &nbTypes);
+  initTypeMatcher(&(res->types), types, nbTypes);
+  if (res->versionning) initManifest(&(res->manifest), res->dirName);
+  initURLLog(&(res->log), res->dirName, resumed);
+  return res;
+}
+
+void delWrap(WrapAction **wrapper){
+  if ((*wrapper)->versionning && closeManifest(&((*wrapper)->manifest)) != 0){
+    fprintf(stderr, "Manifest of %s not fully saved.\n", (*wrapper)->action->name);
+  }
+  if (closeURLLog(&((*wrapper)->log)) != 0){
+    fprintf(stderr, "URL log of %s not fully saved.\n", (*wrapper)->action->name);
+  }
+  delTree(&((*wrapper)->tree));
+  delTypeMatcher(&((*wrapper)->types));
+  free((*wrapper)->dirName);
+  free(*wrapper);
+  *wrapper = NULL;
+}
+
+/**
+ * Initialize the Transfer attached to a curl easy handle
+ * @param easy : the easy handle downloading the URL
+ * @param crawl : the crawl of the task
+ * @param wrapper : the action the URL belongs to
+ * @param url : the URL as inserted in the tree
+ * @param depth : the depth of the URL from the initial URL
+ * @param kind : a page, or a list of pages
+ * @return : the transfer initialized
+ */
+Transfer *initTransfer(CURL *easy, Crawl *crawl, WrapAction *wrapper, char *url, int depth, URLKind kind){
+  Transfer *res = (Transfer*)malloc(sizeof(Transfer));
+  if (res == NULL){
+    fprintf(stderr, "Allocation for new Transfer failed.\n");
+    exit(1);
+  }
+  res->easy = easy;
+  res->multi = NULL;
+  res->crawl = crawl;
+  res->wrapper = wrapper;
+  res->url = strdup(url);
+  res->base = NULL;
+  res->depth = depth;
+  res->kind = kind;
+  res->classified = 0;
+  res->toSave = 0;
+  res->toScan = 0;
+  res->headFirst = 0;
+  res->skipped = 0;
+  res->skippedLength = -1;
+  initScanner(&(res->scanner));
+  res->list = NULL;
+  if (kind != URL_PAGE){
+    res->list = (SitemapReader*)malloc(sizeof(SitemapReader));
+    if (res->list == NULL){
+      fprintf(stderr, "Allocation for new Transfer failed.\n");
+      exit(1);
+    }
+    initSitemapReader(res->list, kind == URL_ROBOTS);
+  }
+  res->host = NULL;
+  initSha256(&(res->hash));
+  res->length = 0;
+  res->etag = NULL;
+  res->lastModified = NULL;
+  res->contentEncoding = NULL;
+  res->compressed = 0;
+  res->decoding = 0;
+  res->record = NULL;
+  res->conditions = NULL;
+  res->entry = NULL;
+  res->prev = NULL;
+  res->next = NULL;
+  return res;
+}
+
+void delTransfer(Transfer **transfer){
+  //a content still to save is incomplete (see storeContent),
+  //the copy saved before stays as it was
+  if ((*transfer)->toSave) discardSink(&((*transfer)->sink));
+  delScanner(&((*transfer)->scanner));
+  if ((*transfer)->decoding) delDecoder(&((*transfer)->decoder));
+  if ((*transfer)->list != NULL){
+    delSitemapReader((*transfer)->list);
+    free((*transfer)->list);
+  }
+  if ((*transfer)->record != NULL) delRecord(&((*transfer)->record));
+  curl_slist_free_all((*transfer)->conditions);
+  free((*transfer)->etag);
+  free((*transfer)->lastModified);
+  free((*transfer)->contentEncoding);
+  free((*transfer)->url);
+  free((*transfer)->base);
+  free(*transfer);
+  *transfer = NULL;
+}
+
+/**
+ * This function fix the extension in the name of a file
+ * according to its type. 
+ * If the file name alr has a valid extension then 
+ * *fileName won't be changed.
+ * Else, we create a new name with valid extension 
+ * then assign this name to the string pointed by fileName
+ * @param fileName: pointer to the string of fileName
+ * @param contentType : the MIME type of the content 
+ * to be saved (parsed)
+ * @return : this function does not return anything
+ * the filename fixed (or not) will be assigned back
+ * to the pointer passed in argument.
+ **/ 
+void fixExtension(char **fileName, const ContentType *contentType){
+  const char *validExt = getExtension(contentType);
+  char *pointExt;
+  char *newName;
+
+  if (validExt == NULL) {
+    fprintf(stderr, "File %s is not of a commun MIME type.", *fileName);
+    return;
+  }
+
+  pointExt = strstr(*fileName, validExt);
+  if (pointExt != NULL){
+    //the extension exists in fileName
+    newName = strndup(*fileName, pointExt + strlen(validExt) - *fileName);
+  }else{
+    //the current fileName does not contain valid extension
+    newName = (char*)malloc((strlen(*fileName) + strlen(validExt) + 1) * sizeof(char));
+    strcpy(newName, *fileName);
+    strcat(newName, validExt);
+  }
+  free(*fileName);
+  *fileName = newName;
+}
+
+/**
+ * Get the value of max-depth option of the action
+ * If the action does not have a max-depth option then return 0
+**/
+int getMaxDepth(Action *action){
+  int res = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case MAX_DEPTH:
+        res = action->options[i].val.depth;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+/**
+ * Return the value of versionning of the action
+ * If the action does not have versionning option, 
+ * versionning will be considered "off".
+**/ 
+int getVersionning(Action *action){
+  int res = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case VERSIONNING:
+        res = action->options[i].val.shift;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+/**
+ * Return the value of head-first of the action
+ * If the action does not have head-first option,
+ * head-first will be considered "off".
+**/
+int getHeadFirst(Action *action){
+  int res = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case HEAD_FIRST:
+        res = action->options[i].val.shift;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+/**
+ * Return the value of sitemap of the action
+ * If the action does not have sitemap option,
+ * sitemap will be considered "off".
+**/
+int getSitemap(Action *action){
+  int res = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case SITEMAP:
+        res = action->options[i].val.shift;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+/**
+ * Return the value of store-compressed of the action
+ * If the action does not have store-compressed option,
+ * store-compressed will be considered "off".
+**/
+int getStoreCompressed(Action *action){
+  int res = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case STORE_COMPRESSED:
+        res = action->options[i].val.shift;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+/**
+ * Get the types selected by the action
+ * If the action does not have a typeselect option,
+ * no type is returned (all types are saved)
+**/
+char **getTypesSelected(Action *action, int *nbTypes){
+  char **res = NULL;
+  *nbTypes = 0;
+  for (int i = 0; i < action->nbOptions; i++){
+    switch (action->options[i].type){
+      case TYPESELECT:
+        res = action->options[i].val.type.types;
+        *nbTypes = action->options[i].val.type.nbTypes;
+        break;
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+
+/**
+ * Called by the link scanner of a transfer for each URL
+ * found in its html content. The URL is normalized against
+ * the base of the page then added to the crawl if it has not
+ * been parsed yet. The href of a <base> tag becomes the base
+ * of the links which follow it.
+ * (only transfers whose depth < max-depth of the action 
+ * are scanned so the new URL never exceeds max-depth)
+ **/
+void addFoundURL(const char *url, size_t len, int isBase, void *transfer){
+  Transfer *t = (Transfer*)transfer;
+  WrapAction *wrapper = t->wrapper;
+  char *newURL;
+
+  newURL = normalizeURLSpan(url, len, t->base);
+  if (newURL == NULL) return;   //not an http(s) URL
+
+  if (isBase){
+    free(t->base);
+    t->base = newURL;
+    return;
+  }
+
+  //a checkpoint sees the URL either in both the tree and the frontier or in none
+  pthread_rwlock_rdlock(&(t->crawl->discovery));
+  if (insertURLIfNew(wrapper->tree, newURL, t->depth + 1)){
+    add_transfer(t->crawl, wrapper, newURL, t->depth + 1, URL_PAGE);
+  }
+  pthread_rwlock_unlock(&(t->crawl->discovery));
+  free(newURL);
+}
+
+/**
+ * Extract the links of a block of a content decoded here
+ * (a content saved compressed, see keepEncoded)
+ * @param transfer : the transfer of the content
+ * @return : 0, the decoding always goes on
+ **/
+static int scanDecoded(const char *data, size_t size, void *transfer){
+  Transfer *t = (Transfer*)transfer;
+
+  feedScanner(&(t->scanner), data, size, addFoundURL, t);
+  return 0;
+}
+
+/**
+ * Called by the reader of a robots.txt or of a sitemap for each
+ * URL it lists (the discovery lock of the crawl held in read and
+ * its lock held, see readList). A sitemap is queued at depth 0,
+ * so the lists are read before the pages, a page at depth 1.
+ **/
+static void addListedURL(const char *url, size_t len, int isSitemap, void *transfer){
+  Transfer *t = (Transfer*)transfer;
+  int depth = isSitemap ? 0 : 1;
+  char *newURL;
+
+  newURL = normalizeURLSpan(url, len, t->base);
+  if (newURL == NULL) return;
+  if (insertURLIfNew(t->wrapper->tree, newURL, depth)){
+    pushFrontier(&(t->crawl->frontier), newURL, depth, isSitemap ? URL_SITEMAP : URL_PAGE, t->wrapper);
+  }
+  free(newURL);
+}
+
+/**
+ * Read a chunk of a robots.txt or of a sitemap. The pages it
+ * lists are queued in bulk: the locks are taken once for all
+ * the URLs of the chunk, not once per URL.
+ * @param end : 1 if the list is over (data is then not read)
+ * @return : 0 if succeeded, -1 if the list is damaged or too large
+ **/
+static int readList(Transfer *transfer, const char *data, size_t size, int end){
+  int res = 0;
+
+  pthread_rwlock_rdlock(&(transfer->crawl->discovery));
+  pthread_mutex_lock(&(transfer->crawl->lock));
+  if (end) endSitemapReader(transfer->list, addListedURL, transfer);
+  else res = feedSitemapReader(transfer->list, data, size, addListedURL, transfer);
+  pthread_mutex_unlock(&(transfer->crawl->lock));
+  pthread_rwlock_unlock(&(transfer->crawl->discovery));
+  return res;
+}
+
+/**
+ * Extract the last part after '/' of url
+ * This part will be used to name the file that
+ * are saved the content of @param url
+ **/
+char *extractLastPart(char *url){
+  char *slash = strrchr(url, '/'); //last occurence of / in url
+  int size;
+  if (slash == url + strlen(url) - 1){
+    // www.abc.com/ the last / is useless
+    //we have to retrieve the / before this one
+    for (int i = strlen(url) - 2; i >= 0; --i){
+      if (*(url + i) == '/'){
+        slash = url + i;
+        size = (url + strlen(url) - 1) - slash - 1;
+        break;
+      }
+    }
+  }else{
+    size = (url + strlen(url)) - slash - 1;
+  }
+
+  return strndup(slash + 1, size);
+}
+
+
+/**
+ * Generate a path to save the content returned by libcurl
+ * Create directories if necessary (only once per run, 
+ * see directory.h)
+ * Path will be of format: 
+ * data/name of Action/type of content (text, image,..)/hash-name of file with extension
+ * where hash is the start of the SHA-256 of the URL: 2 URLs ending
+ * with the same name (every index.html) are never saved in the same file
+ * This function return the path of the file, NULL if its
+ * directory cannot be created
+ **/
+char *makeFilePath(Action *action, const ContentType *contentType, char *url){
+  char *filePath, *nameFile, *type, *actionName, hash[SHA256_HEX_SIZE];
+  const char *dirPath;
+  Sha256 ctx;
+  actionName = actionDirName(action);
+
+  type = strndup(contentType->type, contentType->lenMain);
+  dirPath = getDirectory(actionName, type);
+  free(type);
+  free(actionName);
+  if (dirPath == NULL) return NULL;
+
+  initSha256(&ctx);
+  updateSha256(&ctx, url, strlen(url));
+  finalSha256(&ctx, hash);
+  hash[URL_HASH_PREFIX] = '-';
+  hash[URL_HASH_PREFIX + 1] = '\0';
+
+  nameFile = extractLastPart(url);
+  fixExtension(&nameFile, contentType);
+  filePath = (char*)malloc((strlen(dirPath) + strlen(hash) + strlen(nameFile) + 1) * sizeof(char));
+  if (filePath == NULL){
+    fprintf(stderr, "Allocation for path of file failed.\n");
+    exit(1);
+  }
+  strcpy(filePath, dirPath);
+  strcat(filePath, hash);
+  strcat(filePath, nameFile);
+
+  free(nameFile);
+  return filePath;
+}
+
+
+/**
+ * Decide from its content type what to do with the content
+ * of a transfer:
+ * - save it if its type is one of those selected by the action
+ * - extract its links if it is html and the depth of its URL
+ * is less than the max-depth of the action.
+ * @param contentType : where the content type is parsed
+ **/
+static void judgeContent(Transfer *transfer, ContentType *contentType){
+  char *header;
+
+  curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_TYPE, &header);
+  parseContentType(contentType, header);
+  transfer->toSave = matchType(&(transfer->wrapper->types), contentType);
+  transfer->toScan = isOfType(contentType, "text/html")
+                    && transfer->depth < transfer->wrapper->maxDepth;
+}
+
+/**
+ * Prepare a transfer of an action with the store-compressed
+ * option: libcurl hands over the content as it was sent, it is
+ * saved so and its links are read from the bytes decoded here
+ * @param encoding : the encoding of the content
+ **/
+static void keepEncoded(Transfer *transfer, Encoding encoding){
+  if (encoding == ENCODING_IDENTITY) return;
+  transfer->compressed = 1;
+  if (!transfer->toScan) return;
+  if (initDecoder(&(transfer->decoder), encoding) == 0){
+    transfer->decoding = 1;
+  }else{
+    fprintf(stderr, "Content of %s cannot be decoded.\n", transfer->url);
+    transfer->toScan = 0;
+  }
+}
+
+/**
+ * Examine the content type of a transfer when its headers
+ * arrive (or its first chunk, for a protocol without headers)
+ * to decide what to do with its content (see judgeContent).
+ * An html content which is not of a selected type is only 
+ * scanned and never touches the disk.
+ * The path of the file of a content to save is resolved here,
+ * once for the whole transfer.
+ * A robots.txt or a sitemap is only read, whatever its type.
+ * A content saved compressed has the extension of its encoding
+ * after the one of its type.
+ **/
+void classifyTransfer(Transfer *transfer){
+  char *currURL, *filePath;
+  const char *objectsDir, *encodingExt;
+  ContentType contentType;
+  Encoding encoding = parseEncoding(transfer->contentEncoding);
+  Action *action = transfer->wrapper->action;
+
+  if (transfer->kind == URL_PAGE) judgeContent(transfer, &contentType);
+  else transfer->toScan = 1;
+  curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &currURL);
+  transfer->base = normalizeURL(currURL, NULL);
+  if (transfer->base == NULL) transfer->base = strdup(currURL);
+  transfer->classified = 1;
+  if (transfer->kind == URL_PAGE && transfer->wrapper->storeCompressed){
+    keepEncoded(transfer, encoding);
+  }
+
+  if (transfer->toSave && transfer->wrapper->versionning){
+    //the file of the content is known once it is hashed
+    objectsDir = getObjectsDirectory(transfer->wrapper->dirName);
+    if (objectsDir == NULL) transfer->toSave = 0;
+    else initObjectSink(&(transfer->sink), objectsDir);
+  }else if (transfer->toSave){
+    filePath = makeFilePath(action, &contentType, currURL);
+    if (filePath != NULL && transfer->compressed){
+      encodingExt = getEncodingExtension(encoding);
+      filePath = (char*)realloc(filePath, strlen(filePath) + strlen(encodingExt) + 1);
+      if (filePath == NULL){
+        fprintf(stderr, "Allocation for path of file failed.\n");
+        exit(1);
+      }
+      strcat(filePath, encodingExt);
+    }
+    if (filePath == NULL) transfer->toSave = 0;
+    else initSink(&(transfer->sink), filePath);
+  }
+}
+
+/*  
+* Called by libcurl for each chunk of data received.
+* The first chunk decides whether the content is saved and/or 
+* scanned (see classifyTransfer). 
+* Links found in an html content are added to the crawl
+* of the task right away, without waiting for the end of the 
+* download nor reading the content back from the disk.
+* So are the pages listed by a robots.txt or a sitemap.
+* A content saved compressed is decoded for its links only.
+*/ 
+size_t write_cb(void *data, size_t size, size_t nmemb, Transfer *transfer){
+  size_t res = size * nmemb;
+
+  if (!transfer->classified) classifyTransfer(transfer);
+
+  if (transfer->toSave){
+    res = writeSink(&(transfer->sink), data, size * nmemb);
+    updateSha256(&(transfer->hash), data, res);
+    transfer->length += res;
+  }
+
+  if (transfer->toScan && transfer->list != NULL){
+    //a size other than the chunk aborts the transfer
+    if (readList(transfer, data, size * nmemb, 0) != 0) return 0;
+  }else if (transfer->toScan && transfer->decoding){
+    if (feedDecoder(&(transfer->decoder), data, size * nmemb, scanDecoded, transfer) != 0){
+      //the content is still saved as it was sent
+      fprintf(stderr, "Content of %s cannot be decoded.\n", transfer->url);
+      transfer->toScan = 0;
+    }
+  }else if (transfer->toScan){
+    feedScanner(&(transfer->scanner), data, size * nmemb, addFoundURL, transfer);
+  }
+  return res;
+}
+
+/**
+ * Get the value of a header line if it is the header 'name'
+ * @return : the value without its spaces around, NULL if
+ * the line is another header
+ **/
+static char *headerValue(char *line, size_t len, const char *name){
+  size_t lenName = strlen(name);
+  char *start, *end = line + len;
+
+  if (len <= lenName || strncasecmp(line, name, lenName) != 0 || line[lenName] != ':') return NULL;
+  for (start = line + lenName + 1; start < end && (*start == ' ' || *start == '\t'); start++);
+  while (end > start && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) end--;
+  return strndup(start, end - start);
+}
+
+/**
+ * Decide what to do with the body of a response once all its
+ * headers arrived: the final response of a GET is classified (see
+ * classifyTransfer), the body of an error is never kept. A body
+ * not kept is not downloaded, unless it is small enough to be
+ * cheaper to read than to open another connection.
+ * The answer to a HEAD only tells if the GET is worth it.
+ * @return : 1 if the transfer goes on, 0 if it has to be aborted
+ **/
+static int checkHeaders(Transfer *transfer){
+  long code = 0;
+  curl_off_t length = -1;
+  ContentType contentType;
+
+  curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &code);
+  //an interim answer, or a redirection followed by libcurl
+  if (code < 200 || (code >= 300 && code < 400 && code != 304)) return 1;
+  if (code == 204 || code == 304){
+    //no body, whatever its Content-Length tells
+    transfer->classified = 1;
+    return 1;
+  }
+  curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+
+  if (transfer->headFirst){
+    if (code == 200){
+      judgeContent(transfer, &contentType);
+      transfer->skipped = !transfer->toSave && !transfer->toScan;
+      transfer->skippedLength = length;
+      transfer->toSave = 0;
+      transfer->toScan = 0;
+    }
+    return 1;
+  }
+  if (code == 200){
+    classifyTransfer(transfer);
+    if (transfer->toSave || transfer->toScan) return 1;
+  }else{
+    transfer->classified = 1;
+  }
+  if (length >= 0 && length <= DRAIN_LIMIT) return 1;
+  transfer->skipped = 1;
+  transfer->skippedLength = length;
+  return 0;
+}
+
+/*
+* Called by libcurl for each header line received.
+* The validators (ETag and Last-Modified) of the last response,
+* after the redirections, are kept for the metadata of the URL,
+* and so is its Content-Encoding.
+* The empty line ending the headers of a response is where its
+* body is kept or not (see checkHeaders).
+*/
+size_t header_cb(char *buffer, size_t size, size_t nitems, Transfer *transfer){
+  size_t len = size * nitems;
+  char *value;
+
+  if (len >= 5 && strncmp(buffer, "HTTP/", 5) == 0){
+    //status line of a new response
+    free(transfer->etag);
+    free(transfer->lastModified);
+    free(transfer->contentEncoding);
+    transfer->etag = NULL;
+    transfer->lastModified = NULL;
+    transfer->contentEncoding = NULL;
+  }else if ((value = headerValue(buffer, len, "ETag")) != NULL){
+    free(transfer->etag);
+    transfer->etag = value;
+  }else if ((value = headerValue(buffer, len, "Last-Modified")) != NULL){
+    free(transfer->lastModified);
+    transfer->lastModified = value;
+  }else if ((value = headerValue(buffer, len, "Content-Encoding")) != NULL){
+    free(transfer->contentEncoding);
+    transfer->contentEncoding = value;
+  }else if ((len == 2 && buffer[0] == '\r' && buffer[1] == '\n') || (len == 1 && buffer[0] == '\n')){
+    //a size other than len aborts the transfer
+    if (!checkHeaders(transfer)) return 0;
+  }
+  return len;
+}
+
+/**
+ * Add the header "name: value" to a list of headers
+ **/
+static void appendHeader(struct curl_slist **headers, const char *name, const char *value){
+  char *line = (char*)malloc(strlen(name) + strlen(value) + 3);
+  struct curl_slist *res;
+
+  if (line == NULL){
+    fprintf(stderr, "Allocation for header failed.\n");
+    exit(1);
+  }
+  sprintf(line, "%s: %s", name, value);
+  res = curl_slist_append(*headers, line);
+  free(line);
+  if (res == NULL){
+    fprintf(stderr, "Allocation for header failed.\n");
+    exit(1);
+  }
+  *headers = res;
+}
+
+/**
+ * Tell if the copy of a content saved by a previous run is intact:
+ * a whole file of the right size is trusted, a slice of a file (saved
+ * by the versions which appended the contents) only if its SHA-256
+ * is the one recorded
+ * @param record : the metadata of the content
+ * @param verify : 1 to check the SHA-256 of a whole file as well
+ * @return : 1 if the copy can be used, 0 if not
+ **/
+static int checkSavedCopy(URLRecord *record, int verify){
+  char hash[SHA256_HEX_SIZE], *buffer;
+  long left = record->length;
+  struct stat st;
+  Sha256 ctx;
+  size_t n;
+  FILE *f;
+
+  if (stat(record->filePath, &st) != 0 || st.st_size < record->offset + record->length){
+    return 0;
+  }
+  if (!verify && record->offset == 0 && st.st_size == record->length) return 1;
+
+  f = fopen(record->filePath, "r");
+  if (f == NULL) return 0;
+  if (fseek(f, record->offset, SEEK_SET) != 0){
+    fclose(f);
+    return 0;
+  }
+  buffer = (char*)malloc(SINK_MEMORY_SIZE * sizeof(char));
+  if (buffer == NULL){
+    fprintf(stderr, "Allocation for buffer failed.\n");
+    exit(1);
+  }
+  initSha256(&ctx);
+  while (left > 0 && (n = fread(buffer, 1, left < SINK_MEMORY_SIZE ? left : SINK_MEMORY_SIZE, f)) > 0){
+    updateSha256(&ctx, buffer, n);
+    left -= n;
+  }
+  free(buffer);
+  fclose(f);
+  finalSha256(&ctx, hash);
+  return left == 0 && strcmp(hash, record->hash) == 0;
+}
+
+/**
+ * Make the request of a transfer conditional if the content
+ * of its URL was saved by a previous run and is still whole on
+ * disk. The links of an html copy are read again if its server
+ * answers it has not changed: the whole copy is checked.
+ * A record whose copy is not whole is removed, it is never
+ * used again even if this transfer fails.
+ **/
+static void setConditions(Transfer *transfer){
+  URLRecord *record = findRecord(transfer->wrapper->store, transfer->url);
+  ContentType contentType;
+
+  if (record == NULL) return;
+  parseContentType(&contentType, record->contentType);
+  if (!checkSavedCopy(record, isOfType(&contentType, "text/html"))){
+    //the saved copy is gone or damaged, the content is downloaded again
+    removeRecord(transfer->wrapper->store, transfer->url);
+    delRecord(&record);
+    return;
+  }
+  transfer->record = record;
+  if (record->etag[0] != '\0'){
+    appendHeader(&(transfer->conditions), "If-None-Match", record->etag);
+  }
+  if (record->lastModified[0] != '\0'){
+    appendHeader(&(transfer->conditions), "If-Modified-Since", record->lastModified);
+  }
+  if (transfer->conditions != NULL){
+    curl_easy_setopt(transfer->easy, CURLOPT_HTTPHEADER, transfer->conditions);
+  }
+}
+
+/**
+ * Extract the links of the copy of a content saved by a
+ * previous run, when its server answered it has not changed
+ * (a copy saved compressed is decoded)
+ * (must not be called from a libcurl callback)
+ **/
+static void rescanSavedCopy(Transfer *transfer){
+  URLRecord *record = transfer->record;
+  long left = record->length;
+  char *buffer, *currURL;
+  ContentType contentType;
+  Encoding encoding = parseEncoding(record->contentEncoding);
+  size_t n;
+  FILE *f;
+
+  parseContentType(&contentType, record->contentType);
+  if (!isOfType(&contentType, "text/html") || encoding == ENCODING_UNKNOWN
+      || transfer->depth >= transfer->wrapper->maxDepth) return;
+
+  f = fopen(record->filePath, "r");
+  if (f == NULL || fseek(f, record->offset, SEEK_SET) != 0){
+    fprintf(stderr, "Cannot read saved copy of %s\n", transfer->url);
+    if (f != NULL) fclose(f);
+    return;
+  }
+  buffer = (char*)malloc(SINK_MEMORY_SIZE * sizeof(char));
+  if (buffer == NULL){
+    fprintf(stderr, "Allocation for buffer failed.\n");
+    exit(1);
+  }
+  curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &currURL);
+  transfer->base = normalizeURL(currURL, NULL);
+  if (transfer->base == NULL) transfer->base = strdup(currURL);
+
+  if (encoding != ENCODING_IDENTITY && initDecoder(&(transfer->decoder), encoding) == 0){
+    transfer->decoding = 1;
+  }
+
+  while (left > 0 && (n = fread(buffer, 1, left < SINK_MEMORY_SIZE ? left : SINK_MEMORY_SIZE, f)) > 0){
+    if (encoding == ENCODING_IDENTITY){
+      feedScanner(&(transfer->scanner), buffer, n, addFoundURL, transfer);
+    }else if (!transfer->decoding
+        || feedDecoder(&(transfer->decoder), buffer, n, scanDecoded, transfer) != 0){
+      fprintf(stderr, "Saved copy of %s cannot be decoded.\n", transfer->url);
+      break;
+    }
+    left -= n;
+  }
+  free(buffer);
+  fclose(f);
+}
+
+/**
+ * Write the content of a transfer on disk and record its metadata.
+ * With versionning, the content is an object saved under its hash.
+ * Without, a content still in memory and identical to the copy saved
+ * by a previous run (same length and hash) is not written again.
+ **/
+static void storeContent(Transfer *transfer){
+  URLRecord *record, *old = transfer->record;
+  char hash[SHA256_HEX_SIZE], *contentType, *filePath;
+
+  transfer->toSave = 0;
+  finalSha256(&(transfer->hash), hash);
+  if (transfer->length == 0){
+    closeSink(&(transfer->sink));
+    return;
+  }
+
+  record = initRecord(transfer->url);
+  if (transfer->wrapper->versionning){
+    //saved once under its hash, nothing is written if the object exists
+    filePath = makeObjectPath(transfer->wrapper->dirName, hash);
+    if (filePath == NULL || commitObjectSink(&(transfer->sink), filePath) != 0){
+      fprintf(stderr, "Content of %s not fully saved.\n", transfer->url);
+      if (filePath == NULL) discardSink(&(transfer->sink));
+      free(filePath);
+      delRecord(&record);
+      return;
+    }
+    record->offset = 0;
+    addToManifest(&(transfer->wrapper->manifest), transfer->url, hash, transfer->length);
+  }else if (old != NULL && transfer->sink.f == NULL
+      && old->length == transfer->length && strcmp(old->hash, hash) == 0){
+    //the server did not tell but the content has not changed
+    discardSink(&(transfer->sink));
+    filePath = strdup(old->filePath);
+    record->offset = old->offset;
+  }else{
+    filePath = strdup(transfer->sink.filePath);
+    if (closeSink(&(transfer->sink)) != 0){
+      fprintf(stderr, "Content of %s not fully saved.\n", transfer->url);
+      free(filePath);
+      delRecord(&record);
+      return;
+    }
+    record->offset = 0;
+  }
+  free(record->filePath);
+  record->filePath = filePath;
+  record->length = transfer->length;
+  strcpy(record->hash, hash);
+  if (transfer->etag != NULL){
+    free(record->etag);
+    record->etag = strdup(transfer->etag);
+  }
+  if (transfer->lastModified != NULL){
+    free(record->lastModified);
+    record->lastModified = strdup(transfer->lastModified);
+  }
+  curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_TYPE, &contentType);
+  if (contentType != NULL){
+    free(record->contentType);
+    record->contentType = strdup(contentType);
+  }
+  if (transfer->compressed && transfer->contentEncoding != NULL){
+    free(record->contentEncoding);
+    record->contentEncoding = strdup(transfer->contentEncoding);
+  }
+  updateRecord(transfer->wrapper->store, record);
+}
+
+/**
+ * Finish the reading of a robots.txt or of a sitemap. A site
+ * whose robots.txt gives no sitemap (or which has no robots.txt)
+ * may still have one at /sitemap.xml.
+ **/
+static void finishList(Transfer *transfer){
+  char *url;
+
+  if (transfer->toScan) readList(transfer, NULL, 0, 1);
+  if (transfer->kind != URL_ROBOTS || transfer->list->nbFound > 0) return;
+  url = normalizeURL("/sitemap.xml", transfer->url);
+  if (url == NULL) return;
+  pthread_rwlock_rdlock(&(transfer->crawl->discovery));
+  if (insertURLIfNew(transfer->wrapper->tree, url, 0)){
+    add_transfer(transfer->crawl, transfer->wrapper, url, 0, URL_SITEMAP);
+  }
+  pthread_rwlock_unlock(&(transfer->crawl->discovery));
+  free(url);
+}
+
+/**
+ * Handle the answer of a transfer once it is over: the links of
+ * a content which has not changed are extracted from its saved
+ * copy, a content downloaded is written and its metadata recorded
+ **/
+static void finishTransfer(Transfer *transfer, CURLcode result){
+  long code = 0;
+
+  if (transfer->list != NULL){
+    finishList(transfer);
+    return;
+  }
+  //a content not kept is done as well
+  if (result != CURLE_OK && !transfer->skipped) return;
+  addToURLLog(&(transfer->wrapper->log), skipProtocol(transfer->url));
+  curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &code);
+  if (code == 304 && transfer->record != NULL){
+    rescanSavedCopy(transfer);
+    if (transfer->wrapper->versionning){
+      addToManifest(&(transfer->wrapper->manifest), transfer->url,
+                    transfer->record->hash, transfer->record->length);
+    }
+  }else if (transfer->toSave) storeContent(transfer);
+}
+ 
+/**
+ * Queue an URL in the frontier of the crawl, its transfer
+ * is created when its host is allowed to start one
+ * @param crawl : the crawl of the task
+ * @param wrapper : the action the URL belongs to
+ * @param url : the URL to download, NULL for the initial URL of the action
+ * @param depth : the depth of the URL from the initial URL
+ * @param kind : a page, or a list of pages
+ **/
+void add_transfer(Crawl *crawl, WrapAction *wrapper, char *url, int depth, URLKind kind)
+{
+  if (url == NULL) url = wrapper->action->url;
+  pthread_mutex_lock(&(crawl->lock));
+  pushFrontier(&(crawl->frontier), url, depth, kind, wrapper);
+  pthread_mutex_unlock(&(crawl->lock));
+}
+
+/**
+ * Remove an URL admitted by a crawl from its admitted URLs
+ * and free it (the lock of the crawl held)
+ **/
+static void forgetAdmitted(Crawl *crawl, FrontierEntry *entry){
+  if (entry->prev != NULL) entry->prev->next = entry->next;
+  else crawl->admitted = entry->next;
+  if (entry->next != NULL) entry->next->prev = entry->prev;
+  delFrontierEntry(entry);
+}
+
+/**
+ * Remove a transfer from the transfers in progress
+ * of its crawl (the lock of the crawl held)
+ **/
+static void unlinkTransfer(Crawl *crawl, Transfer *transfer){
+  if (transfer->prev != NULL) transfer->prev->next = transfer->next;
+  else crawl->running = transfer->next;
+  if (transfer->next != NULL) transfer->next->prev = transfer->prev;
+}
+
+/**
+ * Take one of the free slots of a crawl for the least deep URL
+ * of its frontier whose host is allowed to start a transfer now
+ * @param crawl : the crawl
+ * @param now : the current time (ms)
+ * @param entry, host : where the URL and its host are saved
+ * @return : 1 if an URL was taken, 0 if none can start now
+ **/
+int admitTransfer(Crawl *crawl, long long now, FrontierEntry **entry, FrontierHost **host){
+  int res = 0;
+
+  pthread_mutex_lock(&(crawl->lock));
+  if (!crawl->finished && crawl->nbActive < crawl->maxTransfers){
+    *entry = popFrontier(&(crawl->frontier), now, host);
+    if (*entry != NULL){
+      //kept until its transfer is done, for the checkpoints
+      (*entry)->prev = NULL;
+      (*entry)->next = crawl->admitted;
+      if (crawl->admitted != NULL) crawl->admitted->prev = *entry;
+      crawl->admitted = *entry;
+      crawl->nbActive++;
+      res = 1;
+    }
+  }
+  pthread_mutex_unlock(&(crawl->lock));
+  return res;
+}
+
+/**
+ * Compute how long until a crawl can admit a transfer
+ * @param crawl : the crawl
+ * @param now : the current time (ms)
+ * @return : the delay in ms, -1 if waiting is not enough
+ * (no URL waiting, no free slot or all the hosts busy)
+ **/
+long long nextAdmission(Crawl *crawl, long long now){
+  long long res = -1;
+
+  pthread_mutex_lock(&(crawl->lock));
+  if (!crawl->finished && crawl->nbActive < crawl->maxTransfers){
+    res = nextDispatchFrontier(&(crawl->frontier), now);
+  }
+  pthread_mutex_unlock(&(crawl->lock));
+  return res;
+}
+
+/**
+ * Tell if an URL is asked with HEAD first: its action has the
+ * head-first option and the extension of the URL announces a
+ * large content of a type the action does not keep
+ **/
+static int isWorthHead(Transfer *transfer){
+  WrapAction *wrapper = transfer->wrapper;
+  ContentType guessed;
+  int mime;
+
+  if (!wrapper->headFirst || wrapper->types.all) return 0;
+  mime = guessTypeFromURL(transfer->url);
+  if (!isBulkyType(mime)) return 0;
+  parseContentType(&guessed, allMIMEs[mime].type);
+  return !matchType(&(wrapper->types), &guessed);
+}
+
+/**
+ * Create the transfer of an URL admitted by its crawl
+ * and add it to a multi handle
+ * (must not be called from a libcurl callback)
+ * @param multi : the multi handle running the transfer
+ * @param crawl : the crawl which admitted the URL
+ * @param entry : the URL (freed with the transfer)
+ * @param host : the host of the URL
+ **/
+void startTransfer(CURLM *multi, Crawl *crawl, FrontierEntry *entry, FrontierHost *host){
+  CURL *eh;
+  Transfer *transfer;
+
+  pthread_mutex_lock(&(crawl->lock));
+  eh = takeEasyHandle(&(crawl->stats));
+  if (eh == NULL){
+    fprintf(stderr, "Cannot initialize curl_easy.\n");
+    exit(1);
+  }
+  transfer = initTransfer(eh, crawl, (WrapAction*)entry->owner, entry->url, entry->depth, entry->kind);
+  transfer->multi = multi;
+  transfer->host = host;
+  transfer->entry = entry;
+  transfer->next = crawl->running;
+  if (crawl->running != NULL) crawl->running->prev = transfer;
+  crawl->running = transfer;
+  pthread_mutex_unlock(&(crawl->lock));
+
+  curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, write_cb);
+  curl_easy_setopt(eh, CURLOPT_WRITEDATA, transfer);
+  curl_easy_setopt(eh, CURLOPT_HEADERFUNCTION, header_cb);
+  curl_easy_setopt(eh, CURLOPT_HEADERDATA, transfer);
+  if (transfer->kind == URL_PAGE){
+    //the lists are read again at each run, whole
+    setConditions(transfer);
+    transfer->headFirst = isWorthHead(transfer);
+  }
+  if (transfer->headFirst) curl_easy_setopt(eh, CURLOPT_NOBODY, 1L);
+  //the contents come compressed when their server can, libcurl decodes them
+  curl_easy_setopt(eh, CURLOPT_ACCEPT_ENCODING, "");
+  if (transfer->kind == URL_PAGE && transfer->wrapper->storeCompressed){
+    //only the encodings decoded here, the contents are saved as sent
+    curl_easy_setopt(eh, CURLOPT_ACCEPT_ENCODING, "gzip, deflate");
+    curl_easy_setopt(eh, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+  }
+  curl_easy_setopt(eh, CURLOPT_URL, transfer->url);
+  curl_easy_setopt(eh, CURLOPT_PRIVATE, (void*)transfer);
+  curl_easy_setopt(eh, CURLOPT_FOLLOWLOCATION, 1L);
+  //no signal to time out the resolutions of names, other threads run
+  curl_easy_setopt(eh, CURLOPT_NOSIGNAL, 1L);
+  curl_multi_add_handle(multi, eh);
+}
+
+/**
+ * Replace the logs of the actions of a crawl over by the lists
+ * of all the URLs of their trees (the lock of the crawl held).
+ * No other crawl writes these files: a crawl has its actions
+ * to itself (see claimActions).
+ **/
+static void saveURLLists(Crawl *crawl){
+  char *path;
+
+  for (int i = 0; i < crawl->task->nbActions; i++){
+    //nothing more is written in the log
+    flushURLLog(&(crawl->wrappers[i]->log));
+    path = makeURLLogPath(crawl->wrappers[i]->dirName);
+    if (path == NULL || saveAllURLs(crawl->wrappers[i]->tree, path) != 0){
+      fprintf(stderr, "URLs of %s not saved.\n", crawl->wrappers[i]->action->name);
+    }
+    free(path);
+  }
+}
+
+/**
+ * Send the GET of a transfer whose HEAD is over, on the same handle,
+ * if the content is kept by its action or its server does not answer
+ * to HEAD (the transfer keeps its slot and its host)
+ * (must not be called from a libcurl callback)
+ * @param multi : the multi handle running the transfer
+ * @param easy : the easy handle of the transfer
+ * @param result : the result of the HEAD
+ * @return : 1 if the GET was sent, 0 if the transfer is over
+ **/
+int followHeadWithGet(CURLM *multi, CURL *easy, CURLcode result){
+  Transfer *transfer;
+  long code = 0;
+
+  curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+  if (!transfer->headFirst) return 0;
+  transfer->headFirst = 0;
+  pthread_mutex_lock(&(transfer->crawl->lock));
+  transfer->crawl->stats.nbHeads++;
+  pthread_mutex_unlock(&(transfer->crawl->lock));
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+  if (result != CURLE_OK || transfer->skipped || (code != 200 && code != 405 && code != 501)){
+    return 0;
+  }
+
+  curl_multi_remove_handle(multi, easy);
+  pthread_mutex_lock(&(transfer->crawl->lock));
+  addTransferStats(easy, &(transfer->crawl->stats));
+  pthread_mutex_unlock(&(transfer->crawl->lock));
+  transfer->classified = 0;
+  free(transfer->etag);
+  free(transfer->lastModified);
+  free(transfer->contentEncoding);
+  transfer->etag = NULL;
+  transfer->lastModified = NULL;
+  transfer->contentEncoding = NULL;
+  curl_easy_setopt(easy, CURLOPT_NOBODY, 0L);
+  curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+  curl_multi_add_handle(multi, easy);
+  return 1;
+}
+
+/**
+ * Remove a finished transfer from its multi handle and free it,
+ * its slot in its crawl and its host can start another transfer.
+ * The crawl is freed if this was its last transfer.
+ * @param multi : the multi handle running the transfer
+ * @param easy : the easy handle of the transfer
+ * @param result : the result of the transfer
+ * @return : 1 if the crawl of the transfer is over, 0 if not
+ **/
+int endTransfer(CURLM *multi, CURL *easy, CURLcode result){
+  Transfer *transfer;
+  Crawl *crawl;
+  FrontierHost *host;
+  FrontierEntry *entry;
+  curl_off_t skippedLength;
+  int over, skipped;
+
+  curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+  crawl = transfer->crawl;
+  host = transfer->host;
+  entry = transfer->entry;
+  skipped = transfer->skipped;
+  skippedLength = transfer->skippedLength;
+  //the links were extracted while the content was downloaded,
+  //unless it has not changed since the last run
+  finishTransfer(transfer, result);
+  pthread_mutex_lock(&(crawl->lock));
+  unlinkTransfer(crawl, transfer);
+  pthread_mutex_unlock(&(crawl->lock));
+  delTransfer(&transfer);
+  curl_multi_remove_handle(multi, easy);
+
+  pthread_mutex_lock(&(crawl->lock));
+  if (skipped){
+    crawl->stats.nbSkipped++;
+    if (skippedLength > 0) crawl->stats.nbBytesSkipped += skippedLength;
+  }
+  giveBackEasyHandle(easy, &(crawl->stats));
+  doneFrontier(&(crawl->frontier), host);
+  forgetAdmitted(crawl, entry);
+  crawl->nbActive--;
+  //no transfer left to find new URLs
+  over = crawl->nbActive == 0 && crawl->frontier.nbWaiting == 0;
+  if (over){
+    //complete, the next run starts from the beginning
+    removeCheckpoint(crawl);
+    saveURLLists(crawl);
+    delCrawl(crawl);
+  }
+  pthread_mutex_unlock(&(crawl->lock));
+  return over;
+}
+
+/**
+ * Stop a crawl before its end (must not be called while its
+ * transfers run): the transfers in progress are dropped and
+ * the crawl is freed, its URLs not done yet stay in its last
+ * checkpoint (see checkpoint.h)
+ * @param crawl : the crawl
+ **/
+void stopCrawl(Crawl *crawl){
+  Transfer *transfer;
+  CURL *easy;
+
+  pthread_mutex_lock(&(crawl->lock));
+  while ((transfer = crawl->running) != NULL){
+    easy = transfer->easy;
+    unlinkTransfer(crawl, transfer);
+    doneFrontier(&(crawl->frontier), transfer->host);
+    forgetAdmitted(crawl, transfer->entry);
+    crawl->nbActive--;
+    curl_multi_remove_handle(transfer->multi, easy);
+    delTransfer(&transfer);
+    giveBackEasyHandle(easy, &(crawl->stats));
+  }
+  if (!crawl->finished) delCrawl(crawl);
+  pthread_mutex_unlock(&(crawl->lock));
+}
+
+/**
+ * Initialize the crawl of a task and queue the
+ * initial URLs of its actions, or the URLs not done
+ * yet if the task has a checkpoint
+ * @param crawl : the crawl to be initialized
+ * @param task : the task
+ **/
+void initCrawl(Crawl *crawl, Task *task){
+  pthread_rwlockattr_t attr;
+  char *seed, *robots;
+
+  crawl->task = task;
+  crawl->admitted = NULL;
+  crawl->running = NULL;
+  crawl->nbActive = 0;
+  crawl->maxTransfers = task->limits.maxTransfers;
+  crawl->finished = 0;
+  memset(&(crawl->stats), 0, sizeof(NetworkStats));
+  pthread_mutex_init(&(crawl->lock), NULL);
+  //a checkpoint waits for the URLs being added, not for a stream of them
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&(crawl->discovery), &attr);
+  pthread_rwlockattr_destroy(&attr);
+  initFrontier(&(crawl->frontier), task->limits.hostConnections, task->limits.hostDelay);
+
+  crawl->wrappers = (WrapAction**)malloc(task->nbActions * sizeof(WrapAction*));
+  if (crawl->wrappers == NULL){
+    fprintf(stderr, "Allocation for new Crawl failed.\n");
+    exit(1);
+  }
+  //a crawl stopped before its end goes on from its checkpoint
+  if (loadCheckpoint(crawl)) return;
+  for (int i = 0; i < task->nbActions; i++){
+    seed = normalizeURL(task->actions[i]->url, NULL);
+    if (seed == NULL) seed = strdup(task->actions[i]->url);
+    crawl->wrappers[i] = initWrap(task->actions[i], makeTree(seed), 0);
+    add_transfer(crawl, crawl->wrappers[i], seed, 0, URL_PAGE);
+    //the pages listed by the sitemaps are at depth 1
+    robots = crawl->wrappers[i]->sitemap && crawl->wrappers[i]->maxDepth >= 1
+            ? normalizeURL("/robots.txt", seed) : NULL;
+    if (robots != NULL && insertURLIfNew(crawl->wrappers[i]->tree, robots, 0)){
+      add_transfer(crawl, crawl->wrappers[i], robots, 0, URL_ROBOTS);
+    }
+    free(robots);
+    free(seed);
+  }
+}
+
+/**
+ * Print out the results of a crawl whose transfers are
+ * all done and free it (its lock is kept until the end
+ * of the run as other threads may still look at it)
+ * @param crawl : the crawl
+ **/
+void delCrawl(Crawl *crawl){
+  for (int i = 0; i < crawl->task->nbActions; i++){
+    printTreeUsage(crawl->wrappers[i]->tree, crawl->wrappers[i]->action->name, stderr);
+    if (saveMetaStore(crawl->wrappers[i]->store) != 0){
+      fprintf(stderr, "Metadata of %s not saved.\n", crawl->wrappers[i]->action->name);
+    }
+    delWrap(&(crawl->wrappers[i]));
+  }
+  free(crawl->wrappers);
+  crawl->wrappers = NULL;
+  printNetworkStats(&(crawl->stats), crawl->task->name, stderr);
+  delFrontier(&(crawl->frontier));
+  //the URLs admitted and not started when the crawl was stopped
+  while (crawl->admitted != NULL) forgetAdmitted(crawl, crawl->admitted);
+  crawl->finished = 1;
+}
+
+/**
+ * Tell if the directory of an action is used by
+ * a crawl in progress (the lock of the registry held)
+ **/
+static int isActionBusy(const char *dirName){
+  for (BusyAction *busy = busyActions; busy != NULL; busy = busy->next){
+    if (strcmp(busy->dirName, dirName) == 0) return 1;
+  }
+  return 0;
+}
+
+/**
+ * Take the directories of all the actions of a task for its crawl,
+ * none of them may be used by another crawl (see Crawl)
+ * @param task : the task
+ * @param wait : 1 to wait until they are all free, 0 to give up
+ * @return : 1 if they were taken, 0 if not
+ **/
+static int claimActions(Task *task, int wait){
+  char **dirNames = (char**)malloc(task->nbActions * sizeof(char*));
+  BusyAction *busy;
+  int isFree = 0;
+
+  if (dirNames == NULL){
+    fprintf(stderr, "Allocation for busy actions failed.\n");
+    exit(1);
+  }
+  for (int i = 0; i < task->nbActions; i++) dirNames[i] = actionDirName(task->actions[i]);
+
+  pthread_mutex_lock(&busyLock);
+  while (!isFree){
+    isFree = 1;
+    for (int i = 0; i < task->nbActions && isFree; i++){
+      isFree = !isActionBusy(dirNames[i]);
+    }
+    if (isFree || !wait) break;
+    pthread_cond_wait(&busyFree, &busyLock);
+  }
+  for (int i = 0; i < task->nbActions; i++){
+    if (isFree){
+      busy = (BusyAction*)malloc(sizeof(BusyAction));
+      if (busy == NULL){
+        fprintf(stderr, "Allocation for busy actions failed.\n");
+        exit(1);
+      }
+      busy->dirName = dirNames[i];
+      busy->next = busyActions;
+      busyActions = busy;
+    }else{
+      free(dirNames[i]);
+    }
+  }
+  pthread_mutex_unlock(&busyLock);
+  free(dirNames);
+  return isFree;
+}
+
+/**
+ * Give back the directories of the actions of a task
+ * once its crawl is over
+ * @param task : the task
+ **/
+static void releaseActions(Task *task){
+  BusyAction **link, *busy;
+  char *dirName;
+
+  pthread_mutex_lock(&busyLock);
+  for (int i = 0; i < task->nbActions; i++){
+    dirName = actionDirName(task->actions[i]);
+    for (link = &busyActions; *link != NULL; link = &((*link)->next)){
+      if (strcmp((*link)->dirName, dirName) == 0) break;
+    }
+    if (*link != NULL){
+      busy = *link;
+      *link = busy->next;
+      free(busy->dirName);
+      free(busy);
+    }
+    free(dirName);
+  }
+  pthread_cond_broadcast(&busyFree);
+  pthread_mutex_unlock(&busyLock);
+}
+
+/**
+ * Run one task until all its transfers are done, once
+ * no other crawl uses one of its actions
+ * @param task : the task
+ * @param nbThreads : the number of threads running the transfers
+ **/
+void parseATask(Task *task, int nbThreads){
+  Crawl crawl;
+
+  claimActions(task, 1);
+  //a stop asked while waiting: the task is not started
+  if (!stopAsked()){
+    initCrawl(&crawl, task);
+    runEngine(&crawl, 1, nbThreads);
+    pthread_mutex_destroy(&(crawl.lock));
+    pthread_rwlock_destroy(&(crawl.discovery));
+  }
+  releaseActions(task);
+}
+
+/**
+ * Run all the tasks of a configuration at the same time,
+ * the run lasts as long as its slowest task. A task sharing
+ * an action with a task started before waits for it: the
+ * tasks are run by batches of tasks without common action.
+ * @param config : the configuration
+ * @param nbThreads : the number of threads running the transfers
+ **/
+void parseConfig(Configure *config, int nbThreads){
+  Crawl *crawls;
+  int *started, nbStarted = 0, nbBatch;
+
+  if (config->nbTask == 0) return;
+  crawls = (Crawl*)malloc(config->nbTask * sizeof(Crawl));
+  started = (int*)calloc(config->nbTask, sizeof(int));
+  if (crawls == NULL || started == NULL){
+    fprintf(stderr, "Allocation for crawls failed.\n");
+    exit(1);
+  }
+
+  while (nbStarted < config->nbTask && !stopAsked()){
+    nbBatch = 0;
+    for (int i = 0; i < config->nbTask; i++){
+      //the first task left always starts, the others if their actions are free
+      if (started[i] || !claimActions(config->tasks[i], nbBatch == 0)) continue;
+      started[i] = 1;
+      nbStarted++;
+      initCrawl(crawls + nbBatch, config->tasks[i]);
+      nbBatch++;
+    }
+    runEngine(crawls, nbBatch, nbThreads);
+
+    for (int i = 0; i < nbBatch; i++){
+      pthread_mutex_destroy(&(crawls[i].lock));
+      pthread_rwlock_destroy(&(crawls[i].discovery));
+      releaseActions(crawls[i].task);
+    }
+  }
+  free(started);
+  free(crawls);
+}
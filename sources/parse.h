@@ -1,84 +1,209 @@
-/*
-**  Filename : parse.h
-**
-**  Made by : CAO Song Toan
-**
-**  Description :   Interface managing the parsing of website 
-**                  determined by the configuration
-*/
-#ifndef __PARSE
-#define __PARSE
-
-#include "configuration.h"
-#include "url.h"
-
-#define NB_MIME_TYPES 62
-#define BUFFER_SIZE 2000
-
-
-
-typedef struct typeMIME{
-  char *type;
-  char *extension;
-}TypeMIME;
-
-extern TypeMIME* allMIMEs;
-
-/*Each Action will be associated with its tree of URLs 
-* by this wrapper. This wrapper allows us to get access
-* to the initial action (its name, url and options) 
-* and at the same time manipulate its tree associated.
-* A WrapAction will be initiated when the Action enters 
-* scrapping process and will be destroy when all scrapping
-* is done.
-*/
-typedef struct wrapAction{
-  Action *action;
-  Node root;
-}WrapAction;
-
-/*LinkEasyMulti is the association between a curl easy handle 
-* and a curl multi handle. A curl easy handle is to manage 
-* the scrapping of a URL while the multi handle is used to
-* manage all the scrapping process of a task.
-*/
-typedef struct linkEasyMulti{
-  CURL *easy;
-  CURLM *multi;
-}LinkEasyMulti;
-
-
-
-void delAllMIME(TypeMIME *allMIME);
-
-TypeMIME *initAllMIME();
-
-WrapAction *initWrap(Action *action, Node root);
-
-void delWrap(WrapAction **wrapper);
-
-LinkEasyMulti *initLink(CURL *easy, CURLM *multi);
-
-void delLink(LinkEasyMulti *link);
-
-int isTypeSelected(char *type, Action *action);
-
-char *extractLastPart(char *url);
-
-char *makeFilePath(Action *action, char *contentType, char *url);
-
-size_t saveData(void *data, size_t size, size_t nmemb, char *dataType, char *filePath, char *url);
-
-void getURLsFromFile(FILE *f, CURLM *cm, WrapAction *wrapper, char* URLOfFile);
-
-void reconstructURL(char **URLRelative, char *URLDomain);
-
-size_t write_cb(void *data, size_t size, size_t nmemb, CURL *easy);
- 
-void add_transfer(CURLM *cm, WrapAction *wrapper, char *url);
-
-void parseATask(Task *task);
-
-void parseConfig(Configure *config);
-
+/*
+**  Filename : parse.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description :   Interface managing the parsing of website 
+**                  determined by the configuration
+*/
+#ifndef __PARSE
+#define __PARSE
+
+#include <pthread.h>
+#include <curl/curl.h>
+#include "configuration.h"
+#include "url.h"
+#include "extract.h"
+#include "sink.h"
+#include "frontier.h"
+#include "network.h"
+#include "metastore.h"
+#include "hash.h"
+#include "objectstore.h"
+#include "urllog.h"
+#include "mime.h"
+#include "sitemap.h"
+#include "decoder.h"
+
+#define DRAIN_LIMIT (16 * 1024)   //a body not kept up to this size is read
+                                  //anyway, to keep its connection open
+#define URL_HASH_PREFIX 16        //nb of hex digits of the hash of the URL
+                                  //put before the name of its file
+
+/*Each Action will be associated with its tree of URLs 
+* by this wrapper. This wrapper allows us to get access
+* to the initial action (its name, url and options) 
+* and at the same time manipulate its tree associated.
+* A WrapAction will be initiated when the Action enters 
+* scrapping process and will be destroy when all scrapping
+* is done.
+*/
+typedef struct wrapAction{
+  Action *action;
+  URLTree *tree;
+  MetaStore *store;     //metadata of the contents saved by the action
+  char *dirName;        //name of its directory (spaces replaced by '_')
+  int versionning;      //1 if its contents are saved as objects
+  int maxDepth;         //its max-depth option
+  int headFirst;        //its head-first option
+  int sitemap;          //its sitemap option
+  int storeCompressed;  //its store-compressed option
+  TypeMatcher types;    //its typeselect option compiled
+  Manifest manifest;    //contents of the run (only if versionning)
+  URLLog log;           //URLs done by the action
+}WrapAction;
+
+/*What an URL of the frontier is for its action: a page, or
+* a list of pages (robots.txt and sitemaps, see sitemap.h)
+* read to queue the pages it lists, never saved nor logged
+* as a content. The pages listed by the sitemaps of an
+* action are queued at depth 1, as the links of its initial
+* URL, the sitemaps themselves at depth 0.
+*/
+typedef enum urlKind{URL_PAGE, URL_ROBOTS, URL_SITEMAP} URLKind;
+
+/*A Transfer is the private data of a curl easy handle.
+* It keeps everything needed to process the content of an URL
+* while this content is being downloaded: the action it belongs
+* to, the crawl where new URLs are added, the depth of the URL
+* and the state of the extraction of its links.
+* If the content of the URL was saved by a previous run, the
+* request is conditional (see metastore.h): a 304 answer means
+* the saved copy is still valid and its links are extracted
+* from it.
+* Whether a content is kept is decided once its headers arrive:
+* a body neither saved nor scanned is not downloaded. With the
+* head-first option, an URL whose extension announces a large
+* content of a type the action does not keep is asked with HEAD,
+* and with GET only if its real type is kept.
+* The contents are asked compressed and libcurl decodes them.
+* With the store-compressed option, a page is saved as it was
+* sent (gzip or deflate) and decoded here for its links only.
+*/
+typedef struct transfer{
+  CURL *easy;
+  CURLM *multi;         //the multi handle running it
+  struct crawl *crawl;
+  WrapAction *wrapper;
+  char *url;            //the URL as inserted in the tree (normalized)
+  char *base;           //the URL really fetched (after redirections)
+                        //or the <base href> of the page, normalized
+                        //relative links are resolved against it
+  int depth;            //depth of the URL from the initial URL of the action
+  URLKind kind;
+  int classified;       //1 once the content type has been examined
+  int toSave;           //1 if the content has to be saved on disk
+  int toScan;           //1 if the links of the content have to be extracted
+  int headFirst;        //1 while its HEAD request runs
+  int skipped;          //1 if its content is not downloaded (not kept)
+  curl_off_t skippedLength; //the size of this content, -1 if not told
+  OutputSink sink;      //only used if toSave
+  LinkScanner scanner;
+  SitemapReader *list;  //only for a robots.txt or a sitemap
+  FrontierHost *host;   //the host of the URL in the frontier
+  Sha256 hash;          //hash of the content saved
+  long length;          //nb of bytes of the content saved
+  char *etag;           //validators of the last response, NULL if none
+  char *lastModified;
+  char *contentEncoding;  //Content-Encoding of the last response, NULL if none
+  int compressed;       //1 if the content is saved as it was sent
+  int decoding;         //1 if its links are read through decoder
+  Decoder decoder;
+  URLRecord *record;    //content saved by a previous run, NULL if none
+  struct curl_slist *conditions;  //headers of the conditional request
+  FrontierEntry *entry; //its URL, among the URLs admitted by the crawl
+  struct transfer *prev;  //the transfers of the crawl in progress
+  struct transfer *next;
+}Transfer;
+
+/*A Crawl gathers all the transfers of a task.
+* Links are found inside write_cb, i.e. while libcurl is running,
+* and libcurl forbids adding a handle to the multi handle from one
+* of its callbacks. New URLs therefore wait in the frontier: a
+* transfer (and its curl handle) is created when one of the
+* maxTransfers slots of the crawl is free and the host of its URL
+* is allowed to start one (see frontier.h). The memory used by a 
+* crawl thus depends on maxTransfers, not on the size of the frontier.
+* The transfers of a crawl may run in several threads (see engine.h),
+* the lock of the crawl guards its frontier, its slots and its stats.
+* A new URL is inserted in a tree and queued in the frontier under the
+* discovery lock (read), a checkpoint (see checkpoint.h) takes it in
+* write to see every URL of the trees either done or still to do.
+* The crawls of several tasks run at the same time, but never 2 crawls
+* of the same action (or of 2 actions with the same directory): the
+* URL log, the list of the URLs, the manifest and the metadata of an
+* action have one writer. A task sharing an action with a crawl in
+* progress waits for its end (parseATask), parseConfig runs the tasks
+* by batches of tasks without common action.
+*/
+typedef struct crawl{
+  Task *task;
+  WrapAction **wrappers;    //the actions of the task with their trees
+  pthread_mutex_t lock;
+  pthread_rwlock_t discovery;
+  Frontier frontier;        //URLs not downloaded yet
+  FrontierEntry *admitted;  //URLs admitted and not done yet (linked by prev/next)
+  Transfer *running;        //transfers in progress
+  int nbActive;             //nb of URLs admitted and not done yet
+  int maxTransfers;
+  NetworkStats stats;
+  int finished;             //1 once all its transfers are done
+}Crawl;
+
+
+
+WrapAction *initWrap(Action *action, URLTree *tree, int resumed);
+
+void delWrap(WrapAction **wrapper);
+
+int getMaxDepth(Action *action);
+
+int getVersionning(Action *action);
+
+int getHeadFirst(Action *action);
+
+int getSitemap(Action *action);
+
+int getStoreCompressed(Action *action);
+
+Transfer *initTransfer(CURL *easy, Crawl *crawl, WrapAction *wrapper, char *url, int depth, URLKind kind);
+
+void delTransfer(Transfer **transfer);
+
+char **getTypesSelected(Action *action, int *nbTypes);
+
+char *extractLastPart(char *url);
+
+char *makeFilePath(Action *action, const ContentType *contentType, char *url);
+
+size_t saveData(void *data, size_t size, size_t nmemb, char *dataType, char *filePath, char *url);
+
+void addFoundURL(const char *url, size_t len, int isBase, void *transfer);
+
+size_t write_cb(void *data, size_t size, size_t nmemb, Transfer *transfer);
+
+size_t header_cb(char *buffer, size_t size, size_t nitems, Transfer *transfer);
+ 
+void add_transfer(Crawl *crawl, WrapAction *wrapper, char *url, int depth, URLKind kind);
+
+int admitTransfer(Crawl *crawl, long long now, FrontierEntry **entry, FrontierHost **host);
+
+long long nextAdmission(Crawl *crawl, long long now);
+
+void startTransfer(CURLM *multi, Crawl *crawl, FrontierEntry *entry, FrontierHost *host);
+
+int followHeadWithGet(CURLM *multi, CURL *easy, CURLcode result);
+
+int endTransfer(CURLM *multi, CURL *easy, CURLcode result);
+
+void stopCrawl(Crawl *crawl);
+
+void initCrawl(Crawl *crawl, Task *task);
+
+void delCrawl(Crawl *crawl);
+
+void parseATask(Task *task, int nbThreads);
+
+void parseConfig(Configure *config, int nbThreads);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+/*
+**  Filename : scheduler.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Daemon mode: run the tasks of a configuration again and
+**              again, each one at the interval given by its TimeLaunch.
+**              - The next run of each task is a timer of a timer wheel
+**              (timerwheel.h). The scheduler sleeps until the wheel next
+**              has something to do or until a run is over, it never polls.
+**              - A run is given a thread of its own and the transfers of
+**              the run are done by its own engine (engine.h).
+**              - The next time of a task is counted from the time it was
+**              due, not from when it was fired, so its runs do not drift.
+**              - If a run is still in progress when the next one is due,
+**              the new one is coalesced: it is started once the current
+**              run is over, however many times it was due meanwhile.
+**              - A task whose TimeLaunch is 0 is run only once.
+**              - The clock can be replaced (to drive the scheduler with a
+**              fake clock), the default one is the monotonic clock.
+**              - Once a signal asks to stop (see checkpoint.h), no run is
+**              started any more and the scheduler returns when the runs in
+**              progress have taken their checkpoints and stopped.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "scheduler.h"
+#include "frontier.h"
+#include "parse.h"
+
+
+static long long monotonicNow(void *arg){
+  (void)arg;
+  return getTimeMs();
+}
+
+/**
+ * Compute the interval between 2 runs of a task
+ * @param task : the task
+ * @return : the interval in ms, 0 if the task is run only once
+ */
+long long taskInterval(Task *task){
+  return (((long long)task->time.hour * 60 + task->time.min) * 60 + task->time.sec) * 1000;
+}
+
+/**
+ * Thread of a run of a task
+ * @param arg : the scheduled task
+ */
+static void *runTask(void *arg){
+  ScheduledTask *scheduled = (ScheduledTask*)arg;
+  Scheduler *scheduler = scheduled->scheduler;
+
+  parseATask(scheduled->task, scheduler->nbThreads);
+
+  pthread_mutex_lock(&(scheduler->lock));
+  scheduled->ended = 1;
+  scheduler->nbRunning--;
+  pthread_cond_signal(&(scheduler->cond));
+  pthread_mutex_unlock(&(scheduler->lock));
+  return NULL;
+}
+
+/**
+ * Start a run of a task in a new thread (the lock of the scheduler held)
+ */
+static void startRun(ScheduledTask *scheduled){
+  Scheduler *scheduler = scheduled->scheduler;
+
+  scheduled->running = 1;
+  scheduled->ended = 0;
+  scheduled->pending = 0;
+  scheduled->nbRuns++;
+  scheduler->nbRunning++;
+  fprintf(stderr, "S: %s - run %ld started\n", scheduled->task->name, scheduled->nbRuns);
+  if (pthread_create(&(scheduled->thread), NULL, runTask, scheduled) != 0){
+    fprintf(stderr, "Cannot create thread of run.\n");
+    exit(1);
+  }
+}
+
+/**
+ * Join the threads of the runs over and start
+ * the runs coalesced (the lock of the scheduler held)
+ */
+static void joinEndedRuns(Scheduler *scheduler){
+  ScheduledTask *scheduled;
+
+  for (int i = 0; i < scheduler->nbTasks; i++){
+    scheduled = scheduler->tasks + i;
+    if (!scheduled->ended) continue;
+    pthread_join(scheduled->thread, NULL);
+    scheduled->running = 0;
+    scheduled->ended = 0;
+    if (scheduled->pending && !stopAsked()) startRun(scheduled);
+  }
+}
+
+/**
+ * Wake the scheduler up when a signal is received
+ * @param arg : the scheduler
+ */
+static void notifySignal(void *arg){
+  Scheduler *scheduler = (Scheduler*)arg;
+
+  pthread_mutex_lock(&(scheduler->lock));
+  pthread_cond_signal(&(scheduler->cond));
+  pthread_mutex_unlock(&(scheduler->lock));
+}
+
+/**
+ * Start the runs due and set the next time of their tasks
+ * (the lock of the scheduler held)
+ */
+static void fireTimers(Scheduler *scheduler, long long now){
+  Timer *timer = advanceTimerWheel(&(scheduler->wheel), now), *next;
+  ScheduledTask *scheduled;
+  long long due;
+
+  for (; timer != NULL; timer = next){
+    next = timer->next;
+    scheduled = (ScheduledTask*)timer->data;
+    if (scheduled->running){
+      scheduled->pending = 1;
+      scheduled->nbCoalesced++;
+      fprintf(stderr, "S: %s - previous run still in progress, next run coalesced\n",
+              scheduled->task->name);
+    }else{
+      startRun(scheduled);
+    }
+
+    due = timer->expiry + scheduled->interval;
+    if (due <= now){
+      //the process was not running for several intervals, these runs are skipped
+      due += ((now - due) / scheduled->interval + 1) * scheduled->interval;
+    }
+    addTimer(&(scheduler->wheel), timer, due);
+  }
+}
+
+/**
+ * Sleep until a time of the clock of the scheduler or until a run
+ * is over (the lock of the scheduler held)
+ * @param next : the time (ms), -1 to wait for the end of a run only
+ */
+static void waitScheduler(Scheduler *scheduler, long long next){
+  struct timespec ts;
+  long long wait;
+
+  if (next < 0){
+    pthread_cond_wait(&(scheduler->cond), &(scheduler->lock));
+    return;
+  }
+  wait = next - scheduler->clock.now(scheduler->clock.arg);
+  if (wait <= 0) return;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += wait / 1000;
+  ts.tv_nsec += (wait % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000){
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  pthread_cond_timedwait(&(scheduler->cond), &(scheduler->lock), &ts);
+}
+
+/**
+ * Run the tasks of a configuration at their intervals, as long
+ * as a task has a run to come or in progress
+ * @param config : the configuration
+ * @param nbThreads : the number of threads of the engine of a run
+ * @param clock : the clock to be used, NULL for the monotonic clock
+ * @return : nothing
+ */
+void runScheduler(Configure *config, int nbThreads, SchedulerClock *clock){
+  Scheduler scheduler;
+  ScheduledTask *scheduled;
+  pthread_condattr_t attr;
+  long long now;
+
+  if (config->nbTask == 0) return;
+  scheduler.tasks = (ScheduledTask*)malloc(config->nbTask * sizeof(ScheduledTask));
+  if (scheduler.tasks == NULL){
+    fprintf(stderr, "Allocation for scheduler failed.\n");
+    exit(1);
+  }
+  scheduler.nbTasks = config->nbTask;
+  scheduler.nbRunning = 0;
+  scheduler.nbThreads = nbThreads;
+  scheduler.clock.now = clock == NULL ? monotonicNow : clock->now;
+  scheduler.clock.arg = clock == NULL ? NULL : clock->arg;
+  pthread_mutex_init(&(scheduler.lock), NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(scheduler.cond), &attr);
+  pthread_condattr_destroy(&attr);
+
+  now = scheduler.clock.now(scheduler.clock.arg);
+  initTimerWheel(&(scheduler.wheel), now);
+  scheduler.watcher.notify = notifySignal;
+  scheduler.watcher.arg = &scheduler;
+  watchSignals(&(scheduler.watcher));
+
+  pthread_mutex_lock(&(scheduler.lock));
+  for (int i = 0; i < scheduler.nbTasks; i++){
+    scheduled = scheduler.tasks + i;
+    scheduled->task = config->tasks[i];
+    scheduled->scheduler = &scheduler;
+    scheduled->interval = taskInterval(scheduled->task);
+    scheduled->running = 0;
+    scheduled->ended = 0;
+    scheduled->pending = 0;
+    scheduled->nbRuns = 0;
+    scheduled->nbCoalesced = 0;
+    scheduled->timer.data = scheduled;
+    startRun(scheduled);
+    if (scheduled->interval > 0) addTimer(&(scheduler.wheel), &(scheduled->timer), now + scheduled->interval);
+  }
+
+  while (1){
+    joinEndedRuns(&scheduler);
+    if (stopAsked()){
+      //the runs in progress stop by themselves
+      if (scheduler.nbRunning == 0) break;
+      waitScheduler(&scheduler, -1);
+      continue;
+    }
+    fireTimers(&scheduler, scheduler.clock.now(scheduler.clock.arg));
+    if (scheduler.nbRunning == 0 && scheduler.wheel.nbTimers == 0) break;
+    waitScheduler(&scheduler, nextTimerWheel(&(scheduler.wheel)));
+  }
+  pthread_mutex_unlock(&(scheduler.lock));
+  unwatchSignals(&(scheduler.watcher));
+
+  for (int i = 0; i < scheduler.nbTasks; i++){
+    scheduled = scheduler.tasks + i;
+    fprintf(stderr, "S: %s - %ld runs, %ld coalesced\n",
+            scheduled->task->name, scheduled->nbRuns, scheduled->nbCoalesced);
+  }
+  pthread_cond_destroy(&(scheduler.cond));
+  pthread_mutex_destroy(&(scheduler.lock));
+  free(scheduler.tasks);
+}
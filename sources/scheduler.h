@@ -0,0 +1,84 @@
+/*
+**  Filename : scheduler.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Daemon mode: run the tasks of a configuration again and
+**              again, each one at the interval given by its TimeLaunch.
+**              - The next run of each task is a timer of a timer wheel
+**              (timerwheel.h). The scheduler sleeps until the wheel next
+**              has something to do or until a run is over, it never polls.
+**              - A run is given a thread of its own and the transfers of
+**              the run are done by its own engine (engine.h).
+**              - The next time of a task is counted from the time it was
+**              due, not from when it was fired, so its runs do not drift.
+**              - If a run is still in progress when the next one is due,
+**              the new one is coalesced: it is started once the current
+**              run is over, however many times it was due meanwhile.
+**              - A task whose TimeLaunch is 0 is run only once.
+**              - The clock can be replaced (to drive the scheduler with a
+**              fake clock), the default one is the monotonic clock.
+**              - Once a signal asks to stop (see checkpoint.h), no run is
+**              started any more and the scheduler returns when the runs in
+**              progress have taken their checkpoints and stopped.
+*/
+#ifndef __SCHEDULER
+#define __SCHEDULER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "configuration.h"
+#include "timerwheel.h"
+#include "checkpoint.h"
+
+/*Clock of the scheduler*/
+typedef struct schedulerClock{
+  long long (*now)(void *arg);    //current time (ms)
+  void *arg;
+}SchedulerClock;
+
+/*A task run by the scheduler*/
+typedef struct scheduledTask{
+  Task *task;
+  struct scheduler *scheduler;
+  Timer timer;              //its next run
+  long long interval;       //ms between 2 runs, 0 if run only once
+  pthread_t thread;         //thread of its run in progress
+  int running;              //1 while a run is in progress
+  int ended;                //1 once its run is over, until its thread is joined
+  int pending;              //1 if a run was due during the run in progress
+  long nbRuns;
+  long nbCoalesced;         //nb of runs due while a run was in progress
+}ScheduledTask;
+
+typedef struct scheduler{
+  ScheduledTask *tasks;
+  int nbTasks;
+  int nbRunning;            //nb of runs in progress
+  int nbThreads;            //nb of threads of the engine of a run
+  TimerWheel wheel;
+  SchedulerClock clock;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;      //signaled when a run is over or a signal asks to stop
+  SignalWatcher watcher;
+}Scheduler;
+
+/**
+ * Compute the interval between 2 runs of a task
+ * @param task : the task
+ * @return : the interval in ms, 0 if the task is run only once
+ */
+long long taskInterval(Task *task);
+
+/**
+ * Run the tasks of a configuration at their intervals, as long
+ * as a task has a run to come or in progress
+ * @param config : the configuration
+ * @param nbThreads : the number of threads of the engine of a run
+ * @param clock : the clock to be used, NULL for the monotonic clock
+ * @return : nothing
+ */
+void runScheduler(Configure *config, int nbThreads, SchedulerClock *clock);
+
+#endif
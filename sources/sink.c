@@ -0,0 +1,225 @@
+/*
+**  Filename : sink.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Destination on disk of the content of one transfer.
+**              - The path of the file is resolved once, when the first
+**              chunk of the content arrives.
+**              - Small contents are kept in memory and written with a
+**              single write when the transfer is done.
+**              - Once a content outgrows the memory buffer, a temporary
+**              file is opened (only once) next to its file with a large
+**              stdio buffer and the following chunks are appended to it.
+**              - The temporary file is renamed over the file once the
+**              content is complete: a file holds one whole content, 2
+**              transfers saving to the same path never mix their bytes
+**              and a content dropped leaves no trace.
+**              - A sink of an object (objectstore.h) does not know its
+**              file before the end of the content, the content is then
+**              committed under its hash.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sink.h"
+
+#define TMP_TEMPLATE "tmp-XXXXXX"
+#define TMP_SUFFIX ".tmp-XXXXXX"
+
+
+/**
+ * Initialize a sink
+ * @param sink : the sink to be initialized
+ * @param filePath : path of the file where the content is saved
+ * (the sink takes the ownership of this string)
+ * @return : nothing, the sink is modified through the pointer
+ */
+void initSink(OutputSink *sink, char *filePath){
+  sink->filePath = filePath;
+  sink->tmpPath = (char*)malloc(strlen(filePath) + strlen(TMP_SUFFIX) + 1);
+  if (sink->tmpPath == NULL){
+    fprintf(stderr, "Allocation for output sink failed.\n");
+    exit(1);
+  }
+  strcpy(sink->tmpPath, filePath);
+  strcat(sink->tmpPath, TMP_SUFFIX);
+  sink->f = NULL;
+  sink->buffer = NULL;
+  sink->lenMemory = 0;
+  sink->isObject = 0;
+  sink->memory = (char*)malloc(SINK_MEMORY_SIZE * sizeof(char));
+  if (sink->memory == NULL){
+    fprintf(stderr, "Allocation for output sink failed.\n");
+    exit(1);
+  }
+}
+
+/**
+ * Initialize the sink of an object
+ * @param sink : the sink to be initialized
+ * @param dirPath : the directory of the temporary file (ending with '/')
+ * @return : nothing, the sink is modified through the pointer
+ */
+void initObjectSink(OutputSink *sink, const char *dirPath){
+  char *tmpPath = (char*)malloc(strlen(dirPath) + strlen(TMP_TEMPLATE) + 1);
+
+  if (tmpPath == NULL){
+    fprintf(stderr, "Allocation for output sink failed.\n");
+    exit(1);
+  }
+  strcpy(tmpPath, dirPath);
+  strcat(tmpPath, TMP_TEMPLATE);
+  sink->filePath = NULL;
+  sink->tmpPath = tmpPath;
+  sink->f = NULL;
+  sink->buffer = NULL;
+  sink->lenMemory = 0;
+  sink->isObject = 1;
+  sink->memory = (char*)malloc(SINK_MEMORY_SIZE * sizeof(char));
+  if (sink->memory == NULL){
+    fprintf(stderr, "Allocation for output sink failed.\n");
+    exit(1);
+  }
+}
+
+/**
+ * Open the file of the sink and move the content
+ * kept in memory into it
+ * @param complete : 1 if the whole content is in memory (it is
+ * written with a single write, the file is not buffered)
+ * @return : 0 if succeeded, -1 if not
+ */
+static int openSink(OutputSink *sink, int complete){
+  //a new temporary file, its name replaces the template
+  int fd = mkstemp(sink->tmpPath);
+
+  if (fd >= 0) fchmod(fd, 0644);
+  sink->f = fd < 0 ? NULL : fdopen(fd, "w");
+  if (fd >= 0 && sink->f == NULL){
+    close(fd);
+    unlink(sink->tmpPath);
+  }
+  if (sink->f == NULL){
+    fprintf(stderr, "Cannot open file %s\n", sink->tmpPath);
+    return -1;
+  }
+  if (complete){
+    setvbuf(sink->f, NULL, _IONBF, 0);
+  }else{
+    //glibc ignores the size asked for a buffer it allocates itself
+    sink->buffer = (char*)malloc(SINK_FILE_BUFFER_SIZE * sizeof(char));
+    if (sink->buffer == NULL){
+      fprintf(stderr, "Allocation for output sink failed.\n");
+      exit(1);
+    }
+    setvbuf(sink->f, sink->buffer, _IOFBF, SINK_FILE_BUFFER_SIZE);
+  }
+  if (sink->lenMemory > 0
+      && fwrite(sink->memory, 1, sink->lenMemory, sink->f) != sink->lenMemory){
+    return -1;
+  }
+  sink->lenMemory = 0;
+  return 0;
+}
+
+/**
+ * Append a chunk of content to the sink
+ * @param sink : the sink of the transfer
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @return : the number of bytes taken in charge
+ * (less than size if the file could not be written)
+ */
+size_t writeSink(OutputSink *sink, const void *data, size_t size){
+  if (sink->f == NULL){
+    if (sink->lenMemory + size <= SINK_MEMORY_SIZE){
+      //still small enough to stay in memory
+      memcpy(sink->memory + sink->lenMemory, data, size);
+      sink->lenMemory += size;
+      return size;
+    }
+    if (openSink(sink, 0) != 0) return 0;
+  }
+  return fwrite(data, 1, size, sink->f);
+}
+
+/**
+ * Write what remains in memory, close the temporary file,
+ * rename it over the file and free the memory held by the sink
+ * (only for a complete content, an incomplete one is dropped
+ * with discardSink)
+ * @param sink : the sink of the transfer
+ * @return : 0 if all the content is on disk, -1 if not
+ */
+int closeSink(OutputSink *sink){
+  int res = 0;
+
+  if (sink->f == NULL && sink->lenMemory > 0 && !sink->isObject){
+    //the whole content fitted in memory, write it at once
+    res = openSink(sink, 1);
+  }
+  if (sink->f != NULL && fclose(sink->f) != 0) res = -1;
+  //renamed once complete, the file never holds a partial content
+  if (sink->f != NULL && !sink->isObject && res == 0
+      && rename(sink->tmpPath, sink->filePath) != 0) res = -1;
+  //an object not committed is incomplete, it is dropped
+  if (sink->f != NULL && (sink->isObject || res != 0)) unlink(sink->tmpPath);
+
+  free(sink->memory);
+  free(sink->buffer);
+  free(sink->filePath);
+  free(sink->tmpPath);
+  sink->memory = NULL;
+  sink->buffer = NULL;
+  sink->filePath = NULL;
+  sink->tmpPath = NULL;
+  sink->f = NULL;
+  return res;
+}
+
+/**
+ * Free the memory held by a sink and drop its content:
+ * nothing is written, and the temporary file is removed
+ * @param sink : the sink of the transfer
+ * @return : nothing
+ */
+void discardSink(OutputSink *sink){
+  sink->lenMemory = 0;
+  if (sink->f != NULL){
+    fclose(sink->f);
+    unlink(sink->tmpPath);
+    sink->f = NULL;
+  }
+  closeSink(sink);
+}
+
+/**
+ * Commit the content of the sink of an object to its file and
+ * free the sink. Nothing is written if the file exists already:
+ * the same content was saved before.
+ * @param sink : the sink of the object
+ * @param objectPath : the file of the object
+ * @return : 0 if the content is on disk, -1 if not
+ */
+int commitObjectSink(OutputSink *sink, const char *objectPath){
+  int res = 0;
+
+  if (access(objectPath, F_OK) == 0){
+    discardSink(sink);
+    return 0;
+  }
+  if (sink->f == NULL && openSink(sink, 1) != 0) res = -1;
+  if (sink->f != NULL && fclose(sink->f) != 0) res = -1;
+  //renamed once complete, an object file is never partial
+  if (sink->f != NULL && (res != 0 || rename(sink->tmpPath, objectPath) != 0)){
+    unlink(sink->tmpPath);
+    res = -1;
+  }
+  sink->f = NULL;
+  sink->lenMemory = 0;
+  closeSink(sink);
+  return res;
+}
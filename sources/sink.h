@@ -0,0 +1,98 @@
+/*
+**  Filename : sink.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Destination on disk of the content of one transfer.
+**              - The path of the file is resolved once, when the first
+**              chunk of the content arrives.
+**              - Small contents are kept in memory and written with a
+**              single write when the transfer is done.
+**              - Once a content outgrows the memory buffer, a temporary
+**              file is opened (only once) next to its file with a large
+**              stdio buffer and the following chunks are appended to it.
+**              - The temporary file is renamed over the file once the
+**              content is complete: a file holds one whole content, 2
+**              transfers saving to the same path never mix their bytes
+**              and a content dropped leaves no trace.
+**              - A sink of an object (objectstore.h) does not know its
+**              file before the end of the content, the content is then
+**              committed under its hash.
+*/
+#ifndef __SINK
+#define __SINK
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//contents smaller than this are written in one go at the end
+#define SINK_MEMORY_SIZE 65536
+//size of the stdio buffer of the file once opened
+#define SINK_FILE_BUFFER_SIZE 262144
+
+typedef struct outputSink{
+  char *filePath;       //where the content is saved, NULL for an object
+  char *tmpPath;        //template of the temporary file, then its name
+  FILE *f;              //NULL until the temporary file is opened
+  char *buffer;         //stdio buffer of the file
+  char *memory;         //content not yet written on disk
+  size_t lenMemory;
+  int isObject;         //1 if the file is only known at the commit
+}OutputSink;
+
+/**
+ * Initialize a sink
+ * @param sink : the sink to be initialized
+ * @param filePath : path of the file where the content is saved
+ * (the sink takes the ownership of this string)
+ * @return : nothing, the sink is modified through the pointer
+ */
+void initSink(OutputSink *sink, char *filePath);
+
+/**
+ * Initialize the sink of an object
+ * @param sink : the sink to be initialized
+ * @param dirPath : the directory of the temporary file (ending with '/')
+ * @return : nothing, the sink is modified through the pointer
+ */
+void initObjectSink(OutputSink *sink, const char *dirPath);
+
+/**
+ * Append a chunk of content to the sink
+ * @param sink : the sink of the transfer
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @return : the number of bytes taken in charge
+ * (less than size if the file could not be written)
+ */
+size_t writeSink(OutputSink *sink, const void *data, size_t size);
+
+/**
+ * Write what remains in memory, close the temporary file,
+ * rename it over the file and free the memory held by the sink
+ * (only for a complete content, an incomplete one is dropped
+ * with discardSink)
+ * @param sink : the sink of the transfer
+ * @return : 0 if all the content is on disk, -1 if not
+ */
+int closeSink(OutputSink *sink);
+
+/**
+ * Free the memory held by a sink and drop its content:
+ * nothing is written, and the temporary file is removed
+ * @param sink : the sink of the transfer
+ * @return : nothing
+ */
+void discardSink(OutputSink *sink);
+
+/**
+ * Commit the content of the sink of an object to its file and
+ * free the sink. Nothing is written if the file exists already:
+ * the same content was saved before.
+ * @param sink : the sink of the object
+ * @param objectPath : the file of the object
+ * @return : 0 if the content is on disk, -1 if not
+ */
+int commitObjectSink(OutputSink *sink, const char *objectPath);
+
+#endif
@@ -0,0 +1,300 @@
+/*
+**  Filename : sitemap.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Read the robots.txt and the sitemaps of a site while they
+**              are being downloaded, to queue all the pages they list at
+**              once instead of finding them one level of links at a time.
+**              - robots.txt: each "Sitemap: URL" line gives a sitemap.
+**              - A sitemap lists pages (<urlset><url><loc>) or other
+**              sitemaps (<sitemapindex><sitemap><loc>). The XML is read
+**              as a stream, only the <loc> elements and the element around
+**              them matter, so a sitemap of any size costs the same memory.
+**              - A sitemap compressed with gzip (sitemap.xml.gz) is found
+**              by its first byte and inflated on the fly (see decoder.h),
+**              up to SITEMAP_MAX_SIZE bytes (the limit of the protocol).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "sitemap.h"
+
+static const char CDATA[] = "![cdata[";
+
+
+/**
+ * Initialize a reader before feeding it the first chunk
+ * @param reader : the reader to be initialized
+ * @param isRobots : 1 to read a robots.txt, 0 to read a sitemap
+ * @return : nothing, the reader is modified through the pointer
+ */
+void initSitemapReader(SitemapReader *reader, int isRobots){
+  memset(reader, 0, sizeof(SitemapReader));
+  reader->isRobots = isRobots;
+  reader->state = XML_TEXT;
+  reader->value = (char*)malloc((SITEMAP_MAX_LOC + 1) * sizeof(char));
+  if (reader->value == NULL){
+    fprintf(stderr, "Allocation for sitemap reader failed.\n");
+    exit(1);
+  }
+}
+
+/**
+ * Add a part of the value being read
+ */
+static void appendValue(SitemapReader *reader, const char *s, size_t len){
+  if (reader->lenValue + len > SITEMAP_MAX_LOC){
+    reader->dropped = 1;
+  }else{
+    memcpy(reader->value + reader->lenValue, s, len);
+    reader->lenValue += len;
+  }
+}
+
+/**
+ * Hand over an URL without the spaces around it
+ */
+static void emitURL(SitemapReader *reader, const char *url, size_t len, int isSitemap, LocFound onLoc, void *arg){
+  while (len > 0 && isspace((unsigned char)*url)){
+    url++;
+    len--;
+  }
+  while (len > 0 && isspace((unsigned char)url[len - 1])) len--;
+  if (len == 0) return;
+  onLoc(url, len, isSitemap, arg);
+  reader->nbFound++;
+}
+
+/**
+ * Read a whole line of a robots.txt, only the
+ * "Sitemap:" lines give an URL
+ */
+static void readRobotsLine(SitemapReader *reader, LocFound onLoc, void *arg){
+  char *line = reader->value, *comment;
+  size_t len = reader->lenValue;
+
+  if (!reader->dropped){
+    comment = memchr(line, '#', len);
+    if (comment != NULL) len = comment - line;
+    while (len > 0 && isspace((unsigned char)*line)){
+      line++;
+      len--;
+    }
+    if (len > 8 && strncasecmp(line, "sitemap:", 8) == 0){
+      emitURL(reader, line + 8, len - 8, 1, onLoc, arg);
+    }
+  }
+  reader->lenValue = 0;
+  reader->dropped = 0;
+}
+
+static void readRobots(SitemapReader *reader, const char *c, const char *end, LocFound onLoc, void *arg){
+  const char *eol;
+
+  while (c < end){
+    eol = memchr(c, '\n', end - c);
+    appendValue(reader, c, (eol == NULL ? end : eol) - c);
+    if (eol == NULL) return;  //the line continues in the next chunk
+    readRobotsLine(reader, onLoc, arg);
+    c = eol + 1;
+  }
+}
+
+/**
+ * Act on the name of a tag once it is read:
+ * a <loc> starts or ends, a <sitemap> starts or ends
+ */
+static void readTagName(SitemapReader *reader, LocFound onLoc, void *arg){
+  int isLoc = reader->lenName == 3 && memcmp(reader->name, "loc", 3) == 0;
+
+  if (isLoc && !reader->closing){
+    reader->inLoc = 1;
+    reader->lenValue = 0;
+    reader->dropped = 0;
+  }else if (isLoc && reader->inLoc){
+    if (!reader->dropped){
+      emitURL(reader, reader->value, reader->lenValue, reader->inSitemap, onLoc, arg);
+    }
+    reader->inLoc = 0;
+  }else if (reader->lenName == 7 && memcmp(reader->name, "sitemap", 7) == 0){
+    reader->inSitemap = !reader->closing;
+  }
+}
+
+/**
+ * Read the start of a tag until the end of its name
+ * @return : where the reading goes on
+ */
+static const char *readTag(SitemapReader *reader, const char *c, const char *end, LocFound onLoc, void *arg){
+  char ch;
+
+  for (; c < end; c++){
+    ch = tolower((unsigned char)*c);
+    if (reader->lenName > 0 && reader->name[0] == '!'){
+      //a comment or a declaration, unless it is a CDATA
+      if (ch != CDATA[reader->lenName]){
+        reader->state = XML_SKIP;
+        return c;
+      }
+      reader->name[reader->lenName++] = ch;
+      if (reader->lenName == (int)strlen(CDATA)){
+        reader->matched = 0;
+        reader->state = XML_CDATA;
+        return c + 1;
+      }
+    }else if (reader->lenName == 0 && !reader->closing && (ch == '!' || ch == '?')){
+      reader->name[reader->lenName++] = ch;
+      if (ch == '?'){
+        reader->state = XML_SKIP;
+        return c + 1;
+      }
+    }else if (reader->lenName == 0 && !reader->closing && ch == '/'){
+      reader->closing = 1;
+    }else if (ch == ':'){
+      //only the local name matters ("sm:loc" is a <loc>)
+      reader->lenName = 0;
+    }else if (isspace((unsigned char)ch) || ch == '/' || ch == '>'){
+      readTagName(reader, onLoc, arg);
+      reader->state = ch == '>' ? XML_TEXT : XML_SKIP;
+      return c + 1;
+    }else if (reader->lenName < (int)sizeof(reader->name)){
+      reader->name[reader->lenName++] = ch;
+    }else{
+      //a name too long is none of those searched
+      reader->name[0] = '\0';
+    }
+  }
+  return c;
+}
+
+/**
+ * Read the content of a CDATA until its "]]>"
+ * @return : where the reading goes on
+ */
+static const char *readCDATA(SitemapReader *reader, const char *c, const char *end){
+  for (; c < end; c++){
+    if (*c == ']' && reader->matched < 2){
+      reader->matched++;
+    }else if (*c == '>' && reader->matched == 2){
+      reader->matched = 0;
+      reader->state = XML_TEXT;
+      return c + 1;
+    }else if (*c == ']'){
+      //"]]]": the first ']' is content
+      if (reader->inLoc) appendValue(reader, "]", 1);
+    }else{
+      if (reader->inLoc){
+        appendValue(reader, "]]", reader->matched);
+        appendValue(reader, c, 1);
+      }
+      reader->matched = 0;
+    }
+  }
+  return c;
+}
+
+static void readXML(SitemapReader *reader, const char *c, const char *end, LocFound onLoc, void *arg){
+  const char *stop;
+
+  while (c < end){
+    switch (reader->state){
+      case XML_TEXT:
+        stop = memchr(c, '<', end - c);
+        if (reader->inLoc) appendValue(reader, c, (stop == NULL ? end : stop) - c);
+        if (stop == NULL) return;
+        reader->state = XML_TAG;
+        reader->lenName = 0;
+        reader->closing = 0;
+        c = stop + 1;
+        break;
+      case XML_TAG:
+        c = readTag(reader, c, end, onLoc, arg);
+        break;
+      case XML_SKIP:
+        stop = memchr(c, '>', end - c);
+        if (stop == NULL) return;
+        reader->state = XML_TEXT;
+        c = stop + 1;
+        break;
+      case XML_CDATA:
+        c = readCDATA(reader, c, end);
+        break;
+    }
+  }
+}
+
+/*What readPart needs, given through the decoder*/
+typedef struct partReader{
+  SitemapReader *reader;
+  LocFound onLoc;
+  void *arg;
+}PartReader;
+
+/**
+ * Read bytes of the file (inflated if it was compressed)
+ * @param arg : the PartReader
+ * @return : 0 if succeeded, -1 if the file is too large
+ */
+static int readPart(const char *data, size_t size, void *arg){
+  PartReader *part = (PartReader*)arg;
+  SitemapReader *reader = part->reader;
+
+  reader->total += size;
+  if (reader->total > SITEMAP_MAX_SIZE) return -1;
+  if (reader->isRobots) readRobots(reader, data, data + size, part->onLoc, part->arg);
+  else readXML(reader, data, data + size, part->onLoc, part->arg);
+  return 0;
+}
+
+/**
+ * Read a chunk of a robots.txt or of a sitemap and call
+ * onLoc for each URL whose end is in this chunk
+ * @param reader : the state of the reading of this file
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onLoc : function called for each URL found
+ * @param arg : argument passed to onLoc
+ * @return : 0 if the file can be read further, -1 if it is
+ * damaged (bad gzip) or over SITEMAP_MAX_SIZE
+ */
+int feedSitemapReader(SitemapReader *reader, const char *data, size_t size, LocFound onLoc, void *arg){
+  PartReader part = {reader, onLoc, arg};
+
+  if (size == 0) return 0;
+  if (!reader->started){
+    reader->started = 1;
+    //0x1f never starts a text, it is the first byte of gzip
+    if ((unsigned char)data[0] == 0x1f){
+      if (initDecoder(&(reader->decoder), ENCODING_GZIP) != 0) return -1;
+      reader->gzip = 1;
+    }
+  }
+  if (reader->gzip) return feedDecoder(&(reader->decoder), data, size, readPart, &part);
+  return readPart(data, size, &part) == 0 ? 0 : -1;
+}
+
+/**
+ * Tell a reader its file is over: the last line of a
+ * robots.txt may have no end of line
+ * @param reader : the reader
+ * @param onLoc : function called for the URL found
+ * @param arg : argument passed to onLoc
+ * @return : nothing
+ */
+void endSitemapReader(SitemapReader *reader, LocFound onLoc, void *arg){
+  if (reader->isRobots && reader->lenValue > 0) readRobotsLine(reader, onLoc, arg);
+}
+
+/**
+ * Free the memory held by a reader
+ * @param reader : the reader
+ * @return : nothing
+ */
+void delSitemapReader(SitemapReader *reader){
+  if (reader->gzip) delDecoder(&(reader->decoder));
+  free(reader->value);
+  reader->value = NULL;
+}
@@ -0,0 +1,94 @@
+/*
+**  Filename : sitemap.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Read the robots.txt and the sitemaps of a site while they
+**              are being downloaded, to queue all the pages they list at
+**              once instead of finding them one level of links at a time.
+**              - robots.txt: each "Sitemap: URL" line gives a sitemap.
+**              - A sitemap lists pages (<urlset><url><loc>) or other
+**              sitemaps (<sitemapindex><sitemap><loc>). The XML is read
+**              as a stream, only the <loc> elements and the element around
+**              them matter, so a sitemap of any size costs the same memory.
+**              - A sitemap compressed with gzip (sitemap.xml.gz) is found
+**              by its first byte and inflated on the fly (see decoder.h),
+**              up to SITEMAP_MAX_SIZE bytes (the limit of the protocol).
+*/
+#ifndef __SITEMAP
+#define __SITEMAP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "decoder.h"
+
+#define SITEMAP_MAX_SIZE (50 * 1024 * 1024)   //max size of a sitemap once inflated
+#define SITEMAP_MAX_LOC 2048                  //longer <loc> are dropped
+
+/*Function called for each URL found by a reader. The span url
+* (len bytes, not ended by '\0') belongs to the reader and is only
+* valid during the call, isSitemap is 1 if it is the URL of another
+* sitemap and 0 if it is a page, arg is the pointer given to the reader.
+*/
+typedef void (*LocFound)(const char *url, size_t len, int isSitemap, void *arg);
+
+typedef enum xmlState{XML_TEXT, XML_TAG, XML_SKIP, XML_CDATA} XMLState;
+
+typedef struct sitemapReader{
+  int isRobots;         //1 for a robots.txt, 0 for a sitemap
+  int started;          //1 once the first byte told if it is compressed
+  int gzip;             //1 if it is compressed (decoder is then used)
+  Decoder decoder;
+  size_t total;         //nb of bytes read (inflated)
+  XMLState state;
+  char name[16];        //local name of the tag being read (lowercase)
+  int lenName;
+  int closing;          //1 if the tag being read is a closing one
+  int matched;          //nb of chars of "]]>" matched in a CDATA
+  int inLoc;            //1 inside a <loc>
+  int inSitemap;        //1 inside a <sitemap> (the <loc> is a sitemap)
+  char *value;          //the <loc> or the line of robots.txt being read
+  size_t lenValue;
+  int dropped;          //1 if the value is too long
+  long nbFound;         //nb of URLs found so far
+}SitemapReader;
+
+/**
+ * Initialize a reader before feeding it the first chunk
+ * @param reader : the reader to be initialized
+ * @param isRobots : 1 to read a robots.txt, 0 to read a sitemap
+ * @return : nothing, the reader is modified through the pointer
+ */
+void initSitemapReader(SitemapReader *reader, int isRobots);
+
+/**
+ * Read a chunk of a robots.txt or of a sitemap and call
+ * onLoc for each URL whose end is in this chunk
+ * @param reader : the state of the reading of this file
+ * @param data : the chunk
+ * @param size : the size of the chunk
+ * @param onLoc : function called for each URL found
+ * @param arg : argument passed to onLoc
+ * @return : 0 if the file can be read further, -1 if it is
+ * damaged (bad gzip) or over SITEMAP_MAX_SIZE
+ */
+int feedSitemapReader(SitemapReader *reader, const char *data, size_t size, LocFound onLoc, void *arg);
+
+/**
+ * Tell a reader its file is over: the last line of a
+ * robots.txt may have no end of line
+ * @param reader : the reader
+ * @param onLoc : function called for the URL found
+ * @param arg : argument passed to onLoc
+ * @return : nothing
+ */
+void endSitemapReader(SitemapReader *reader, LocFound onLoc, void *arg);
+
+/**
+ * Free the memory held by a reader
+ * @param reader : the reader
+ * @return : nothing
+ */
+void delSitemapReader(SitemapReader *reader);
+
+#endif
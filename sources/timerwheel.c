@@ -0,0 +1,176 @@
+/*
+**  Filename : timerwheel.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Hierarchical timer wheel.
+**              - The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots, a
+**              slot of level l covers WHEEL_SLOTS^l milliseconds. A timer
+**              is put in the lowest level whose range holds its delay, so
+**              adding a timer and firing it cost O(1) whatever the number
+**              of timers.
+**              - When the time reaches the start of a slot of a higher
+**              level, its timers are spread again in the lower levels
+**              (cascade), a timer moves down at most WHEEL_LEVELS times.
+**              - The wheel never reads the clock: the time is given by the
+**              caller, so it can be driven by a fake clock.
+**              - The wheel tells when it next has something to do, the
+**              caller can sleep until then instead of ticking.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "timerwheel.h"
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_RANGE (1LL << (WHEEL_BITS * WHEEL_LEVELS))  //max delay held
+
+
+/**
+ * Initialize an empty timer wheel
+ * @param wheel : the wheel to be initialized
+ * @param now : the current time (ms)
+ * @return : nothing, the wheel is modified through the pointer
+ */
+void initTimerWheel(TimerWheel *wheel, long long now){
+  for (int l = 0; l < WHEEL_LEVELS; l++){
+    for (int i = 0; i < WHEEL_SLOTS; i++) wheel->slots[l][i] = NULL;
+  }
+  wheel->current = now;
+  wheel->expired = NULL;
+  wheel->lastExpired = NULL;
+  wheel->nbTimers = 0;
+}
+
+static void appendExpired(TimerWheel *wheel, Timer *timer){
+  timer->next = NULL;
+  if (wheel->lastExpired == NULL) wheel->expired = timer;
+  else wheel->lastExpired->next = timer;
+  wheel->lastExpired = timer;
+}
+
+/**
+ * Put a timer in the slot matching its delay from the current time
+ */
+static void placeTimer(TimerWheel *wheel, Timer *timer){
+  long long delta = timer->expiry - wheel->current, key = timer->expiry;
+  int level = 0;
+
+  if (delta <= 0){
+    appendExpired(wheel, timer);
+    return;
+  }
+  if (delta >= WHEEL_RANGE){
+    //too far: parked in the last slot reachable, placed again when cascaded
+    key = wheel->current + WHEEL_RANGE - 1;
+    delta = WHEEL_RANGE - 1;
+  }
+  while (level < WHEEL_LEVELS - 1 && delta >= (1LL << (WHEEL_BITS * (level + 1)))) level++;
+
+  Timer **slot = &(wheel->slots[level][(key >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+  timer->next = *slot;
+  *slot = timer;
+}
+
+/**
+ * Add a timer to the wheel
+ * @param wheel : the wheel
+ * @param timer : the timer (must not be in the wheel already)
+ * @param expiry : the time (ms) when the timer fires, a time
+ * already reached fires at the next advance of the wheel
+ * @return : nothing
+ */
+void addTimer(TimerWheel *wheel, Timer *timer, long long expiry){
+  timer->expiry = expiry;
+  placeTimer(wheel, timer);
+  wheel->nbTimers++;
+}
+
+/**
+ * Find the next time a slot of the wheel has to be handled,
+ * the fired timers not taken out yet are not counted
+ * @return : the time (ms), -1 if no slot holds a timer
+ */
+static long long nextSlotTime(TimerWheel *wheel){
+  long long res = -1, block;
+  int shift;
+
+  for (int l = 0; l < WHEEL_LEVELS; l++){
+    shift = WHEEL_BITS * l;
+    //the timers of a level always are in the WHEEL_SLOTS slots after the current one
+    for (int i = 1; i <= WHEEL_SLOTS; i++){
+      block = (wheel->current >> shift) + i;
+      if (wheel->slots[l][block & WHEEL_MASK] != NULL){
+        if (res < 0 || (block << shift) < res) res = block << shift;
+        break;
+      }
+    }
+  }
+  return res;
+}
+
+/**
+ * Handle the slots starting at the current time: cascade the
+ * higher levels then fire the timers of the lowest one
+ */
+static void handleSlots(TimerWheel *wheel){
+  long long now = wheel->current;
+  Timer *timer, *next;
+  int shift;
+
+  for (int l = WHEEL_LEVELS - 1; l > 0; l--){
+    shift = WHEEL_BITS * l;
+    if ((now & ((1LL << shift) - 1)) != 0) continue;
+    timer = wheel->slots[l][(now >> shift) & WHEEL_MASK];
+    wheel->slots[l][(now >> shift) & WHEEL_MASK] = NULL;
+    for (; timer != NULL; timer = next){
+      next = timer->next;
+      placeTimer(wheel, timer);
+    }
+  }
+  timer = wheel->slots[0][now & WHEEL_MASK];
+  wheel->slots[0][now & WHEEL_MASK] = NULL;
+  for (; timer != NULL; timer = next){
+    next = timer->next;
+    appendExpired(wheel, timer);
+  }
+}
+
+/**
+ * Move the wheel forward to a time and take out the timers which fire
+ * @param wheel : the wheel
+ * @param now : the current time (ms)
+ * @return : the list of the timers fired (linked by next, in the
+ * order they fired), they are not in the wheel anymore
+ */
+Timer *advanceTimerWheel(TimerWheel *wheel, long long now){
+  long long next;
+  Timer *res;
+
+  //jump from one slot to be handled to the next one
+  while (wheel->current < now){
+    next = nextSlotTime(wheel);
+    if (next < 0 || next > now){
+      wheel->current = now;
+      break;
+    }
+    wheel->current = next;
+    handleSlots(wheel);
+  }
+
+  res = wheel->expired;
+  for (Timer *timer = res; timer != NULL; timer = timer->next) wheel->nbTimers--;
+  wheel->expired = NULL;
+  wheel->lastExpired = NULL;
+  return res;
+}
+
+/**
+ * Find when the wheel next has something to do: the expiry of
+ * a timer or the cascade of a slot of a higher level
+ * @param wheel : the wheel
+ * @return : the time (ms), -1 if the wheel is empty
+ */
+long long nextTimerWheel(TimerWheel *wheel){
+  if (wheel->expired != NULL) return wheel->current;
+  return nextSlotTime(wheel);
+}
@@ -0,0 +1,80 @@
+/*
+**  Filename : timerwheel.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Hierarchical timer wheel.
+**              - The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots, a
+**              slot of level l covers WHEEL_SLOTS^l milliseconds. A timer
+**              is put in the lowest level whose range holds its delay, so
+**              adding a timer and firing it cost O(1) whatever the number
+**              of timers.
+**              - When the time reaches the start of a slot of a higher
+**              level, its timers are spread again in the lower levels
+**              (cascade), a timer moves down at most WHEEL_LEVELS times.
+**              - The wheel never reads the clock: the time is given by the
+**              caller, so it can be driven by a fake clock.
+**              - The wheel tells when it next has something to do, the
+**              caller can sleep until then instead of ticking.
+*/
+#ifndef __TIMERWHEEL
+#define __TIMERWHEEL
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)   //nb of slots of a level
+#define WHEEL_LEVELS 7                  //covers 2^42 ms (more than a century)
+
+/*A timer, allocated by its owner*/
+typedef struct timer{
+  long long expiry;         //time (ms) when the timer fires
+  void *data;               //what the timer is for
+  struct timer *next;
+}Timer;
+
+typedef struct timerWheel{
+  long long current;        //time (ms) the wheel has reached
+  Timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+  Timer *expired;           //timers fired, not taken out yet
+  Timer *lastExpired;
+  size_t nbTimers;          //nb of timers in the wheel (fired included)
+}TimerWheel;
+
+/**
+ * Initialize an empty timer wheel
+ * @param wheel : the wheel to be initialized
+ * @param now : the current time (ms)
+ * @return : nothing, the wheel is modified through the pointer
+ */
+void initTimerWheel(TimerWheel *wheel, long long now);
+
+/**
+ * Add a timer to the wheel
+ * @param wheel : the wheel
+ * @param timer : the timer (must not be in the wheel already)
+ * @param expiry : the time (ms) when the timer fires, a time
+ * already reached fires at the next advance of the wheel
+ * @return : nothing
+ */
+void addTimer(TimerWheel *wheel, Timer *timer, long long expiry);
+
+/**
+ * Move the wheel forward to a time and take out the timers which fire
+ * @param wheel : the wheel
+ * @param now : the current time (ms)
+ * @return : the list of the timers fired (linked by next, in the
+ * order they fired), they are not in the wheel anymore
+ */
+Timer *advanceTimerWheel(TimerWheel *wheel, long long now);
+
+/**
+ * Find when the wheel next has something to do: the expiry of
+ * a timer or the cascade of a slot of a higher level
+ * @param wheel : the wheel
+ * @return : the time (ms), -1 if the wheel is empty
+ */
+long long nextTimerWheel(TimerWheel *wheel);
+
+#endif
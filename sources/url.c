@@ -18,6 +18,38 @@
 **              entire URL.
 **              Divide URLs into small parts and arrange nodes orderly helps 
 **              navigating the right node quick.
+**              - Alongside the tree, a set of fingerprints of the parsed 
+**              URLs (urlset.h) answers URLAlrParsed without walking the 
+**              tree. The tree is still what saveAllURLs browses.
+**              - All the nodes of a tree live in one array (the node arena) 
+**              and all their sub-links in one buffer (the string arena).
+**              A node is designated by its index in the node arena and 
+**              links between nodes are 32-bit indices, so deleting a tree 
+**              only frees the 2 arenas.
+**              - A node counts its children. When a node gets more than
+**              FANOUT_THRESHOLD children, an index of its children sorted
+**              alphabetically is built (whatever the order of the searches)
+**              and searched by dichotomy instead of browsing the linked list.
+**              The linked list is kept up to date for the browsing in 
+**              alphabetical order.
+**              - The tree is path-compressed: a chain of nodes with a single 
+**              child and no URL of their own is merged into one node whose 
+**              sub-link holds several parts ("static/js/app.js"). A node 
+**              is split when a new URL leaves the chain in the middle.
+**              Siblings are ordered by the first part of their sub-link.
+**              - Sub-links are interned: a sub-link alr in the string arena 
+**              is never copied again, so common parts ("index.html") are 
+**              stored once per tree.
+**              - URLs are read in place (pointer and length), the tree is 
+**              descended in a single loop and memory is only taken when 
+**              new nodes are created.
+**              - A tree can be written in a snapshot (writeTree) and rebuilt
+**              from it (readTree): the arenas, the interned table, the
+**              indexes and the sets are copied as they are, no URL is
+**              inserted again.
+**              - saveAllURLs browses the tree with an explicit stack and
+**              builds the URLs in a single buffer, a node costs no
+**              allocation whatever the size of the tree.
 */
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,33 +61,196 @@
 /*****************CONTRUCTION************************/
 
 /**
- * Initialize a Node
+ * Hash a sub-link (FNV-1a) to find its place in the table 
+ * of interned sub-links
+ */
+static uint32_t hashString(const char *str, uint32_t len){
+    uint32_t h = 2166136261U;
+    for (uint32_t i = 0; i < len; i++){
+        h = (h ^ (unsigned char)str[i]) * 16777619U;
+    }
+    return h;
+}
+
+/**
+ * Find the slot of a sub-link in the table of interned sub-links:
+ * either the slot holding it or the empty slot where it would be
+ */
+static InternedString *findInterned(URLTree *tree, const char *str, uint32_t len){
+    uint32_t mask = tree->sizeInterned - 1;
+    uint32_t idx = hashString(str, len) & mask;
+    InternedString *slot;
+
+    while (1){
+        slot = tree->interned + idx;
+        if (slot->len == 0) return slot;
+        if (slot->len == len && memcmp(tree->strings + slot->offset, str, len) == 0) return slot;
+        idx = (idx + 1) & mask;
+    }
+}
+
+/**
+ * Register a sub-link of the string arena in the table 
+ * of interned sub-links (nothing is done if the same
+ * sub-link is alr registered)
+ */
+static void registerInterned(URLTree *tree, uint32_t offset, uint32_t len){
+    InternedString *slot, *oldSlots;
+    uint32_t oldSize;
+
+    if (len == 0) return;
+    if (2 * (tree->nbInterned + 1) > tree->sizeInterned){
+        //half full -> double the table
+        oldSlots = tree->interned;
+        oldSize = tree->sizeInterned;
+        tree->sizeInterned *= 2;
+        tree->interned = (InternedString*)calloc(tree->sizeInterned, sizeof(InternedString));
+        if (tree->interned == NULL){
+            fprintf(stderr, "Allocation for interned strings failed.\n");
+            exit(1);
+        }
+        for (uint32_t i = 0; i < oldSize; i++){
+            if (oldSlots[i].len != 0){
+                *findInterned(tree, tree->strings + oldSlots[i].offset, oldSlots[i].len) = oldSlots[i];
+            }
+        }
+        free(oldSlots);
+    }
+
+    slot = findInterned(tree, tree->strings + offset, len);
+    if (slot->len != 0) return;
+    slot->offset = offset;
+    slot->len = len;
+    tree->nbInterned++;
+}
+
+/**
+ * Get the length of a sub-link once it is in the string arena
+ * (consecutive '/' merged and the '/' at the end dropped)
+ * @param suburl : the beginning of the sub-link
+ * @param end : the end of the sub-link
+ * @return : the length
+ */
+static size_t subURLLength(const char *suburl, const char *end){
+    size_t len = 0;
+
+    for (const char *c = suburl; c < end; c++){
+        if (*c == '/' && (c + 1 == end || c[1] == '/')) continue;
+        len++;
+    }
+    return len;
+}
+
+/**
+ * Get a sub-link in the string arena of a tree, it is
+ * copied at the end of the arena only if it is not alr there
+ * (consecutive '/' are merged and the '/' at the end dropped)
+ * @param suburl : the beginning of the sub-link
+ * @param end : the end of the sub-link
+ * @param len : where to save the length of the sub-link
+ * @return : the offset of the sub-link in the string arena
+ */
+static uint32_t internString(URLTree *tree, const char *suburl, const char *end, uint32_t *len){
+    InternedString *slot;
+    uint32_t offset = tree->lenStrings;
+    char *copy;
+
+    if (tree->lenStrings + (end - suburl) + 1 > tree->sizeStrings){
+        while (tree->lenStrings + (end - suburl) + 1 > tree->sizeStrings) tree->sizeStrings *= 2;
+        tree->strings = (char*)realloc(tree->strings, tree->sizeStrings * sizeof(char));
+        if (tree->strings == NULL){
+            fprintf(stderr, "Allocation for string arena failed.\n");
+            exit(1);
+        }
+    }
+
+    //copy at the end of the arena without taking it yet
+    copy = tree->strings + offset;
+    *len = 0;
+    for (const char *c = suburl; c < end; c++){
+        if (*c == '/' && (c + 1 == end || c[1] == '/')) continue;
+        copy[(*len)++] = *c;
+    }
+    if (*len == 0) return 0;
+
+    slot = findInterned(tree, copy, *len);
+    if (slot->len != 0) return slot->offset;   //alr in the arena
+
+    copy[*len] = '\0';
+    tree->lenStrings += *len + 1;
+    registerInterned(tree, offset, *len);
+    return offset;
+}
+
+/**
+ * Reserve a new node at the end of the node arena
+ * @return : the index of the node (not initialized)
+ */
+static Node allocNode(URLTree *tree){
+    if (tree->nbNodes == tree->sizeNodes){
+        if (tree->sizeNodes >= NO_NODE / 2){
+            fprintf(stderr, "Too many nodes in the tree.\n");
+            exit(1);
+        }
+        tree->sizeNodes *= 2;
+        tree->nodes = (struct __node*)realloc(tree->nodes, tree->sizeNodes * sizeof(struct __node));
+        if (tree->nodes == NULL){
+            fprintf(stderr, "Allocation for new Node failed.\n");
+            exit(1);
+        }
+    }
+    return tree->nbNodes++;
+}
+
+/**
+ * Initialize a Node in the arena of a tree
+ * @param tree : the tree the node belongs to
  * @param suburl : the string of sub-link of the url 
  * @param depth : the depth of this link from the initial
  * @param next : its next sibling
  * @param child : its first child
- * @return : the node itself
+ * @return : the index of the node
  */
-Node initNode(char *suburl, int depth, Node next, Node child){
-    if (suburl == NULL || strlen(suburl) == 0){
+Node initNode(URLTree *tree, char *suburl, int depth, Node next, Node child){
+    if (suburl == NULL || (strlen(suburl) == 0 && tree->nbNodes > 0)
+        || strlen(suburl) > MAX_SUBURL_LENGTH){
         fprintf(stderr, "Wrong URL\n");
         exit(1);
     }
 
-    Node res = (Node)malloc(sizeof(struct __node));
-    if (res == NULL){
-        fprintf(stderr, "Allocation for new Node failed.\n");
-        exit(1);
-    }
-
-    res->depth = depth;
-    res->firstChild = child;
-    res->nextSibling = next;
-    res->url = strdup(suburl);
+    uint32_t len;
+    uint32_t offset = internString(tree, suburl, suburl + strlen(suburl), &len);
+    Node res = allocNode(tree);
+    NODE(tree, res)->depth = depth;
+    NODE(tree, res)->firstChild = child;
+    NODE(tree, res)->nextSibling = next;
+    NODE(tree, res)->childIndex = NO_INDEX;
+    NODE(tree, res)->nbChildren = 0;
+    for (; child != NO_NODE; child = NODE(tree, child)->nextSibling) NODE(tree, res)->nbChildren++;
+    NODE(tree, res)->url = offset;
+    NODE(tree, res)->lenURL = len;
 
     return res;
 }
 
+/**
+ * Find where an URL starts once its protocol part 
+ * and the www. are skipped (the URL is not copied)
+ * @param url : the URL
+ * @return : the pointer to the first character after
+ * the protocol part and the www.
+ */
+const char *skipProtocol(const char *url){
+    const char *protocol;
+
+    //find the first occurence of "//" in url
+    //which delimits the https part and the real
+    //url part
+    protocol = strstr(url, "//");
+    if (protocol != NULL) url = protocol + 2;
+    if (strncmp(url, "www.", 4) == 0) url += 4;
+    return url;
+}
 
 /**
  * delete the protocol part in the URL and the www.
@@ -63,61 +258,51 @@ Node initNode(char *suburl, int depth, Node next, Node child){
  * @return : the pointer to the modified URL
  */
 char *delProtocol(char *url){
-    char *protocol, *hostDomain, *res;
-    char http[3] = "//";
-    char www[5] = "www.";
-
-    //find the first occurence of "//" in url
-    //which delimits the https part and the real
-    //url part
-    protocol = strstr(url, http);
-    hostDomain = strstr(url, www);
-    if (protocol == NULL){
-        //no "//" exists in URL 
-        if (hostDomain != NULL){
-            res = strdup(hostDomain+4);
-            return res;
-        }else return strdup(url);
-    }else{
-        if (hostDomain != NULL) {
-            res = strdup(hostDomain+4);
-            return res; 
-        }
-        else{
-            res = strdup(protocol+2);
-            return res;
-        }
-    }
+    return strdup(skipProtocol(url));
 }
 
 
 /**
  * Make a tree from the very initial url 
  * @param url : the initial url of the tree
- * @return : the root of the tree
+ * @return : the tree
  */
-Node makeTree(char *url){
-    Node root, curNode;
-    char *subURL, *__url;
-    const char http[2] = "/";
+URLTree *makeTree(char *url){
+    URLTree *tree;
+    const char *__url = skipProtocol(url);
 
-    //del the HTTP part from URL
-    url = strdup(url); //not modify the url in argument
-    __url = delProtocol(url);
-
-    //create the root node 
-    root = initNode(".", -1, NULL, NULL);
-    curNode = root;
-
-    subURL = strtok(__url, http);
-    while (subURL != NULL){
-        curNode->firstChild = initNode(subURL, -1, NULL, NULL);
-        subURL = strtok(NULL, http);
-        curNode = curNode->firstChild;
+    tree = (URLTree*)malloc(sizeof(URLTree));
+    if (tree == NULL){
+        fprintf(stderr, "Allocation for new tree failed.\n");
+        exit(1);
     }
-    curNode->depth = 0;
-    free(__url); free(subURL);
-    return root;
+    tree->nbNodes = 0;
+    tree->sizeNodes = NODES_INITIAL_SIZE;
+    tree->nodes = (struct __node*)malloc(tree->sizeNodes * sizeof(struct __node));
+    tree->lenStrings = 0;
+    tree->sizeStrings = STRINGS_INITIAL_SIZE;
+    tree->strings = (char*)malloc(tree->sizeStrings * sizeof(char));
+    tree->nbInterned = 0;
+    tree->sizeInterned = INTERNED_INITIAL_SIZE;
+    tree->interned = (InternedString*)calloc(tree->sizeInterned, sizeof(InternedString));
+    tree->nbIndexes = 0;
+    tree->sizeIndexes = 0;
+    tree->indexes = NULL;
+    if (tree->nodes == NULL || tree->strings == NULL || tree->interned == NULL){
+        fprintf(stderr, "Allocation for new tree failed.\n");
+        exit(1);
+    }
+    pthread_mutex_init(&(tree->lock), NULL);
+    for (int i = 0; i < URL_SHARDS; i++){
+        initURLSetOfSize(tree->parsed + i, URLSET_INITIAL_SIZE / URL_SHARDS);
+        pthread_mutex_init(tree->parsedLocks + i, NULL);
+    }
+
+    //create the root node, the initial URL is its only
+    //child (one node as the tree is path-compressed)
+    initNode(tree, "", -1, NO_NODE, NO_NODE);
+    insertURL(tree, (char*)__url, 0);
+    return tree;
 }
 
 
@@ -126,150 +311,382 @@ Node makeTree(char *url){
 
 /**
  * Compare two nodes by their url 
+ * @param tree : the tree of the nodes
  * @param node1; node2 : 2 nodes to be compared
  * @return : 0 if their url are equals 
  *          -1 if node1->url < node2->url
  *           1 if node1->url > node2->url
  */
-int compareNode(Node node1, Node node2){
+int compareNode(URLTree *tree, Node node1, Node node2){
+    uint32_t len1 = NODE(tree, node1)->lenURL;
+    uint32_t len2 = NODE(tree, node2)->lenURL;
+    int order = memcmp(SUBURL(tree, node1), SUBURL(tree, node2), len1 < len2 ? len1 : len2);
 
-    return strcmp(node1->url, node2->url);
+    if (order != 0) return order < 0 ? -1 : 1;
+    return len1 == len2 ? 0 : (len1 < len2 ? -1 : 1);
 }
 
-
 /**
- * Divide an URL into 2 parts by the first occurence of '/'
- * @param URL : the URL to be divided
- * @param firstSubURL: address of the string to stock 
- * the first part of the URL
- * @param restURL: address of the string to stock the 
- * last part of the URL
- * @return : nothing as 2 strings are saved in the pointers
- * passed in by arguments
+ * Compare a part of an URL with the first part of
+ * the sub-link of a node (the order of siblings)
+ * @param part : the part of URL (not ended by '\0')
+ * @param lenPart : the length of part
+ * @return : 0 if equals, <0 if part comes before, >0 if after
  */
-void divideURL(char *URL, char **firstSubURL, char **restURL){
-    char *idxDiviseur;
+static int compareFirstPart(URLTree *tree, const char *part, uint32_t lenPart, Node node){
+    const char *suburl = SUBURL(tree, node);
+    uint32_t lenFirst = 0;
+    int order;
 
-    idxDiviseur = strchr(URL, '/');
-    if (idxDiviseur == NULL){
-        //URL doesn't have any further sub URLs
-        *firstSubURL = strdup(URL);
-        *restURL = NULL;
-    }else{
-        *restURL = idxDiviseur + 1;
-        //recopy the first part into firstSubURL
-        // *firstSubURL = (char*)malloc((idxDiviseur - URL + 1) * sizeof(char));
-        // strncpy(*firstSubURL, URL, (idxDiviseur - URL));
-        *firstSubURL = strndup(URL, idxDiviseur - URL);
-    }
+    while (lenFirst < NODE(tree, node)->lenURL && suburl[lenFirst] != '/') lenFirst++;
+    order = memcmp(part, suburl, lenPart < lenFirst ? lenPart : lenFirst);
+    if (order != 0) return order;
+    return (int)lenPart - (int)lenFirst;
 }
 
 
 /**
- * Insert a node into the tree
- * @param upperNode : the upper Node (parent node) of those 
- * to be inserted successively (have to be != NULL)
- * @param subURLInsert : the sub url of the node to be inserted
- * @param depth : the depth of the inserted node from the initial url
- * @return : nothing as the node to be inserted is updated through upperNode
+ * Build the index of the children of a node from its linked list
+ * (which is alr in alphabetical order)
+ * @param tree : the tree
+ * @param upperNode : the node whose children are indexed
+ * @return : nothing
  */
-void insertNode(Node upperNode, char *subURLInsert, int depth){
-    if (upperNode == NULL){
-        fprintf(stderr, "Parent node does not exist.\n");
+static void indexChildren(URLTree *tree, Node upperNode){
+    uint32_t nbChildren = NODE(tree, upperNode)->nbChildren;
+    ChildIndex *index;
+    Node childNode;
+    uint32_t i = 0;
+
+    if (tree->nbIndexes == tree->sizeIndexes){
+        tree->sizeIndexes = tree->sizeIndexes == 0 ? 16 : 2 * tree->sizeIndexes;
+        tree->indexes = (ChildIndex*)realloc(tree->indexes, tree->sizeIndexes * sizeof(ChildIndex));
+        if (tree->indexes == NULL){
+            fprintf(stderr, "Allocation for child index failed.\n");
+            exit(1);
+        }
+    }
+    index = tree->indexes + tree->nbIndexes;
+    index->nbChildren = nbChildren;
+    index->size = 2 * nbChildren;
+    index->children = (uint32_t*)malloc(index->size * sizeof(uint32_t));
+    if (index->children == NULL){
+        fprintf(stderr, "Allocation for child index failed.\n");
         exit(1);
     }
+    for (childNode = NODE(tree, upperNode)->firstChild; childNode != NO_NODE;
+    childNode = NODE(tree, childNode)->nextSibling){
+        index->children[i++] = childNode;
+    }
+    NODE(tree, upperNode)->childIndex = tree->nbIndexes++;
+}
 
-    if (subURLInsert == NULL || strlen(subURLInsert) == 0){
-        return;
+/**
+ * Look for the child of a node whose sub-link starts with a part
+ * @param tree : the tree
+ * @param upperNode : the parent node
+ * @param part : the part searched (not ended by '\0')
+ * @param lenPart : the length of part
+ * @param prevNode : where to save the child preceding part in 
+ * alphabetical order (NO_NODE if part would be the first child)
+ * @param position : where to save the position of part in 
+ * the index of the children (only if they are indexed)
+ * @return : the child if it exists, NO_NODE if not
+ */
+static Node searchChild(URLTree *tree, Node upperNode, const char *part, uint32_t lenPart, Node *prevNode, uint32_t *position){
+    Node childNode;
+    ChildIndex *index;
+    uint32_t low, high, middle;
+    int order;
+
+    if (NODE(tree, upperNode)->childIndex != NO_INDEX){
+        //many children -> dichotomy in their index
+        index = tree->indexes + NODE(tree, upperNode)->childIndex;
+        low = 0;
+        high = index->nbChildren;
+        while (low < high){
+            middle = low + (high - low) / 2;
+            order = compareFirstPart(tree, part, lenPart, index->children[middle]);
+            if (order == 0){
+                *position = middle;
+                return index->children[middle];
+            }
+            if (order < 0) high = middle;
+            else low = middle + 1;
+        }
+        *position = low;
+        *prevNode = low == 0 ? NO_NODE : index->children[low - 1];
+        return NO_NODE;
     }
 
-    //declare necessary variables
-    char *firstSubURL, *restURL; 
-    Node nodeToInsert, childNode, prevNode;
-    int order, inserted;
+    //few children -> browse the linked list
+    *prevNode = NO_NODE;
+    for (childNode = NODE(tree, upperNode)->firstChild; childNode != NO_NODE;
+    childNode = NODE(tree, childNode)->nextSibling){
+        order = compareFirstPart(tree, part, lenPart, childNode);
+        if (order == 0) return childNode;
+        if (order < 0) break;
+        *prevNode = childNode;
+    }
+    return NO_NODE;
+}
 
+/**
+ * Link a new child to its parent, after prevNode in the
+ * linked list and at position in the index of the children
+ * (as found by searchChild)
+ * @return : nothing
+ */
+static void linkChild(URLTree *tree, Node upperNode, Node newNode, Node prevNode, uint32_t position){
+    ChildIndex *index;
 
-    divideURL(subURLInsert, &firstSubURL, &restURL);
-    nodeToInsert = initNode(firstSubURL, -1, NULL, NULL);
-    free(firstSubURL); //node initialised -> free to save memory
+    if (prevNode == NO_NODE){
+        NODE(tree, newNode)->nextSibling = NODE(tree, upperNode)->firstChild;
+        NODE(tree, upperNode)->firstChild = newNode;
+    }else{
+        NODE(tree, newNode)->nextSibling = NODE(tree, prevNode)->nextSibling;
+        NODE(tree, prevNode)->nextSibling = newNode;
+    }
+    NODE(tree, upperNode)->nbChildren++;
 
+    if (NODE(tree, upperNode)->childIndex == NO_INDEX){
+        //one child too many for the list, the index is built with the new child
+        if (NODE(tree, upperNode)->nbChildren > FANOUT_THRESHOLD) indexChildren(tree, upperNode);
+        return;
+    }
+    index = tree->indexes + NODE(tree, upperNode)->childIndex;
+    if (index->nbChildren == index->size){
+        index->size *= 2;
+        index->children = (uint32_t*)realloc(index->children, index->size * sizeof(uint32_t));
+        if (index->children == NULL){
+            fprintf(stderr, "Allocation for child index failed.\n");
+            exit(1);
+        }
+    }
+    memmove(index->children + position + 1, index->children + position,
+            (index->nbChildren - position) * sizeof(uint32_t));
+    index->children[position] = newNode;
+    index->nbChildren++;
+}
 
 
-    //insert the node to a appropriate position 
-    //regarding to the alphabet order between sibling nodes
-    childNode = upperNode->firstChild;
-    if (childNode == NULL) {
-        upperNode->firstChild = nodeToInsert;
-    }else{
-        order = compareNode(nodeToInsert, childNode);
-        if (order  < 0){
-            //nodeToInsert < childNode
-            nodeToInsert->nextSibling = childNode;
-            upperNode->firstChild = nodeToInsert;
-        }else if (order == 0){
-            //nodeToInsert is the childNode -> alr exists
-            //-> we dont insert it and process to
-            //the rest part of URL
-            delNode(&nodeToInsert);
-            nodeToInsert = childNode;
-        }else{
-            //nodeToInsert > childNode
-            //-> insert it in the proper position following alphabet order
-            prevNode = childNode;
-            childNode = childNode->nextSibling;
-            inserted = 0;
-            while (childNode != NULL){
-                order = compareNode(nodeToInsert, childNode);
-                if (order < 0){
-                    nodeToInsert->nextSibling = childNode;
-                    prevNode->nextSibling = nodeToInsert;
-                    inserted = 1;
-                    break;
-                }else if (order > 0){
-                    prevNode = childNode;
-                    childNode = childNode->nextSibling;
-                }else{
-                    //this node alr exists in the tree -> pass
-                    delNode(&nodeToInsert);
-                    nodeToInsert = childNode;
-                    inserted = 1;
-                    break;
-                }
+/**
+ * Match the sub-link of a node with the beginning of a part of URL,
+ * the match always stops at the end of a part of the sub-link
+ * @param tree : the tree
+ * @param node : the node whose first part equals the first part of subURL
+ * @param subURL : the part of URL
+ * @param end : the end of the URL
+ * @param rest : where to save the pointer to what follows the match
+ * in subURL ('/' or end)
+ * @return : the length of the sub-link matched
+ */
+static uint32_t matchSubURL(URLTree *tree, Node node, const char *subURL, const char *end, const char **rest){
+    const char *suburl = SUBURL(tree, node);
+    uint32_t len = NODE(tree, node)->lenURL;
+    uint32_t i = 0, lastMatched = 0;
+    const char *c = subURL, *lastRest = subURL;
+
+    while (1){
+        if (i == len){
+            //the whole sub-link matched
+            if (c == end || *c == '/'){
+                *rest = c;
+                return i;
+            }
+            break;
+        }
+        if (c == end){
+            //subURL ends in the middle of the sub-link
+            if (suburl[i] == '/'){
+                *rest = c;
+                return i;
             }
-            //browsed through all children nodes of upperNode 
-            //-> insert to the end of the linked-list sibling nodes
-            if (!inserted){
-                prevNode->nextSibling = nodeToInsert;
-            }        
+            break;
+        }
+        if (*c != suburl[i]) break;
+        if (*c == '/'){
+            lastMatched = i;
+            while (c + 1 < end && c[1] == '/') c++;
+            lastRest = c;
         }
+        i++; c++;
     }
+    *rest = lastRest;
+    return lastMatched;
+}
 
+/**
+ * Split a node after the first lenKept characters of its sub-link:
+ * the node keeps the beginning and a new single child takes
+ * the end with the depth and the children of the node
+ * @param tree : the tree
+ * @param node : the node to split
+ * @param lenKept : position of a '/' in the sub-link of node
+ * @return : nothing
+ */
+static void splitNode(URLTree *tree, Node node, uint32_t lenKept){
+    Node child = allocNode(tree);
+
+    NODE(tree, child)->url = NODE(tree, node)->url + lenKept + 1;
+    NODE(tree, child)->lenURL = NODE(tree, node)->lenURL - lenKept - 1;
+    NODE(tree, child)->depth = NODE(tree, node)->depth;
+    NODE(tree, child)->firstChild = NODE(tree, node)->firstChild;
+    NODE(tree, child)->childIndex = NODE(tree, node)->childIndex;
+    NODE(tree, child)->nbChildren = NODE(tree, node)->nbChildren;
+    NODE(tree, child)->nextSibling = NO_NODE;
+
+    NODE(tree, node)->lenURL = lenKept;
+    NODE(tree, node)->depth = -1;
+    NODE(tree, node)->firstChild = child;
+    NODE(tree, node)->childIndex = NO_INDEX;
+    NODE(tree, node)->nbChildren = 1;
+
+    //both parts are alr in the string arena, 
+    //they can be shared by later sub-links
+    registerInterned(tree, NODE(tree, node)->url, lenKept);
+    registerInterned(tree, NODE(tree, child)->url, NODE(tree, child)->lenURL);
+}
 
-    if (restURL == NULL || strlen(restURL) == 0){
-        //this is the last node to be inserted in 
-        //this URL so we update its depth and stop here
-        nodeToInsert->depth = depth;
-        return;
+/**
+ * Descend the tree from a node following an URL 
+ * @param tree : the tree
+ * @param upperNode : the node from where we descend
+ * @param subURL : the URL (without protocol)
+ * @param end : the end of the URL
+ * @param insert : 1 to create the nodes missing on the way
+ * @return : the node where the URL ends, NO_NODE if the
+ * URL is not in the tree and insert = 0 (or it is too long)
+ */
+static Node descendTree(URLTree *tree, Node upperNode, const char *subURL, const char *end, int insert){
+    const char *slash;
+    Node childNode, prevNode = NO_NODE;
+    uint32_t position = 0, lenFirst, lenMatched, offset, len;
+
+    while (1){
+        //'/' at the beginning or repeated do not lead to another node
+        while (subURL < end && *subURL == '/') subURL++;
+        if (subURL == end) return upperNode;
+
+        //look for the child sharing the first part of the sub url,
+        //siblings are in alphabet order of their first parts
+        slash = memchr(subURL, '/', end - subURL);
+        lenFirst = (slash == NULL ? end : slash) - subURL;
+        childNode = searchChild(tree, upperNode, subURL, lenFirst, &prevNode, &position);
+
+        if (childNode == NO_NODE){
+            if (!insert) return NO_NODE;
+            //no child shares the first part
+            //-> the whole rest of the URL becomes a single new node
+            //checked before the arena, a rejected URL takes no room in it
+            if (subURLLength(subURL, end) > MAX_SUBURL_LENGTH){
+                fprintf(stderr, "URL too long to be inserted.\n");
+                return NO_NODE;
+            }
+            offset = internString(tree, subURL, end, &len);
+            childNode = allocNode(tree);
+            NODE(tree, childNode)->url = offset;
+            NODE(tree, childNode)->lenURL = len;
+            NODE(tree, childNode)->depth = -1;
+            NODE(tree, childNode)->firstChild = NO_NODE;
+            NODE(tree, childNode)->childIndex = NO_INDEX;
+            NODE(tree, childNode)->nbChildren = 0;
+            linkChild(tree, upperNode, childNode, prevNode, position);
+            return childNode;
+        }
+
+        lenMatched = matchSubURL(tree, childNode, subURL, end, &subURL);
+        if (lenMatched < NODE(tree, childNode)->lenURL){
+            if (!insert) return NO_NODE;
+            //the URL leaves the sub-link of the child
+            //in the middle -> split the child there
+            splitNode(tree, childNode, lenMatched);
+        }
+        upperNode = childNode;
     }
+}
 
-    //call recursively this function for the rest part
-    //of the URL with the node inserted as upperNode
-    insertNode(nodeToInsert, restURL, depth);
 
+/**
+ * Add an URL to the set of parsed URLs of a tree
+ * (in the shard given by the high bits of its fingerprint)
+ * @return : 1 if the URL was added, 0 if it was alr parsed
+ */
+static int addParsed(URLTree *tree, const char *url, const char *end, int depth){
+    uint64_t hash;
+    uint32_t check;
+    int shard, res;
+
+    fingerprintURL(url, end - url, &hash, &check);
+    shard = hash >> (64 - URL_SHARDS_BITS);
+    pthread_mutex_lock(tree->parsedLocks + shard);
+    res = addFingerprint(tree->parsed + shard, hash, check, depth);
+    pthread_mutex_unlock(tree->parsedLocks + shard);
+    return res;
 }
 
+/**
+ * Tell if an URL is too long for the tree: no sub-link of it can
+ * be longer than the whole URL, an URL which passes always gets its
+ * node. Checked before the set of parsed URLs, an URL in the set
+ * is always in the tree (saveAllURLs, checkpoints).
+ * @return : 1 if the URL is rejected, 0 if not
+ */
+static int isTooLong(const char *url, const char *end){
+    if (subURLLength(url, end) <= MAX_SUBURL_LENGTH) return 0;
+    fprintf(stderr, "URL too long to be inserted.\n");
+    return 1;
+}
 
 /**
- * Insert a URL into the tree
- * @param root : the root of the tree
+ * Create (if needed) the node of an URL and give it its depth
+ */
+static void insertNode(URLTree *tree, const char *url, const char *end, int depth){
+    Node node;
+
+    pthread_mutex_lock(&(tree->lock));
+    node = descendTree(tree, ROOT_NODE, url, end, 1);
+    if (node != NO_NODE) NODE(tree, node)->depth = depth;
+    pthread_mutex_unlock(&(tree->lock));
+}
+
+
+/**
+ * Insert a URL into the tree (thread-safe)
+ * @param tree : the tree
  * @param URL : the url to be inserted in the tree
  * @param depth : the depth of the inserted node from the initial url
  * @return : nothing as the root always stay the same 
  */
-void insertURL(Node root, char *URL, int depth){
-    URL = delProtocol(URL);
-    insertNode(root, URL, depth);
-    free(URL);
+void insertURL(URLTree *tree, char *URL, int depth){
+    const char *url = skipProtocol(URL);
+    const char *end = url + strlen(url);
+
+    if (isTooLong(url, end)) return;
+    addParsed(tree, url, end, depth);
+    insertNode(tree, url, end, depth);
+}
+
+
+/**
+ * Insert a URL into the tree if it has not been parsed yet
+ * (one look-up in the set of parsed URLs, then one 
+ * descent of the tree for a new URL), thread-safe
+ * @param tree : the tree
+ * @param URL : the url to be inserted in the tree
+ * @param depth : the depth of the inserted node from the initial url
+ * @return : 1 if the URL was inserted, 0 if it was alr parsed
+ * (or it is longer than MAX_SUBURL_LENGTH)
+ */
+int insertURLIfNew(URLTree *tree, char *URL, int depth){
+    const char *url = skipProtocol(URL);
+    const char *end = url + strlen(url);
+
+    if (isTooLong(url, end)) return 0;
+    //the set decides which thread inserts a new URL
+    if (!addParsed(tree, url, end, depth)) return 0;
+    insertNode(tree, url, end, depth);
+    return 1;
 }
 
 
@@ -277,31 +694,289 @@ void insertURL(Node root, char *URL, int depth){
 
 
 /**
- * Delete (free) a node
- * @return : nothing
- * the value of the case to which pNode point turned to NULL
+ * Delete (free) the whole tree
+ * (the nodes and their sub-links are in 2 arenas,
+ * only the indexes of children are freed one by one)
+ * @return : the value of the case to which pTree point turned to NULL
  */
-void delNode(Node *pNode){
-    free((*pNode)->url);
-    free(*pNode);
-    *pNode = NULL;
+void delTree(URLTree **pTree){
+    if (*pTree == NULL) return;
+    free((*pTree)->nodes);
+    free((*pTree)->strings);
+    free((*pTree)->interned);
+    for (uint32_t i = 0; i < (*pTree)->nbIndexes; i++){
+        free((*pTree)->indexes[i].children);
+    }
+    free((*pTree)->indexes);
+    pthread_mutex_destroy(&((*pTree)->lock));
+    for (int i = 0; i < URL_SHARDS; i++){
+        delURLSet((*pTree)->parsed + i);
+        pthread_mutex_destroy((*pTree)->parsedLocks + i);
+    }
+    free(*pTree);
+    *pTree = NULL;
 }
 
+
+/*****************SNAPSHOT************************/
+
+
 /**
- * Delete (free) the whole tree
- * @return : the value of the case to which pNode point turned to NULL
+ * Write a block of bytes of a snapshot
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeBytes(FILE *f, const void *data, size_t size){
+    return size == 0 || fwrite(data, 1, size, f) == size ? 0 : -1;
+}
+
+/**
+ * Read a block of bytes of a snapshot, the cursor is moved after it
+ * @return : the block (in the snapshot), NULL if the snapshot is too short
+ */
+static const void *readBytes(const char **cursor, const char *end, size_t size){
+    const char *res = *cursor;
+
+    if ((size_t)(end - res) < size) return NULL;
+    *cursor += size;
+    return res;
+}
+
+/**
+ * Read a 32-bit number of a snapshot, the cursor is moved after it
+ * @return : 0 if succeeded, -1 if the snapshot is too short
  */
-void delTree(Node *pRoot){
-    if (*pRoot == NULL) return;
-    Node curNode = *pRoot;
-    Node nextSiblingNode;
-    Node childNode; 
+static int readUint32(const char **cursor, const char *end, uint32_t *value){
+    const void *data = readBytes(cursor, end, sizeof(uint32_t));
 
-    childNode = curNode->firstChild;
-    nextSiblingNode = curNode->nextSibling;
-    delNode(&curNode);
-    delTree(&childNode);
-    delTree(&nextSiblingNode);
+    if (data == NULL) return -1;
+    memcpy(value, data, sizeof(uint32_t));
+    return 0;
+}
+
+/**
+ * Copy a block of a snapshot in a new array
+ * @param size : the size of the block
+ * @param sizeAlloc : the size of the array (>= size)
+ * @return : the array, NULL if the snapshot is too short
+ */
+static void *copyBytes(const char **cursor, const char *end, size_t size, size_t sizeAlloc){
+    const void *data = readBytes(cursor, end, size);
+    void *res;
+
+    if (data == NULL) return NULL;
+    res = calloc(sizeAlloc == 0 ? 1 : sizeAlloc, 1);
+    if (res == NULL){
+        fprintf(stderr, "Allocation for tree from snapshot failed.\n");
+        exit(1);
+    }
+    memcpy(res, data, size);
+    return res;
+}
+
+/**
+ * Write a tree in a snapshot (thread-safe, no URL is
+ * inserted in the tree while it is written)
+ * @param tree : the tree
+ * @param f : the file of the snapshot
+ * @return : 0 if succeeded, -1 if not
+ */
+int writeTree(URLTree *tree, FILE *f){
+    uint32_t header[5];
+    uint64_t sizes[2];
+    int res = 0;
+
+    pthread_mutex_lock(&(tree->lock));
+    for (int i = 0; i < URL_SHARDS; i++) pthread_mutex_lock(tree->parsedLocks + i);
+
+    header[0] = tree->nbNodes;
+    header[1] = tree->lenStrings;
+    header[2] = tree->sizeInterned;
+    header[3] = tree->nbInterned;
+    header[4] = tree->nbIndexes;
+    res |= writeBytes(f, header, sizeof(header));
+    res |= writeBytes(f, tree->nodes, tree->nbNodes * sizeof(struct __node));
+    res |= writeBytes(f, tree->strings, tree->lenStrings);
+    res |= writeBytes(f, tree->interned, tree->sizeInterned * sizeof(InternedString));
+    for (uint32_t i = 0; i < tree->nbIndexes; i++){
+        res |= writeBytes(f, &(tree->indexes[i].nbChildren), sizeof(uint32_t));
+        res |= writeBytes(f, tree->indexes[i].children, tree->indexes[i].nbChildren * sizeof(uint32_t));
+    }
+    for (int i = 0; i < URL_SHARDS; i++){
+        sizes[0] = tree->parsed[i].size;
+        sizes[1] = tree->parsed[i].nbURLs;
+        res |= writeBytes(f, sizes, sizeof(sizes));
+        res |= writeBytes(f, tree->parsed[i].slots, tree->parsed[i].size * sizeof(URLFingerprint));
+    }
+
+    for (int i = URL_SHARDS - 1; i >= 0; i--) pthread_mutex_unlock(tree->parsedLocks + i);
+    pthread_mutex_unlock(&(tree->lock));
+    return res;
+}
+
+/**
+ * Verify that the links of a tree read from a snapshot
+ * stay in its arenas and form a tree: the nodes are browsed
+ * from the root, each other node must be reached exactly
+ * once, through the children of a single node, and each
+ * node must have as many children as it counts (a loop
+ * of links would make the browsing of the tree endless)
+ * @return : 1 if the tree is sound, 0 if not
+ */
+static int checkTree(URLTree *tree){
+    struct __node *node;
+    ChildIndex *index;
+    Node *reached, *parents, child;
+    uint32_t nbReached, nbChildren;
+    int sound = 1;
+
+    if (tree->nbNodes == 0) return 0;
+    for (uint32_t i = 0; i < tree->nbNodes; i++){
+        node = NODE(tree, i);
+        if ((uint64_t)node->url + node->lenURL > tree->lenStrings
+            || (node->nextSibling != NO_NODE && node->nextSibling >= tree->nbNodes)
+            || (node->firstChild != NO_NODE && node->firstChild >= tree->nbNodes)
+            || (node->childIndex != NO_INDEX && node->childIndex >= tree->nbIndexes)){
+            return 0;
+        }
+    }
+    if (NODE(tree, ROOT_NODE)->nextSibling != NO_NODE) return 0;
+    for (uint32_t i = 0; i < tree->sizeInterned; i++){
+        if ((uint64_t)tree->interned[i].offset + tree->interned[i].len > tree->lenStrings) return 0;
+    }
+
+    //nodes in the order they are reached and the node of which they are a child
+    reached = (Node*)malloc(tree->nbNodes * sizeof(Node));
+    parents = (Node*)malloc(tree->nbNodes * sizeof(Node));
+    if (reached == NULL || parents == NULL){
+        fprintf(stderr, "Allocation for tree check failed.\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < tree->nbNodes; i++) parents[i] = NO_NODE;
+    parents[ROOT_NODE] = ROOT_NODE;
+    reached[0] = ROOT_NODE;
+    nbReached = 1;
+    //each node is added once, the browsing ends after nbNodes nodes at most
+    for (uint32_t i = 0; sound && i < nbReached; i++){
+        nbChildren = 0;
+        for (child = NODE(tree, reached[i])->firstChild; child != NO_NODE;
+        child = NODE(tree, child)->nextSibling){
+            if (parents[child] != NO_NODE){
+                sound = 0;
+                break;
+            }
+            parents[child] = reached[i];
+            reached[nbReached++] = child;
+            nbChildren++;
+        }
+        //the index of the children is built from their count
+        if (nbChildren != NODE(tree, reached[i])->nbChildren) sound = 0;
+    }
+    if (nbReached != tree->nbNodes) sound = 0;
+
+    //an index only leads to the children of its node
+    for (uint32_t i = 0; sound && i < tree->nbNodes; i++){
+        node = NODE(tree, i);
+        if (node->childIndex == NO_INDEX) continue;
+        index = tree->indexes + node->childIndex;
+        if (index->nbChildren != node->nbChildren) sound = 0;
+        for (uint32_t j = 0; sound && j < index->nbChildren; j++){
+            if (index->children[j] >= tree->nbNodes || parents[index->children[j]] != i) sound = 0;
+        }
+    }
+    free(reached);
+    free(parents);
+    return sound;
+}
+
+/**
+ * Rebuild a tree from its snapshot
+ * @param cursor : where the snapshot of the tree starts,
+ * moved after it
+ * @param end : the end of the snapshot
+ * @return : the tree, NULL if the snapshot is damaged
+ */
+URLTree *readTree(const char **cursor, const char *end){
+    URLTree *tree;
+    uint32_t header[5];
+    uint64_t sizes[2];
+    const void *data;
+    int damaged = 0;
+
+    data = readBytes(cursor, end, sizeof(header));
+    if (data == NULL) return NULL;
+    memcpy(header, data, sizeof(header));
+    //the table of interned sub-links is probed with a mask
+    if (header[2] == 0 || (header[2] & (header[2] - 1)) != 0 || header[3] >= header[2]
+        || header[4] > header[0]){
+        return NULL;
+    }
+
+    tree = (URLTree*)calloc(1, sizeof(URLTree));
+    if (tree == NULL){
+        fprintf(stderr, "Allocation for new tree failed.\n");
+        exit(1);
+    }
+    tree->nbNodes = header[0];
+    tree->sizeNodes = header[0] > NODES_INITIAL_SIZE ? header[0] : NODES_INITIAL_SIZE;
+    tree->lenStrings = header[1];
+    tree->sizeStrings = header[1] > STRINGS_INITIAL_SIZE ? header[1] : STRINGS_INITIAL_SIZE;
+    tree->sizeInterned = header[2];
+    tree->nbInterned = header[3];
+    tree->nbIndexes = 0;
+    tree->sizeIndexes = header[4];
+    pthread_mutex_init(&(tree->lock), NULL);
+    for (int i = 0; i < URL_SHARDS; i++) pthread_mutex_init(tree->parsedLocks + i, NULL);
+
+    //the arenas are copied in buffers which can grow with the next URLs
+    tree->nodes = (struct __node*)copyBytes(cursor, end, (size_t)tree->nbNodes * sizeof(struct __node),
+                                            (size_t)tree->sizeNodes * sizeof(struct __node));
+    tree->strings = (char*)copyBytes(cursor, end, tree->lenStrings, tree->sizeStrings);
+    tree->interned = (InternedString*)copyBytes(cursor, end, (size_t)tree->sizeInterned * sizeof(InternedString),
+                                                (size_t)tree->sizeInterned * sizeof(InternedString));
+    damaged = tree->nodes == NULL || tree->strings == NULL || tree->interned == NULL;
+
+    if (!damaged && tree->sizeIndexes > 0){
+        tree->indexes = (ChildIndex*)malloc(tree->sizeIndexes * sizeof(ChildIndex));
+        if (tree->indexes == NULL){
+            fprintf(stderr, "Allocation for child index failed.\n");
+            exit(1);
+        }
+    }
+    while (!damaged && tree->nbIndexes < tree->sizeIndexes){
+        ChildIndex *index = tree->indexes + tree->nbIndexes;
+
+        if (readUint32(cursor, end, &(index->nbChildren)) != 0 || index->nbChildren == 0){
+            damaged = 1;
+            break;
+        }
+        index->size = 2 * index->nbChildren;
+        index->children = (uint32_t*)copyBytes(cursor, end, (size_t)index->nbChildren * sizeof(uint32_t),
+                                               (size_t)index->size * sizeof(uint32_t));
+        if (index->children == NULL) damaged = 1;
+        else tree->nbIndexes++;
+    }
+
+    for (int i = 0; i < URL_SHARDS; i++){
+        data = damaged ? NULL : readBytes(cursor, end, sizeof(sizes));
+        if (data != NULL) memcpy(sizes, data, sizeof(sizes));
+        //a set must have a power of 2 of slots, at most half full
+        if (data == NULL || sizes[0] == 0 || (sizes[0] & (sizes[0] - 1)) != 0 || 2 * sizes[1] > sizes[0]
+            || sizes[0] > (size_t)(end - *cursor) / sizeof(URLFingerprint)){
+            damaged = 1;
+            initURLSetOfSize(tree->parsed + i, URLSET_INITIAL_SIZE / URL_SHARDS);
+            continue;
+        }
+        tree->parsed[i].size = sizes[0];
+        tree->parsed[i].nbURLs = sizes[1];
+        tree->parsed[i].slots = (URLFingerprint*)copyBytes(cursor, end, sizes[0] * sizeof(URLFingerprint),
+                                                          sizes[0] * sizeof(URLFingerprint));
+    }
+
+    if (damaged || !checkTree(tree)){
+        delTree(&tree);
+        return NULL;
+    }
+    return tree;
 }
 
 
@@ -311,60 +986,40 @@ void delTree(Node *pRoot){
 /**
  * Find the node corresponding to an URL
  * (the node contains the last part of the URL in the tree)
+ * @param tree : the tree
  * @param upperNode : the curren parent node from where
  * we descend to find the last node of the URL
  * @param subURL: a part of the initial URL that we use 
  * to find the last node of the URL
  * @return : the last node if it exists in the tree
- *          NULL if not
+ *          NO_NODE if not
  */
-Node findNode(Node upperNode, char *subURL){
-    if (subURL == NULL || strlen(subURL) == 0){
-        return upperNode;
-    }
-
-    int order;
-    char *firstPartURL, *restURL;
-    Node childNode = upperNode->firstChild;
-
-    divideURL(subURL, &firstPartURL, &restURL);
-    while (childNode != NULL){
-        order = strcmp(firstPartURL, childNode->url);
-        if (order == 0){
-            free(firstPartURL);
-            return findNode(childNode, restURL);
-        }else if(order > 0){
-            childNode = childNode->nextSibling;
-        }else{
-            break;
-        }
-    }
-    free(firstPartURL);
-    return NULL;
+Node findNode(URLTree *tree, Node upperNode, char *subURL){
+    if (subURL == NULL) return upperNode;
+    return descendTree(tree, upperNode, subURL, subURL + strlen(subURL), 0);
 }
 
 
 /**
  * Verify if an URL has already been parsed
- * @param root : the root of the tree
+ * (answered by the set of parsed URLs, the tree is not browsed)
+ * @param tree : the tree
  * @param URL : the URL to be verified
  * @return : 1 if the URL was parsed
  *           0 if not
  */
-int URLAlrParsed(Node root, char *URL){
-    Node nodeOfURL = findNode(root, URL);
-    if (nodeOfURL == NULL){
-        //this URL has not been inserted into the tree
-        return 0;
-    }else{
-        if (nodeOfURL->depth == -1){
-            //this URL was inserted but has not been parsed
-            return 0;
-        }else{
-            //inserted and parsed
-            return 1;
-        }
-    }
+int URLAlrParsed(URLTree *tree, char *URL){
+    const char *url = skipProtocol(URL);
+    uint64_t hash;
+    uint32_t check;
+    int shard, res;
+
+    fingerprintURL(url, strlen(url), &hash, &check);
+    shard = hash >> (64 - URL_SHARDS_BITS);
+    pthread_mutex_lock(tree->parsedLocks + shard);
+    res = findFingerprint(tree->parsed + shard, hash, check);
+    pthread_mutex_unlock(tree->parsedLocks + shard);
+    return res != -1;
 }
 
 
@@ -391,73 +1046,160 @@ void printTree(Node root){
 }
 
 
+/**
+ * Print out the number of nodes of a tree and
+ * the memory used by its arenas and its set
+ * @param tree : the tree
+ * @param name : the name of the tree (name of its action)
+ * @param f : where to print
+ * @return : nothing
+ */
+void printTreeUsage(URLTree *tree, char *name, FILE *f){
+    size_t bytesNodes = (size_t)tree->sizeNodes * sizeof(struct __node);
+    size_t bytesInterned = (size_t)tree->sizeInterned * sizeof(InternedString);
+    size_t bytesSet = 0, nbURLs = 0;
+    size_t bytesIndexes = (size_t)tree->sizeIndexes * sizeof(ChildIndex);
+    size_t total;
+
+    for (int i = 0; i < URL_SHARDS; i++){
+        bytesSet += tree->parsed[i].size * sizeof(URLFingerprint);
+        nbURLs += tree->parsed[i].nbURLs;
+    }
+    for (uint32_t i = 0; i < tree->nbIndexes; i++){
+        bytesIndexes += (size_t)tree->indexes[i].size * sizeof(uint32_t);
+    }
+    total = bytesNodes + tree->sizeStrings + bytesInterned + bytesIndexes + bytesSet;
+
+    fprintf(f, "T: %s - %u nodes, %zu URLs parsed, %zu bytes (nodes %zu, strings %u, interned %zu, indexes %zu, set %zu), %zu bytes per URL\n",
+            name, tree->nbNodes, nbURLs, total,
+            bytesNodes, tree->sizeStrings, bytesInterned, bytesIndexes, bytesSet,
+            nbURLs == 0 ? 0 : total / nbURLs);
+}
+
+
 /*****************SAVE ALL URLS************************/
 
 
+/*A node of the tree whose siblings are still to be written, 
+* with the length of the URL of its parent in the path buffer
+*/
+typedef struct pathLevel{
+    Node node;
+    size_t lenPrefix;
+}PathLevel;
+
 /**
- * Construct and write the parsed URL to the file
- * @param upperNode : the current parent node from where
- * descend to retrieve other URLs
- * @param prefixURL : the prefix part of the URL 
- * @param f : the file to write the URL on
- * @return : 0 if their url are equals 
- *          -1 if node1->url < node2->url
- *           1 if node1->url > node2->url
+ * Make sure a buffer can hold size bytes
+ * (it is doubled until it is large enough)
  */
-void writeURL(Node upperNode, char *prefixURL, FILE *f){
-    if (upperNode == NULL || prefixURL == NULL){
-        return;
+static void *reserveBuffer(void *buffer, size_t *sizeBuffer, size_t size){
+    if (size <= *sizeBuffer) return buffer;
+    while (*sizeBuffer < size) *sizeBuffer *= 2;
+    buffer = realloc(buffer, *sizeBuffer);
+    if (buffer == NULL){
+        fprintf(stderr, "Allocation for saving URLs failed.\n");
+        exit(1);
     }
+    return buffer;
+}
 
-    Node childNode;
-    char *URLConstructed = NULL;
-    int size, sizePrefix;
-
-    sizePrefix = strlen(prefixURL);
-
-    for (childNode = upperNode->firstChild; childNode != NULL; 
-    childNode = childNode->nextSibling){
-        size = sizePrefix + strlen(childNode->url) + 2;
-        URLConstructed = (char*)malloc(size * sizeof(char));
-        strcpy(URLConstructed, prefixURL);
-        strcat(URLConstructed, "/");
-        strcat(URLConstructed, childNode->url);
+/**
+ * Write all the parsed URLs of a tree, one per line, in the
+ * alphabetical order of the tree (thread-safe). The tree is
+ * browsed with an explicit stack of levels and the URLs are
+ * built in a single buffer: a node costs no allocation.
+ * @param tree : the tree
+ * @param f : the file to write the URLs on
+ * @return : 0 if succeeded, -1 if not
+ */
+static int writeAllURLs(URLTree *tree, FILE *f){
+    size_t sizePath = 256, sizeStack = 16, nbLevels = 0, len;
+    char *path = (char*)malloc(sizePath * sizeof(char));
+    PathLevel *stack = (PathLevel*)malloc(sizeStack * sizeof(PathLevel));
+    struct __node *node;
+    int res = 0;
+
+    if (path == NULL || stack == NULL){
+        fprintf(stderr, "Allocation for saving URLs failed.\n");
+        exit(1);
+    }
 
-        if (childNode->depth != -1){
+    pthread_mutex_lock(&(tree->lock));
+    stack[nbLevels].node = NODE(tree, ROOT_NODE)->firstChild;
+    stack[nbLevels++].lenPrefix = 0;
+    while (nbLevels > 0){
+        if (stack[nbLevels - 1].node == NO_NODE){
+            //all the siblings of this level are written
+            nbLevels--;
+            continue;
+        }
+        node = NODE(tree, stack[nbLevels - 1].node);
+        len = stack[nbLevels - 1].lenPrefix;
+        stack[nbLevels - 1].node = node->nextSibling;
+
+        //the URL of the node replaces the one of its previous sibling
+        path = (char*)reserveBuffer(path, &sizePath, len + node->lenURL + 2);
+        if (len > 0) path[len++] = '/';
+        memcpy(path + len, tree->strings + node->url, node->lenURL);
+        len += node->lenURL;
+        if (node->depth != -1){
             //the URL constructed was parsed -> save it
-            fprintf(f, "%s\n", URLConstructed);
+            path[len] = '\n';
+            if (fwrite(path, 1, len + 1, f) != len + 1) res = -1;
+        }
+        if (node->firstChild != NO_NODE){
+            stack = (PathLevel*)reserveBuffer(stack, &sizeStack, (nbLevels + 1) * sizeof(PathLevel));
+            stack[nbLevels].node = node->firstChild;
+            stack[nbLevels++].lenPrefix = len;
         }
-        writeURL(childNode, URLConstructed, f);
-        free(URLConstructed);
     }
+    pthread_mutex_unlock(&(tree->lock));
+
+    free(path);
+    free(stack);
+    return res;
 }
 
 
 /**
  * Browse through the tree to find and save all 
- * the parsed URLs into a file 
- * @param root : root of the tree
- * @param action : the action executed
- * @return : nothing (a file is created and saved)
+ * the parsed URLs into a file (written aside and 
+ * renamed, the previous file stays whole if it fails)
+ * @param tree : the tree
+ * @param filePath : the file where the URLs are saved
+ * @return : 0 if succeeded, -1 if not
  */
-void saveAllURLs(Node root, Action *action){
+int saveAllURLs(URLTree *tree, const char *filePath){
+    char *tmpPath = (char*)malloc(strlen(filePath) + 5), *buffer;
     FILE *f;
-    int size;
-    char *fullPath;
+    int res;
 
-    size = strlen("data/") + strlen(action->name) + strlen("/hyperlinks.txt")+ 1;
-    fullPath = (char*)malloc(size * sizeof(char));
-    strcpy(fullPath, "data/");
-    strcat(fullPath, action->name);
-    strcat(fullPath, "/hyperlinks.txt");
-
-    f = fopen(fullPath, "w");
+    if (tmpPath == NULL){
+        fprintf(stderr, "Allocation for saving URLs failed.\n");
+        exit(1);
+    }
+    sprintf(tmpPath, "%s.tmp", filePath);
+    f = fopen(tmpPath, "w");
     if (f == NULL){
-        fprintf(stderr, "Cannot open file to save URLs\n");
+        fprintf(stderr, "Cannot open file %s\n", tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    //glibc ignores the size asked for a buffer it allocates itself
+    buffer = (char*)malloc(URL_LIST_BUFFER_SIZE * sizeof(char));
+    if (buffer == NULL){
+        fprintf(stderr, "Allocation for saving URLs failed.\n");
         exit(1);
     }
-    writeURL(root, "", f);
-
-    free(fullPath);
-    fclose(f);
-}
\ No newline at end of file
+    setvbuf(f, buffer, _IOFBF, URL_LIST_BUFFER_SIZE);
+    res = writeAllURLs(tree, f);
+    if (fclose(f) != 0) res = -1;
+    free(buffer);
+    if (res != 0 || rename(tmpPath, filePath) != 0){
+        fprintf(stderr, "Cannot write file %s\n", filePath);
+        remove(tmpPath);
+        res = -1;
+    }
+    free(tmpPath);
+    return res;
+}
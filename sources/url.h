@@ -12,41 +12,154 @@
 **              linked by a structure of alphabetically ordered linked list.
 **              - The root of the tree will have the url "" - an empty string,
 **              whose depth equals -1 and has no sibling node.
-**              
+**
 **              The tree structure helps keeping track of all parsed URL without
 **              consuming much of memory as each node only saves a part of the
 **              entire URL.
 **              Divide URLs into small parts and arrange nodes orderly helps 
 **              navigating the right node quick.
+**              - Alongside the tree, a set of fingerprints of the parsed 
+**              URLs (urlset.h) answers URLAlrParsed without walking the 
+**              tree. The tree is still what saveAllURLs browses.
+**              - All the nodes of a tree live in one array (the node arena)
+**              and all their sub-links in one buffer (the string arena).
+**              A node is designated by its index in the node arena and
+**              links between nodes are 32-bit indices, so deleting a tree
+**              only frees the 2 arenas.
+**              - A node counts its children. When a node gets more than
+**              FANOUT_THRESHOLD children, an index of its children sorted
+**              alphabetically is built (whatever the order of the searches)
+**              and searched by dichotomy instead of browsing the linked list.
+**              The linked list is kept up to date for the browsing in
+**              alphabetical order.
+**              - The tree is path-compressed: a chain of nodes with a single
+**              child and no URL of their own is merged into one node whose
+**              sub-link holds several parts ("static/js/app.js"). A node
+**              is split when a new URL leaves the chain in the middle.
+**              Siblings are ordered by the first part of their sub-link.
+**              - Sub-links are interned: a sub-link alr in the string arena
+**              is never copied again, so common parts ("index.html") are
+**              stored once per tree.
+**              - URLs are read in place (pointer and length), the tree is
+**              descended in a single loop and memory is only taken when
+**              new nodes are created.
+**              - A tree can be shared by several threads: the set of parsed
+**              URLs is split into URL_SHARDS sets, each with its own lock,
+**              chosen by the fingerprint of the URL. An URL alr parsed
+**              (the common case) only locks its shard, the tree itself is
+**              locked only to insert a new URL.
+**              - A tree can be written in a snapshot (writeTree) and rebuilt
+**              from it (readTree): the arenas, the interned table, the
+**              indexes and the sets are copied as they are, no URL is
+**              inserted again.
+**              - saveAllURLs browses the tree with an explicit stack and
+**              builds the URLs in a single buffer, a node costs no
+**              allocation whatever the size of the tree.
 */
 #ifndef __URL
 #define __URL
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "configuration.h"
+#include "urlset.h"
+
+#define NO_NODE UINT32_MAX        //index meaning "no node"
+#define ROOT_NODE 0               //index of the root in the node arena
+#define NODES_INITIAL_SIZE 256    //initial nb of nodes of the node arena
+#define STRINGS_INITIAL_SIZE 4096 //initial size of the string arena
+#define INTERNED_INITIAL_SIZE 1024 //initial nb of slots of the interned table
+#define MAX_SUBURL_LENGTH UINT16_MAX
+#ifndef FANOUT_THRESHOLD
+#define FANOUT_THRESHOLD 16       //nb of children from which they are indexed
+#endif
+#define NO_INDEX UINT32_MAX       //the children of a node are not indexed
+#define URL_SHARDS_BITS 4
+#define URL_SHARDS (1 << URL_SHARDS_BITS) //nb of sets of parsed URLs of a tree
+#define URL_LIST_BUFFER_SIZE (64 * 1024)  //stdio buffer of the file of saveAllURLs
 
 struct __node{
-    char *url;                  //the last part after a '/' of an url
-    int depth;                  //the depth of this link from the initial
+    uint32_t url;               //offset in the string arena of the
+                                //sub-link (one or more parts of an url)
+    uint16_t lenURL;            //length of the sub-link (not always
+                                //followed by '\0' in the string arena)
+    int16_t depth;              //the depth of this link from the initial
                                 //link whose depth = 0
-    struct __node *nextSibling;   //pointer to the next sibling node on the same level 
-    struct __node *firstChild;    //pointer to the first child node of this node
+    uint32_t nextSibling;       //index of the next sibling node on the same level
+    uint32_t firstChild;        //index of the first child node of this node
+    uint32_t childIndex;        //index of the ChildIndex of its children
+                                //NO_INDEX if they are only in the linked list
+    uint32_t nbChildren;        //nb of children of this node
 }; 
 
-typedef struct __node* Node; 
+/*Children of a node with a large number of children,
+* sorted alphabetically by their sub-links.
+*/
+typedef struct childIndex{
+    uint32_t *children;
+    uint32_t nbChildren;
+    uint32_t size;
+}ChildIndex;
 
+/*Sub-link of the string arena which can be shared
+* by all the nodes with the same sub-link.
+*/
+typedef struct internedString{
+    uint32_t offset;
+    uint32_t len;               //0 if the slot is empty
+}InternedString;
+
+typedef uint32_t Node;
+
+/*The tree of URLs of an action with the set of the URLs
+* already parsed (inserted with a depth) in this tree.
+*/
+typedef struct urlTree{
+    struct __node *nodes;       //the node arena
+    uint32_t nbNodes;
+    uint32_t sizeNodes;
+    char *strings;              //the string arena, sub-links separated by '\0'
+    uint32_t lenStrings;
+    uint32_t sizeStrings;
+    InternedString *interned;   //open addressing table of the sub-links
+    uint32_t nbInterned;        //of the string arena
+    uint32_t sizeInterned;
+    ChildIndex *indexes;        //indexes of the nodes with many children
+    uint32_t nbIndexes;
+    uint32_t sizeIndexes;
+    pthread_mutex_t lock;       //guards the arenas, the interned table and the indexes
+    URLSet parsed[URL_SHARDS];  //the parsed URLs, sharded by their fingerprint
+    pthread_mutex_t parsedLocks[URL_SHARDS];
+}URLTree;
+
+//the node n of a tree (the pointer is only valid until
+//the next node is added as the arena can be moved)
+#define NODE(tree, n) ((tree)->nodes + (n))
+//the sub-link of the node n of a tree (lenURL characters)
+#define SUBURL(tree, n) ((tree)->strings + (tree)->nodes[(n)].url)
 
 
 /**
- * Initialize a Node
+ * Initialize a Node in the arena of a tree
+ * @param tree : the tree the node belongs to
  * @param suburl : the string of sub-link of the url 
  * @param depth : the depth of this link from the initial
  * @param next : its next sibling
  * @param child : its first child
- * @return : the node itself
+ * @return : the index of the node
+ */
+Node initNode(URLTree *tree, char *suburl, int depth, Node next, Node child);
+
+/**
+ * Find where an URL starts once its protocol part 
+ * and the www. are skipped (the URL is not copied)
+ * @param url : the URL
+ * @return : the pointer to the first character after
+ * the protocol part and the www.
  */
-Node initNode(char *suburl, int depth, Node next, Node child);
+const char *skipProtocol(const char *url);
 
 /**
  * delete the protocol part in the URL 
@@ -58,61 +171,87 @@ char *delProtocol(char *url);
 /**
  * Make a tree from the very initial url 
  * @param url : the initial url of the tree
- * @return : the root of the tree
+ * @return : the tree
  */
-Node makeTree(char *url);
+URLTree *makeTree(char *url);
 
 /**
  * Compare two nodes by their url 
+ * @param tree : the tree of the nodes
  * @param node1, node2 : 2 nodes to be compared
  * @return : 0 if their url are equals 
  *          -1 if node1->url < node2->url
  *           1 if node1->url > node2->url
  */
-int compareNode(Node node1, Node node2);
+int compareNode(URLTree *tree, Node node1, Node node2);
 
 /**
- * Insert a node into the tree
- * @param root : the root of the tree
- * @param urlToInsert : the url of the node to be inserted
+ * Insert a URL into the tree (thread-safe)
+ * @param tree : the tree
+ * @param URL : the url to be inserted in the tree
  * @param depth : the depth of the inserted node from the initial url
  * @return : nothing as the root always stay the same 
  */
-void insertURL(Node root, char *URL, int depth);
+void insertURL(URLTree *tree, char *URL, int depth);
 
 /**
- * Delete (free) a node
- * @return : nothing
- * the value of the case to which pNode point turned to NULL
+ * Insert a URL into the tree if it has not been parsed yet
+ * (one look-up in the set of parsed URLs, then one 
+ * descent of the tree for a new URL), thread-safe
+ * @param tree : the tree
+ * @param URL : the url to be inserted in the tree
+ * @param depth : the depth of the inserted node from the initial url
+ * @return : 1 if the URL was inserted, 0 if it was alr parsed
+ * (or it is longer than MAX_SUBURL_LENGTH)
  */
-void delNode(Node *pNode);
+int insertURLIfNew(URLTree *tree, char *URL, int depth);
 
 /**
  * Delete (free) the whole tree
- * @return : the value of the case to which pNode point turned to NULL
+ * @return : the value of the case to which pTree point turned to NULL
+ */
+void delTree(URLTree **pTree);
+
+/**
+ * Write a tree in a snapshot (thread-safe, no URL is
+ * inserted in the tree while it is written)
+ * @param tree : the tree
+ * @param f : the file of the snapshot
+ * @return : 0 if succeeded, -1 if not
+ */
+int writeTree(URLTree *tree, FILE *f);
+
+/**
+ * Rebuild a tree from its snapshot
+ * @param cursor : where the snapshot of the tree starts,
+ * moved after it
+ * @param end : the end of the snapshot
+ * @return : the tree, NULL if the snapshot is damaged
  */
-void delTree(Node *pRoot);
+URLTree *readTree(const char **cursor, const char *end);
 
 /**
  * Find the node corresponding to an URL
  * (the node contains the last part of the URL in the tree)
+ * not thread-safe: no URL must be inserted at the same time
+ * @param tree : the tree
  * @param upperNode : the curren parent node from where
  * we descend to find the last node of the URL
  * @param subURL: a part of the initial URL that we use 
  * to find the last node of the URL
  * @return : the last node if it exists in the tree
- *          NULL if not
+ *          NO_NODE if not
  */
-Node findNode(Node upperNode, char *subURL);
+Node findNode(URLTree *tree, Node upperNode, char *subURL);
 
 /**
- * Verify if an URL has already been parsed
- * @param root : the root of the tree
+ * Verify if an URL has already been parsed (thread-safe)
+ * @param tree : the tree
  * @param URL : the URL to be verified
  * @return : 1 if the URL was parsed
  *           0 if not
  */
-int URLAlrParsed(Node root, char *URL);
+int URLAlrParsed(URLTree *tree, char *URL);
 
 /**
  * Print out the whole tree
@@ -121,15 +260,23 @@ int URLAlrParsed(Node root, char *URL);
  */
 void printTree(Node root);
 
+/**
+ * Print out the number of nodes of a tree and
+ * the memory used by its arenas and its set
+ * @param tree : the tree
+ * @param name : the name of the tree (name of its action)
+ * @param f : where to print
+ * @return : nothing
+ */
+void printTreeUsage(URLTree *tree, char *name, FILE *f);
+
 /**
  * Browse through the tree to find and save all 
- * the parsed URLs into a file 
- * @param root : root of the tree
- * @param filePath : the path (the folder) to
- * save the file
- * @param URL : the initial URL given by the action
- * we use this URL as the name of the file
- * @return : nothing (a file is created and saved)
+ * the parsed URLs into a file (written aside and 
+ * renamed, the previous file stays whole if it fails)
+ * @param tree : the tree
+ * @param filePath : the file where the URLs are saved
+ * @return : 0 if succeeded, -1 if not
  */
-void saveAllURLs(Node root, Action *action);
-#endif
\ No newline at end of file
+int saveAllURLs(URLTree *tree, const char *filePath);
+#endif
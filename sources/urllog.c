@@ -0,0 +1,135 @@
+/*
+**  Filename : urllog.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Log of the URLs done by an action, DATA_DIR/name of
+**              action/URL_LOG_FILE, next to its contents.
+**              - The URL of each transfer over is appended as soon as the
+**              transfer is done, the log of a crawl which dies is not lost
+**              (it is flushed with each checkpoint, see checkpoint.h).
+**              - The URLs go through a large stdio buffer, a line costs
+**              no system call.
+**              - A crawl started from the beginning starts a new log, a
+**              crawl resumed from its checkpoint goes on with its log.
+**              - Once the crawl is over, the log is replaced by the list of
+**              all the URLs of the tree (saveAllURLs in url.h).
+**              - A log can be used by several threads, but an action has
+**              only one log at a time: its file is opened with "w" and
+**              replaced at the end of the crawl, which assumes one crawl
+**              of the action in progress. The crawls make sure of it (see
+**              Crawl in parse.h).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "urllog.h"
+#include "directory.h"
+
+
+/**
+ * Get the file of the log of an action, create its directory if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the path of the file (to be freed), NULL if its
+ * directory cannot be created
+ */
+char *makeURLLogPath(const char *actionName){
+  const char *dirPath = getDirectory(actionName, NULL);
+  char *res;
+
+  if (dirPath == NULL) return NULL;
+  res = (char*)malloc(strlen(dirPath) + strlen(URL_LOG_FILE) + 1);
+  if (res == NULL){
+    fprintf(stderr, "Allocation for path of URL log failed.\n");
+    exit(1);
+  }
+  strcpy(res, dirPath);
+  strcat(res, URL_LOG_FILE);
+  return res;
+}
+
+/**
+ * Initialize the log of an action, its file is opened with its first URL
+ * (only one log of an action at a time, see Crawl in parse.h)
+ * @param log : the log to be initialized
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param append : 1 to go on with the log of the crawl resumed,
+ * 0 to start a new one
+ * @return : nothing, the log is modified through the pointer
+ */
+void initURLLog(URLLog *log, const char *actionName, int append){
+  log->actionName = strdup(actionName);
+  log->f = NULL;
+  log->buffer = NULL;
+  log->append = append;
+  pthread_mutex_init(&(log->lock), NULL);
+}
+
+/**
+ * Open the file of a log (its lock held)
+ * @return : 0 if succeeded, -1 if not
+ */
+static int openURLLog(URLLog *log){
+  char *path = makeURLLogPath(log->actionName);
+
+  if (path == NULL) return -1;
+  log->f = fopen(path, log->append ? "a" : "w");
+  if (log->f == NULL) fprintf(stderr, "Cannot open file %s\n", path);
+  else{
+    //glibc ignores the size asked for a buffer it allocates itself
+    log->buffer = (char*)malloc(URL_LOG_BUFFER_SIZE * sizeof(char));
+    if (log->buffer == NULL){
+      fprintf(stderr, "Allocation for URL log failed.\n");
+      exit(1);
+    }
+    setvbuf(log->f, log->buffer, _IOFBF, URL_LOG_BUFFER_SIZE);
+  }
+  free(path);
+  return log->f == NULL ? -1 : 0;
+}
+
+/**
+ * Append an URL done to a log
+ * @param log : the log
+ * @param url : the URL
+ * @return : nothing
+ */
+void addToURLLog(URLLog *log, const char *url){
+  pthread_mutex_lock(&(log->lock));
+  if (log->f != NULL || openURLLog(log) == 0){
+    fputs(url, log->f);
+    fputc('\n', log->f);
+  }
+  pthread_mutex_unlock(&(log->lock));
+}
+
+/**
+ * Write the URLs buffered of a log to its file
+ * @param log : the log
+ * @return : 0 if the log is on disk, -1 if not
+ */
+int flushURLLog(URLLog *log){
+  int res = 0;
+
+  pthread_mutex_lock(&(log->lock));
+  if (log->f != NULL && fflush(log->f) != 0) res = -1;
+  pthread_mutex_unlock(&(log->lock));
+  return res;
+}
+
+/**
+ * Close the file of a log and free it
+ * @param log : the log
+ * @return : 0 if the log is on disk, -1 if not
+ */
+int closeURLLog(URLLog *log){
+  int res = 0;
+
+  if (log->f != NULL && fclose(log->f) != 0) res = -1;
+  log->f = NULL;
+  free(log->buffer);
+  log->buffer = NULL;
+  free(log->actionName);
+  pthread_mutex_destroy(&(log->lock));
+  return res;
+}
@@ -0,0 +1,82 @@
+/*
+**  Filename : urllog.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Log of the URLs done by an action, DATA_DIR/name of
+**              action/URL_LOG_FILE, next to its contents.
+**              - The URL of each transfer over is appended as soon as the
+**              transfer is done, the log of a crawl which dies is not lost
+**              (it is flushed with each checkpoint, see checkpoint.h).
+**              - The URLs go through a large stdio buffer, a line costs
+**              no system call.
+**              - A crawl started from the beginning starts a new log, a
+**              crawl resumed from its checkpoint goes on with its log.
+**              - Once the crawl is over, the log is replaced by the list of
+**              all the URLs of the tree (saveAllURLs in url.h).
+**              - A log can be used by several threads, but an action has
+**              only one log at a time: its file is opened with "w" and
+**              replaced at the end of the crawl, which assumes one crawl
+**              of the action in progress. The crawls make sure of it (see
+**              Crawl in parse.h).
+*/
+#ifndef __URLLOG
+#define __URLLOG
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define URL_LOG_FILE "hyperlinks.txt"
+#define URL_LOG_BUFFER_SIZE (64 * 1024)
+
+typedef struct urlLog{
+  char *actionName;         //name of the action (spaces replaced by '_')
+  FILE *f;                  //NULL until its first URL
+  char *buffer;             //stdio buffer of the file
+  int append;               //1 to go on with the log of a previous run
+  pthread_mutex_t lock;
+}URLLog;
+
+/**
+ * Get the file of the log of an action, create its directory if needed
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @return : the path of the file (to be freed), NULL if its
+ * directory cannot be created
+ */
+char *makeURLLogPath(const char *actionName);
+
+/**
+ * Initialize the log of an action, its file is opened with its first URL
+ * (only one log of an action at a time, see Crawl in parse.h)
+ * @param log : the log to be initialized
+ * @param actionName : name of the action (spaces replaced by '_')
+ * @param append : 1 to go on with the log of the crawl resumed,
+ * 0 to start a new one
+ * @return : nothing, the log is modified through the pointer
+ */
+void initURLLog(URLLog *log, const char *actionName, int append);
+
+/**
+ * Append an URL done to a log
+ * @param log : the log
+ * @param url : the URL
+ * @return : nothing
+ */
+void addToURLLog(URLLog *log, const char *url);
+
+/**
+ * Write the URLs buffered of a log to its file
+ * @param log : the log
+ * @return : 0 if the log is on disk, -1 if not
+ */
+int flushURLLog(URLLog *log);
+
+/**
+ * Close the file of a log and free it
+ * @param log : the log
+ * @return : 0 if the log is on disk, -1 if not
+ */
+int closeURLLog(URLLog *log);
+
+#endif
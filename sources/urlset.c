@@ -0,0 +1,197 @@
+/*
+**  Filename : urlset.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Set of the URLs parsed by an action, kept alongside the
+**              tree of URLs (url.h) to answer "already parsed?" in O(1).
+**              - An URL is not stored, only its fingerprint: a 64-bit
+**              hash used to place it in the table plus an independent
+**              32-bit hash to tell apart 2 URLs whose 64-bit hashes
+**              collide. Looking up an URL never allocates memory.
+**              - The table uses open addressing with linear probing and
+**              doubles its size when it is half full. Growing only needs
+**              the fingerprints, never the URLs.
+**              - The '/' at the end or repeated do not change the fingerprint
+**              of an URL, as they do not change its place in the tree.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "urlset.h"
+
+
+/**
+ * Allocate the slots of a set, all empty
+ */
+static void allocSlots(URLSet *set, size_t size){
+  set->slots = (URLFingerprint*)calloc(size, sizeof(URLFingerprint));
+  if (set->slots == NULL){
+    fprintf(stderr, "Allocation for URL set failed.\n");
+    exit(1);
+  }
+  set->size = size;
+}
+
+/**
+ * Initialize an empty set
+ * @param set : the set to be initialized
+ * @return : nothing, the set is modified through the pointer
+ */
+void initURLSet(URLSet *set){
+  initURLSetOfSize(set, URLSET_INITIAL_SIZE);
+}
+
+/**
+ * Initialize an empty set with a given number of slots
+ * @param set : the set to be initialized
+ * @param size : the number of slots, a power of 2
+ * @return : nothing, the set is modified through the pointer
+ */
+void initURLSetOfSize(URLSet *set, size_t size){
+  allocSlots(set, size);
+  set->nbURLs = 0;
+}
+
+/**
+ * Free the memory held by a set
+ * @param set : the set to be freed
+ * @return : nothing
+ */
+void delURLSet(URLSet *set){
+  free(set->slots);
+  set->slots = NULL;
+  set->size = 0;
+  set->nbURLs = 0;
+}
+
+/**
+ * Compute the fingerprint of an URL: FNV-1a on 64 bits
+ * (mixed at the end to spread the low bits used as index)
+ * and FNV-1 on 32 bits as the check
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @param hash, check : where the fingerprint is saved
+ * @return : nothing
+ */
+void fingerprintURL(const char *url, size_t len, uint64_t *hash, uint32_t *check){
+  uint64_t h = 14695981039346656037ULL;
+  uint32_t c = 2166136261U;
+
+  //'/' at the end or repeated do not lead to another node in the tree
+  while (len > 0 && url[len - 1] == '/') len--;
+
+  for (size_t i = 0; i < len; i++){
+    if (url[i] == '/' && (i == 0 || url[i - 1] == '/')) continue;
+    h = (h ^ (unsigned char)url[i]) * 1099511628211ULL;
+    c = (c * 16777619U) ^ (unsigned char)url[i];
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+
+  *hash = h == 0 ? 1 : h;   //0 marks an empty slot
+  *check = c;
+}
+
+/**
+ * Find the slot of a fingerprint: either the slot holding
+ * it or the empty slot where it would be inserted
+ */
+static URLFingerprint *findSlot(const URLSet *set, uint64_t hash, uint32_t check){
+  size_t mask = set->size - 1;
+  size_t idx = hash & mask;
+  URLFingerprint *slot;
+
+  while (1){
+    slot = set->slots + idx;
+    if (slot->hash == 0) return slot;
+    if (slot->hash == hash && slot->check == check) return slot;
+    idx = (idx + 1) & mask;
+  }
+}
+
+/**
+ * Double the number of slots of a set and
+ * move all fingerprints to their new slots
+ */
+static void growURLSet(URLSet *set){
+  URLFingerprint *oldSlots = set->slots;
+  size_t oldSize = set->size;
+
+  allocSlots(set, oldSize * 2);
+  for (size_t i = 0; i < oldSize; i++){
+    if (oldSlots[i].hash != 0){
+      *findSlot(set, oldSlots[i].hash, oldSlots[i].check) = oldSlots[i];
+    }
+  }
+  free(oldSlots);
+}
+
+/**
+ * Add the fingerprint of an URL to the set, an URL
+ * already in the set keeps the depth it was added with
+ * @param set : the set
+ * @param hash, check : the fingerprint given by fingerprintURL
+ * @param depth : the depth of the URL from the initial URL
+ * @return : 1 if the URL was added, 0 if it was alr in the set
+ */
+int addFingerprint(URLSet *set, uint64_t hash, uint32_t check, int depth){
+  URLFingerprint *slot;
+
+  if (2 * (set->nbURLs + 1) > set->size) growURLSet(set);
+
+  slot = findSlot(set, hash, check);
+  if (slot->hash != 0) return 0;
+
+  slot->hash = hash;
+  slot->check = check;
+  slot->depth = depth;
+  set->nbURLs++;
+  return 1;
+}
+
+/**
+ * Look for the fingerprint of an URL in the set
+ * @param set : the set
+ * @param hash, check : the fingerprint given by fingerprintURL
+ * @return : the depth of the URL if it is in the set
+ *           -1 if not
+ */
+int findFingerprint(const URLSet *set, uint64_t hash, uint32_t check){
+  URLFingerprint *slot = findSlot(set, hash, check);
+  return slot->hash == 0 ? -1 : slot->depth;
+}
+
+/**
+ * Add an URL to the set, an URL already in the
+ * set keeps the depth it was added with
+ * @param set : the set
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @param depth : the depth of the URL from the initial URL
+ * @return : 1 if the URL was added, 0 if it was alr in the set
+ */
+int addToURLSet(URLSet *set, const char *url, size_t len, int depth){
+  uint64_t hash;
+  uint32_t check;
+
+  fingerprintURL(url, len, &hash, &check);
+  return addFingerprint(set, hash, check, depth);
+}
+
+/**
+ * Look for an URL in the set
+ * @param set : the set
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @return : the depth of the URL if it is in the set
+ *           -1 if not
+ */
+int findInURLSet(const URLSet *set, const char *url, size_t len){
+  uint64_t hash;
+  uint32_t check;
+
+  fingerprintURL(url, len, &hash, &check);
+  return findFingerprint(set, hash, check);
+}
@@ -0,0 +1,112 @@
+/*
+**  Filename : urlset.h
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Set of the URLs parsed by an action, kept alongside the
+**              tree of URLs (url.h) to answer "already parsed?" in O(1).
+**              - An URL is not stored, only its fingerprint: a 64-bit
+**              hash used to place it in the table plus an independent
+**              32-bit hash to tell apart 2 URLs whose 64-bit hashes
+**              collide. Looking up an URL never allocates memory.
+**              - The table uses open addressing with linear probing and
+**              doubles its size when it is half full. Growing only needs
+**              the fingerprints, never the URLs.
+**              - The '/' at the end or repeated do not change the fingerprint
+**              of an URL, as they do not change its place in the tree.
+*/
+#ifndef __URLSET
+#define __URLSET
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define URLSET_INITIAL_SIZE 1024
+
+typedef struct urlFingerprint{
+  uint64_t hash;        //0 if the slot is empty
+  uint32_t check;       //second hash of the URL
+  int32_t depth;        //depth of the URL from the initial URL
+}URLFingerprint;
+
+typedef struct urlSet{
+  URLFingerprint *slots;
+  size_t size;          //number of slots, always a power of 2
+  size_t nbURLs;        //number of slots used
+}URLSet;
+
+/**
+ * Initialize an empty set
+ * @param set : the set to be initialized
+ * @return : nothing, the set is modified through the pointer
+ */
+void initURLSet(URLSet *set);
+
+/**
+ * Initialize an empty set with a given number of slots
+ * @param set : the set to be initialized
+ * @param size : the number of slots, a power of 2
+ * @return : nothing, the set is modified through the pointer
+ */
+void initURLSetOfSize(URLSet *set, size_t size);
+
+/**
+ * Free the memory held by a set
+ * @param set : the set to be freed
+ * @return : nothing
+ */
+void delURLSet(URLSet *set);
+
+/**
+ * Compute the fingerprint of an URL, to choose the set
+ * of an URL among several before adding it to this set
+ * (the low bits of the hash are used inside a set)
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @param hash, check : where the fingerprint is saved
+ * @return : nothing
+ */
+void fingerprintURL(const char *url, size_t len, uint64_t *hash, uint32_t *check);
+
+/**
+ * Add the fingerprint of an URL to the set, an URL
+ * already in the set keeps the depth it was added with
+ * @param set : the set
+ * @param hash, check : the fingerprint given by fingerprintURL
+ * @param depth : the depth of the URL from the initial URL
+ * @return : 1 if the URL was added, 0 if it was alr in the set
+ */
+int addFingerprint(URLSet *set, uint64_t hash, uint32_t check, int depth);
+
+/**
+ * Look for the fingerprint of an URL in the set
+ * @param set : the set
+ * @param hash, check : the fingerprint given by fingerprintURL
+ * @return : the depth of the URL if it is in the set
+ *           -1 if not
+ */
+int findFingerprint(const URLSet *set, uint64_t hash, uint32_t check);
+
+/**
+ * Add an URL to the set, an URL already in the
+ * set keeps the depth it was added with
+ * @param set : the set
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @param depth : the depth of the URL from the initial URL
+ * @return : 1 if the URL was added, 0 if it was alr in the set
+ */
+int addToURLSet(URLSet *set, const char *url, size_t len, int depth);
+
+/**
+ * Look for an URL in the set
+ * @param set : the set
+ * @param url : the URL (without protocol)
+ * @param len : the length of url
+ * @return : the depth of the URL if it is in the set
+ *           -1 if not
+ */
+int findInURLSet(const URLSet *set, const char *url, size_t len);
+
+#endif
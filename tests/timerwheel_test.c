@@ -0,0 +1,456 @@
+/*
+**  Filename : timerwheel_test.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Tests of the timer wheel (timerwheel.h) and of the
+**              scheduler built on it (scheduler.h), driven by a fake clock.
+**              - The wheel: NB_TIMERS timers with delays spread over
+**              several levels fire once each, at their expiry when the
+**              clock jumps to the time the wheel asks for, and within one
+**              tick of it when the clock ticks. Timers added again while
+**              firing and timers already expired are also checked.
+**              - The scheduler: a run longer than the interval of its task
+**              coalesces the runs due meanwhile into one run started when
+**              it is over, and a clock jumping over several intervals
+**              starts one run and skips the others without drifting.
+**              - The scheduler is linked with stubs of the crawl (the run
+**              of a task only waits for the fake clock) and of the signals
+**              (its watcher is kept to reach the scheduler).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "timerwheel.h"
+#include "scheduler.h"
+#include "parse.h"
+
+#define NB_TIMERS 5000
+#define TICK 10                   //ms between 2 ticks of the ticking clock
+#define NB_REARMS 3               //nb of times a timer is added again
+#define MAX_STARTS 64             //max nb of runs recorded for a task
+#define STEP 100                  //ms between 2 steps of the scheduler tests
+
+#define CHECK(cond, ...) do{ \
+  if (!(cond)){ \
+    printf("%s:%d: ", __FILE__, __LINE__); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+    nbFailures++; \
+  } \
+}while (0)
+
+typedef struct testTimer{
+  Timer timer;
+  int nbFired;
+  int nbRearms;
+}TestTimer;
+
+/*A task of the scheduler tests with the runs of its stub*/
+typedef struct testTask{
+  Task task;
+  long long duration;             //ms a run of the task lasts
+  long long starts[MAX_STARTS];   //fake time of the start of each run
+  int nbStarts;
+}TestTask;
+
+/*The fake clock, the time only moves when a test moves it*/
+typedef struct fakeClock{
+  long long now;
+  long long lastRead;             //last time read by the scheduler
+  int stop;                       //1 once the test asks the scheduler to stop
+  long long ends[MAX_STARTS];     //end of each run in progress
+  int nbActive;                   //nb of runs in progress in their stub
+  TestTask *tasks;
+  int nbTasks;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;            //broadcast when the time moves
+}FakeClock;
+
+static int nbFailures = 0;
+static unsigned int seed = 12345;
+static FakeClock fake;
+static SignalWatcher *watcher;    //the watcher of the scheduler running
+
+
+/**
+ * Get a pseudo-random number (same numbers on each run)
+ * @return : the number
+ */
+static unsigned int nextRandom(){
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+/**
+ * Get a delay in one of the first levels of the wheel
+ * @return : the delay (ms)
+ */
+static long long randomDelay(){
+  static const long long ranges[] = {WHEEL_SLOTS, WHEEL_SLOTS * WHEEL_SLOTS,
+                                     WHEEL_SLOTS * WHEEL_SLOTS * WHEEL_SLOTS, 1LL << 22};
+
+  return ((long long)nextRandom() << 8 | (nextRandom() & 0xff)) % ranges[nextRandom() % 4];
+}
+
+/**
+ * Add the test timers to a wheel, with delays spread over its levels
+ * @return : the latest expiry
+ */
+static long long addTestTimers(TimerWheel *wheel, TestTimer *timers, long long now){
+  long long last = now;
+
+  for (int i = 0; i < NB_TIMERS; i++){
+    timers[i].timer.data = timers + i;
+    timers[i].nbFired = 0;
+    timers[i].nbRearms = 0;
+    addTimer(wheel, &(timers[i].timer), now + randomDelay());
+    if (timers[i].timer.expiry > last) last = timers[i].timer.expiry;
+  }
+  return last;
+}
+
+/**
+ * Check the timers fired by an advance of the wheel to now
+ * @param tick : the max lateness allowed (ms), a timer due at the
+ * time alr reached fires at the next advance
+ * @param rearm : 1 to add again some of the timers fired
+ * @return : the nb of timers fired
+ */
+static int checkFired(TimerWheel *wheel, Timer *fired, long long now, long long tick, int rearm){
+  TestTimer *test;
+  Timer *next;
+  int nbFired = 0;
+
+  for (; fired != NULL; fired = next){
+    next = fired->next;
+    test = (TestTimer*)fired->data;
+    CHECK(fired->expiry <= now && now <= fired->expiry + tick,
+          "timer due at %lld fired at %lld", fired->expiry, now);
+    test->nbFired++;
+    nbFired++;
+    if (rearm && test->nbRearms < NB_REARMS && nextRandom() % 3 == 0){
+      test->nbRearms++;
+      test->nbFired--;
+      addTimer(wheel, fired, now + randomDelay());
+    }
+  }
+  return nbFired;
+}
+
+/**
+ * Drive the wheel by jumping to the time it asks for, as the
+ * scheduler sleeps: every timer fires at its expiry
+ */
+static void testJumpingClock(){
+  TimerWheel wheel;
+  TestTimer *timers = (TestTimer*)malloc(NB_TIMERS * sizeof(TestTimer));
+  long long now = 1000003, next;
+
+  initTimerWheel(&wheel, now);
+  addTestTimers(&wheel, timers, now);
+  CHECK(wheel.nbTimers == NB_TIMERS, "%zu timers in the wheel", wheel.nbTimers);
+  while ((next = nextTimerWheel(&wheel)) >= 0){
+    CHECK(next >= now, "the wheel asks to go back from %lld to %lld", now, next);
+    if (next < now) break;
+    now = next;
+    checkFired(&wheel, advanceTimerWheel(&wheel, now), now, 0, 1);
+  }
+  CHECK(wheel.nbTimers == 0, "%zu timers left in the wheel", wheel.nbTimers);
+  for (int i = 0; i < NB_TIMERS; i++){
+    CHECK(timers[i].nbFired == 1, "timer %d fired %d times", i, timers[i].nbFired);
+  }
+  free(timers);
+}
+
+/**
+ * Drive the wheel by a clock ticking every TICK ms:
+ * every timer fires within one tick of its expiry
+ */
+static void testTickingClock(){
+  TimerWheel wheel;
+  TestTimer *timers = (TestTimer*)malloc(NB_TIMERS * sizeof(TestTimer));
+  long long now = 77, last;
+  int nbFired = 0;
+
+  initTimerWheel(&wheel, now);
+  last = addTestTimers(&wheel, timers, now);
+  while (wheel.nbTimers > 0 && now <= last + NB_REARMS * (1LL << 22) + TICK){
+    now += TICK;
+    nbFired += checkFired(&wheel, advanceTimerWheel(&wheel, now), now, TICK, 1);
+  }
+  CHECK(wheel.nbTimers == 0, "%zu timers left in the wheel", wheel.nbTimers);
+  CHECK(nbFired >= NB_TIMERS, "%d timers fired", nbFired);
+  for (int i = 0; i < NB_TIMERS; i++){
+    CHECK(timers[i].nbFired == 1, "timer %d fired %d times", i, timers[i].nbFired);
+  }
+  free(timers);
+}
+
+/**
+ * A timer added with an expiry already reached fires at
+ * the next advance, even if the time does not move
+ */
+static void testExpiredTimer(){
+  TimerWheel wheel;
+  Timer late, onTime;
+  Timer *fired;
+
+  initTimerWheel(&wheel, 5000);
+  addTimer(&wheel, &late, 4990);
+  addTimer(&wheel, &onTime, 5000);
+  CHECK(nextTimerWheel(&wheel) == 5000, "next time %lld instead of 5000", nextTimerWheel(&wheel));
+  fired = advanceTimerWheel(&wheel, 5000);
+  CHECK(fired == &late && fired->next == &onTime && onTime.next == NULL, "expired timers not fired in order");
+  CHECK(wheel.nbTimers == 0 && nextTimerWheel(&wheel) == -1, "the wheel is not empty");
+}
+
+
+/*****************STUBS OF THE SCHEDULER************************/
+
+
+/**
+ * Run of a task: it lasts the duration of its test task on the fake clock
+ * (or until the test asks the scheduler to stop)
+ */
+void parseATask(Task *task, int nbThreads){
+  TestTask *test = NULL;
+  long long end;
+  int k;
+
+  pthread_mutex_lock(&(fake.lock));
+  for (int i = 0; i < fake.nbTasks; i++){
+    if (&(fake.tasks[i].task) == task) test = fake.tasks + i;
+  }
+  if (test->nbStarts < MAX_STARTS) test->starts[test->nbStarts] = fake.now;
+  test->nbStarts++;
+  end = fake.now + test->duration;
+  k = fake.nbActive++;
+  fake.ends[k] = end;
+  while (fake.now < end && !fake.stop) pthread_cond_wait(&(fake.cond), &(fake.lock));
+  //the run leaves the runs in progress
+  for (k = 0; fake.ends[k] != end; k++);
+  fake.ends[k] = fake.ends[--fake.nbActive];
+  pthread_mutex_unlock(&(fake.lock));
+}
+
+long long getTimeMs(){
+  return fake.now;
+}
+
+int stopAsked(){
+  return fake.stop;
+}
+
+void watchSignals(SignalWatcher *signalWatcher){
+  watcher = signalWatcher;
+}
+
+void unwatchSignals(SignalWatcher *signalWatcher){
+}
+
+/**
+ * The fake clock given to the scheduler
+ */
+static long long fakeNow(void *arg){
+  long long now;
+
+  pthread_mutex_lock(&(fake.lock));
+  now = fake.now;
+  fake.lastRead = now;
+  pthread_mutex_unlock(&(fake.lock));
+  return now;
+}
+
+
+/*****************SCHEDULER TESTS************************/
+
+
+typedef struct schedulerRun{
+  Configure config;
+  SchedulerClock clock;
+}SchedulerRun;
+
+static void *runSchedulerThread(void *arg){
+  SchedulerRun *run = (SchedulerRun*)arg;
+
+  runScheduler(&(run->config), 1, &(run->clock));
+  return NULL;
+}
+
+/**
+ * Check if the scheduler has handled the current time of the fake clock:
+ * it read the time, the runs over are joined and the runs started
+ * are in progress (the lock of the scheduler held)
+ */
+static int schedulerSettled(Scheduler *scheduler){
+  int settled;
+
+  pthread_mutex_lock(&(fake.lock));
+  settled = fake.lastRead == fake.now && scheduler->nbRunning == fake.nbActive;
+  for (int k = 0; k < fake.nbActive; k++){
+    if (fake.ends[k] <= fake.now) settled = 0;
+  }
+  pthread_mutex_unlock(&(fake.lock));
+  for (int i = 0; i < scheduler->nbTasks; i++){
+    if (scheduler->tasks[i].ended) settled = 0;
+  }
+  return settled;
+}
+
+/**
+ * Move the fake clock to a time and wait until the scheduler handled it
+ */
+static void moveClock(long long now){
+  Scheduler *scheduler = (Scheduler*)watcher->arg;
+  int settled = 0;
+
+  pthread_mutex_lock(&(fake.lock));
+  fake.now = now;
+  pthread_cond_broadcast(&(fake.cond));
+  pthread_mutex_unlock(&(fake.lock));
+  while (!settled){
+    pthread_mutex_lock(&(scheduler->lock));
+    settled = schedulerSettled(scheduler);
+    //the scheduler sleeps on the real clock, it is woken up to read the fake one
+    if (!settled) pthread_cond_signal(&(scheduler->cond));
+    pthread_mutex_unlock(&(scheduler->lock));
+    if (!settled) usleep(100);
+  }
+}
+
+/**
+ * Start a scheduler with one task, on the fake clock at 0
+ */
+static void startScheduler(SchedulerRun *run, TestTask *test, Task **tasks, pthread_t *thread,
+                           int interval, long long duration){
+  memset(test, 0, sizeof(TestTask));
+  test->task.name = "test";
+  test->task.time.sec = interval;
+  test->duration = duration;
+  tasks[0] = &(test->task);
+  run->config.nbActions = 0;
+  run->config.actions = NULL;
+  run->config.nbTask = 1;
+  run->config.tasks = tasks;
+  run->clock.now = fakeNow;
+  run->clock.arg = NULL;
+
+  fake.now = 0;
+  fake.lastRead = -1;
+  fake.stop = 0;
+  fake.nbActive = 0;
+  fake.tasks = test;
+  fake.nbTasks = 1;
+  watcher = NULL;
+  if (pthread_create(thread, NULL, runSchedulerThread, run) != 0){
+    fprintf(stderr, "Cannot create thread of scheduler.\n");
+    exit(1);
+  }
+  while (1){
+    pthread_mutex_lock(&(fake.lock));
+    if (watcher != NULL && fake.nbActive == 1){
+      pthread_mutex_unlock(&(fake.lock));
+      break;
+    }
+    pthread_mutex_unlock(&(fake.lock));
+    usleep(100);
+  }
+  moveClock(0);
+}
+
+/**
+ * Ask the scheduler to stop and wait for its end
+ */
+static void stopScheduler(pthread_t thread){
+  Scheduler *scheduler = (Scheduler*)watcher->arg;
+
+  pthread_mutex_lock(&(fake.lock));
+  fake.stop = 1;
+  pthread_cond_broadcast(&(fake.cond));
+  pthread_mutex_unlock(&(fake.lock));
+  pthread_mutex_lock(&(scheduler->lock));
+  pthread_cond_signal(&(scheduler->cond));
+  pthread_mutex_unlock(&(scheduler->lock));
+  pthread_join(thread, NULL);
+}
+
+/**
+ * Check the runs of a task against the starts expected
+ */
+static void checkStarts(TestTask *test, const long long *expected, int nbExpected){
+  CHECK(test->nbStarts == nbExpected, "%d runs instead of %d", test->nbStarts, nbExpected);
+  for (int i = 0; i < nbExpected && i < test->nbStarts; i++){
+    CHECK(test->starts[i] == expected[i], "run %d started at %lld instead of %lld",
+          i + 1, test->starts[i], expected[i]);
+  }
+}
+
+/**
+ * A run of 2.3 s of a task run every second: the runs due while it is
+ * in progress are coalesced into one run started when it is over
+ */
+static void testCoalescing(){
+  static const long long expected[] = {0, 2300, 4600, 6900, 9200};
+  SchedulerRun run;
+  TestTask test;
+  Task *tasks[1];
+  pthread_t thread;
+  ScheduledTask *scheduled;
+
+  startScheduler(&run, &test, tasks, &thread, 1, 2300);
+  scheduled = ((Scheduler*)watcher->arg)->tasks;
+  for (long long now = STEP; now <= 9900; now += STEP) moveClock(now);
+  //due at 1, 2, ..., 9 s, all while a run was in progress
+  CHECK(scheduled->nbCoalesced == 9, "%ld runs coalesced instead of 9", scheduled->nbCoalesced);
+  CHECK(scheduled->timer.expiry == 10000, "next run at %lld instead of 10000", scheduled->timer.expiry);
+  stopScheduler(thread);
+  checkStarts(&test, expected, sizeof(expected) / sizeof(expected[0]));
+}
+
+/**
+ * A clock jumping from 3.05 s to 8.5 s over a task run every second:
+ * one run is started for the intervals missed, and the next run is
+ * still on the times of the task (9 s), not 1 s after the jump
+ */
+static void testMissedIntervals(){
+  static const long long expected[] = {0, 1000, 2000, 3000, 8500, 9000, 10000};
+  SchedulerRun run;
+  TestTask test;
+  Task *tasks[1];
+  pthread_t thread;
+  ScheduledTask *scheduled;
+
+  startScheduler(&run, &test, tasks, &thread, 1, 10);
+  scheduled = ((Scheduler*)watcher->arg)->tasks;
+  for (long long now = STEP; now <= 3000; now += STEP) moveClock(now);
+  moveClock(3050);
+  moveClock(8500);
+  CHECK(scheduled->timer.expiry == 9000, "next run at %lld instead of 9000", scheduled->timer.expiry);
+  for (long long now = 8600; now <= 10000; now += STEP) moveClock(now);
+  CHECK(scheduled->nbCoalesced == 0, "%ld runs coalesced instead of 0", scheduled->nbCoalesced);
+  stopScheduler(thread);
+  checkStarts(&test, expected, sizeof(expected) / sizeof(expected[0]));
+}
+
+int main(){
+  pthread_mutex_init(&(fake.lock), NULL);
+  pthread_cond_init(&(fake.cond), NULL);
+
+  testJumpingClock();
+  testTickingClock();
+  testExpiredTimer();
+  testCoalescing();
+  testMissedIntervals();
+
+  pthread_cond_destroy(&(fake.cond));
+  pthread_mutex_destroy(&(fake.lock));
+  if (nbFailures > 0){
+    printf("timerwheel: %d checks failed\n", nbFailures);
+    return 1;
+  }
+  printf("timerwheel: all tests passed\n");
+  return 0;
+}
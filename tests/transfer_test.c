@@ -0,0 +1,324 @@
+/*
+**  Filename : transfer_test.c
+**
+**  Made by : CAO Song Toan
+**
+**  Description : Tests of the transfers which fail in the middle of
+**              their content (parse.h), against a local HTTP server.
+**              - A first run saves a large content (written through a
+**              temporary file) and a small one (kept in memory until the
+**              end), a second run gets new versions of both cut in the
+**              middle of the body: the files saved by the first run and
+**              their metadata must stay as they were.
+**              - A third run gets the new versions whole, they replace
+**              the files saved by the first run.
+**              - The crawl runs in a temporary directory, the server
+**              answers each request on its own connection.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include "configuration.h"
+#include "parse.h"
+#include "network.h"
+#include "mime.h"
+#include "metastore.h"
+#include "directory.h"
+
+#define LARGE_SIZE (4 * SINK_MEMORY_SIZE)   //goes through a temporary file
+#define SMALL_SIZE (SINK_MEMORY_SIZE / 8)   //stays in memory
+#define REQUEST_SIZE 4096
+
+#define CHECK(cond, ...) do{ \
+  if (!(cond)){ \
+    printf("%s:%d: ", __FILE__, __LINE__); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+    nbFailures++; \
+  } \
+}while (0)
+
+/*What the server sends for the contents*/
+typedef struct serverState{
+  int socket;
+  int version;                //version of the contents sent
+  int cut;                    //1 to close in the middle of the bodies
+}ServerState;
+
+static ServerState server;
+static int nbFailures = 0;
+
+/**
+ * Fill a content with the bytes of one of its versions
+ * @param content : where the bytes are written
+ * @param size : the size of the content
+ * @param version : the version of the content
+ * @return : nothing
+ */
+static void fillContent(char *content, size_t size, int version){
+  for (size_t i = 0; i < size; i++){
+    content[i] = 'a' + (i * 7 + version * 13) % 26;
+  }
+  content[size - 1] = '\n';
+}
+
+/**
+ * Answer one request: the 2 contents are text/plain, all the
+ * other paths are not found
+ * @param client : the connection of the request
+ * @return : nothing
+ */
+static void answerRequest(int client){
+  char request[REQUEST_SIZE], header[256], *content = NULL;
+  size_t size = 0, sent;
+  ssize_t n, len = 0;
+
+  while (len < REQUEST_SIZE - 1 && (n = read(client, request + len, REQUEST_SIZE - 1 - len)) > 0){
+    len += n;
+    request[len] = '\0';
+    if (strstr(request, "\r\n\r\n") != NULL) break;
+  }
+  if (len <= 0) return;
+  if (strncmp(request, "GET /large.txt ", 15) == 0) size = LARGE_SIZE;
+  else if (strncmp(request, "GET /small.txt ", 15) == 0) size = SMALL_SIZE;
+
+  if (size == 0){
+    snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\n"
+             "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    write(client, header, strlen(header));
+    return;
+  }
+  content = (char*)malloc(size);
+  if (content == NULL){
+    fprintf(stderr, "Allocation for content failed.\n");
+    exit(1);
+  }
+  fillContent(content, size, server.version);
+  snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+           "Content-Length: %zu\r\nConnection: close\r\n\r\n", size);
+  write(client, header, strlen(header));
+  //the connection is closed before the end of the body
+  sent = server.cut ? size / 2 : size;
+  write(client, content, sent);
+  free(content);
+}
+
+/**
+ * Thread of the server: one connection per request
+ * @param arg : unused
+ * @return : NULL
+ */
+static void *runServer(void *arg){
+  int client;
+
+  (void)arg;
+  while ((client = accept(server.socket, NULL, NULL)) >= 0){
+    answerRequest(client);
+    shutdown(client, SHUT_RDWR);
+    close(client);
+  }
+  return NULL;
+}
+
+/**
+ * Start the server on a free port of the loopback
+ * @param thread : where the thread of the server is saved
+ * @return : the port of the server
+ */
+static int startServer(pthread_t *thread){
+  struct sockaddr_in addr;
+  socklen_t lenAddr = sizeof(addr);
+  int yes = 1;
+
+  server.socket = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(server.socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  if (server.socket < 0 || bind(server.socket, (struct sockaddr*)&addr, sizeof(addr)) != 0
+      || listen(server.socket, 16) != 0
+      || getsockname(server.socket, (struct sockaddr*)&addr, &lenAddr) != 0){
+    perror("server");
+    exit(1);
+  }
+  pthread_create(thread, NULL, runServer, NULL);
+  return ntohs(addr.sin_port);
+}
+
+/**
+ * Write the configuration of the test: one task with
+ * the action of each content
+ * @param port : the port of the server
+ * @return : nothing
+ */
+static void writeConfiguration(int port){
+  FILE *f = fopen("test.sconf", "w");
+
+  if (f == NULL){
+    perror("test.sconf");
+    exit(1);
+  }
+  fprintf(f, "=\n{name -> Large}\n{url -> http://127.0.0.1:%d/large.txt}\n+\n"
+          "{max-depth -> 0}\n{type -> (text/plain)}\n\n", port);
+  fprintf(f, "=\n{name -> Small}\n{url -> http://127.0.0.1:%d/small.txt}\n+\n"
+          "{max-depth -> 0}\n{type -> (text/plain)}\n\n", port);
+  fprintf(f, "==\n{name -> Cut}\n{second -> 5}\n+\n(Large, Small)\n");
+  fclose(f);
+}
+
+/**
+ * Run the task once, as the crawler does without -d
+ * @param version : version of the contents sent by the server
+ * @param cut : 1 if the server cuts the bodies
+ * @return : nothing
+ */
+static void runTask(int version, int cut){
+  char configName[] = "test.sconf";
+  Configure *config = readConfigure(configName);
+
+  server.version = version;
+  server.cut = cut;
+  parseConfig(config, 1);
+  delConfigure(&config);
+}
+
+/**
+ * Read a whole file
+ * @param path : the file
+ * @param size : where its size is saved
+ * @return : its bytes, NULL if it cannot be read
+ */
+static char *readFile(const char *path, size_t *size){
+  FILE *f = fopen(path, "rb");
+  struct stat st;
+  char *res;
+
+  if (f == NULL) return NULL;
+  if (fstat(fileno(f), &st) != 0 || (res = (char*)malloc(st.st_size + 1)) == NULL){
+    fclose(f);
+    return NULL;
+  }
+  *size = fread(res, 1, st.st_size, f);
+  res[*size] = '\0';
+  fclose(f);
+  return res;
+}
+
+/**
+ * Check the files of the directory of the text contents of an
+ * action: only the content saved, whole, and no temporary file
+ * @param action : the name of the action
+ * @param size : the size of the content
+ * @param version : the version of the content which must be saved
+ * @return : nothing
+ */
+static void checkSaved(const char *action, size_t size, int version){
+  char dirPath[256], path[512], *expected, *saved;
+  struct dirent *entry;
+  int nbFiles = 0;
+  size_t lenSaved = 0;
+  DIR *dir;
+
+  snprintf(dirPath, sizeof(dirPath), "%s/%s/text", DATA_DIR, action);
+  dir = opendir(dirPath);
+  CHECK(dir != NULL, "%s: no directory %s", action, dirPath);
+  if (dir == NULL) return;
+  expected = (char*)malloc(size);
+  if (expected == NULL){
+    fprintf(stderr, "Allocation for content failed.\n");
+    exit(1);
+  }
+  fillContent(expected, size, version);
+  while ((entry = readdir(dir)) != NULL){
+    if (entry->d_name[0] == '.') continue;
+    nbFiles++;
+    snprintf(path, sizeof(path), "%s/%s", dirPath, entry->d_name);
+    saved = readFile(path, &lenSaved);
+    CHECK(saved != NULL && lenSaved == size && memcmp(saved, expected, size) == 0,
+          "%s: %s holds %zu bytes, not the %zu of version %d", action, entry->d_name,
+          lenSaved, size, version);
+    free(saved);
+  }
+  closedir(dir);
+  free(expected);
+  CHECK(nbFiles == 1, "%s: %d files instead of 1", action, nbFiles);
+}
+
+/**
+ * Read the metadata file of an action
+ * @param action : the name of the action
+ * @return : its content ("" if there is none)
+ */
+static char *readMetadata(const char *action){
+  char path[256], *res;
+  size_t size;
+
+  snprintf(path, sizeof(path), "%s/%s/%s", DATA_DIR, action, METADATA_FILE);
+  res = readFile(path, &size);
+  return res != NULL ? res : strdup("");
+}
+
+int main(){
+  char template[] = "/tmp/transfer_test-XXXXXX", *large, *small, *metadata;
+  pthread_t thread;
+  int port;
+
+  if (mkdtemp(template) == NULL || chdir(template) != 0 || mkdir("work", 0755) != 0
+      || chdir("work") != 0){
+    perror(template);
+    return 1;
+  }
+  port = startServer(&thread);
+  writeConfiguration(port);
+  initNetwork(1);
+  initAllMIME(NULL);
+
+  runTask(1, 0);
+  checkSaved("Large", LARGE_SIZE, 1);
+  checkSaved("Small", SMALL_SIZE, 1);
+  large = readMetadata("Large");
+  small = readMetadata("Small");
+  CHECK(strstr(large, "/large.txt") != NULL, "Large: no metadata after the first run");
+  CHECK(strstr(small, "/small.txt") != NULL, "Small: no metadata after the first run");
+
+  //the new versions are cut: nothing saved by the first run changes
+  runTask(2, 1);
+  checkSaved("Large", LARGE_SIZE, 1);
+  checkSaved("Small", SMALL_SIZE, 1);
+  metadata = readMetadata("Large");
+  CHECK(strcmp(metadata, large) == 0, "Large: metadata changed by a cut content");
+  free(metadata);
+  metadata = readMetadata("Small");
+  CHECK(strcmp(metadata, small) == 0, "Small: metadata changed by a cut content");
+  free(metadata);
+
+  runTask(2, 0);
+  checkSaved("Large", LARGE_SIZE, 2);
+  checkSaved("Small", SMALL_SIZE, 2);
+
+  free(large);
+  free(small);
+  shutdown(server.socket, SHUT_RDWR);
+  close(server.socket);
+  pthread_join(thread, NULL);
+  delAllMIME();
+  delMetaStores();
+  delDirectories();
+  delNetwork();
+
+  if (nbFailures > 0){
+    printf("transfer: %d checks failed (files in %s)\n", nbFailures, template);
+    return 1;
+  }
+  printf("transfer: all tests passed\n");
+  return 0;
+}